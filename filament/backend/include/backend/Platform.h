@@ -23,6 +23,8 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+
 namespace filament {
 namespace backend {
 
@@ -37,6 +39,33 @@ public:
         uintptr_t image = 0;
     };
 
+    /**
+     * Stores a binary blob under the given key. This is modeled after EGL_ANDROID_blob_cache.
+     *
+     * @param key       pointer to the key data
+     * @param keySize   size of the key in bytes
+     * @param value     pointer to the data to store
+     * @param valueSize size of the data in bytes
+     * @param user      the user pointer given to setBlobFunc()
+     */
+    using InsertBlobFunc = void(*)(const void* key, size_t keySize,
+            const void* value, size_t valueSize, void* user);
+
+    /**
+     * Retrieves a binary blob previously stored with InsertBlobFunc.
+     *
+     * @param key       pointer to the key data
+     * @param keySize   size of the key in bytes
+     * @param value     destination buffer, can be nullptr if valueSize is 0
+     * @param valueSize size of the destination buffer in bytes
+     * @param user      the user pointer given to setBlobFunc()
+     *
+     * @return The size of the stored blob, or 0 if there is no blob for this key. The blob is
+     *         copied into value only if valueSize is large enough to hold it.
+     */
+    using RetrieveBlobFunc = size_t(*)(const void* key, size_t keySize,
+            void* value, size_t valueSize, void* user);
+
     virtual ~Platform() noexcept;
 
     /**
@@ -66,6 +95,38 @@ public:
      * thread, or if the platform does not need to perform any special processing.
      */
     virtual bool pumpEvents() noexcept { return false; }
+
+    /**
+     * Sets the callbacks used by the backend to persist opaque data across runs, such as the
+     * Vulkan pipeline cache. This must be called before createDriver().
+     *
+     * @param insertBlob    called to store a blob, can be nullptr
+     * @param retrieveBlob  called to retrieve a blob, can be nullptr
+     * @param user          a user pointer passed to both callbacks
+     */
+    void setBlobFunc(InsertBlobFunc insertBlob, RetrieveBlobFunc retrieveBlob,
+            void* user = nullptr) noexcept;
+
+    /**
+     * @return true if both blob callbacks have been set.
+     */
+    bool hasBlobFunc() const noexcept;
+
+    /**
+     * Stores a blob using the callback set with setBlobFunc(), if any.
+     */
+    void insertBlob(const void* key, size_t keySize, const void* value, size_t valueSize) noexcept;
+
+    /**
+     * Retrieves a blob using the callback set with setBlobFunc(), if any.
+     * @return the size of the stored blob, or 0 if none.
+     */
+    size_t retrieveBlob(const void* key, size_t keySize, void* value, size_t valueSize) noexcept;
+
+private:
+    InsertBlobFunc mInsertBlob = nullptr;
+    RetrieveBlobFunc mRetrieveBlob = nullptr;
+    void* mBlobUser = nullptr;
 };
 
 
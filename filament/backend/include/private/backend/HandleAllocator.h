@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+#define TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+
+#include <backend/Handle.h>
+
+#include <utils/Allocator.h>
+#include <utils/compiler.h>
+#include <utils/Panic.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace filament {
+namespace backend {
+
+/*
+ * HandleAllocator is a size-classed arena of hardware handles. A HandleId is the offset of the
+ * object in the arena, so handle_cast() is a lock-free O(1) operation. Only allocate() and
+ * deallocate() take a (spin) lock, since handles are allocated on the main thread and freed on
+ * the driver thread.
+ *
+ * P0, P1 and P2 are the sizes of the three pools, each object is allocated from the smallest
+ * pool that fits it.
+ */
+template<size_t P0, size_t P1, size_t P2>
+class HandleAllocator {
+public:
+    static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
+    static constexpr size_t MIN_ALIGNMENT = size_t(1) << MIN_ALIGNMENT_SHIFT;
+    static constexpr size_t MAX_HANDLE_SIZE = P2;
+
+    static_assert(P0 % MIN_ALIGNMENT == 0 && P1 % MIN_ALIGNMENT == 0 && P2 % MIN_ALIGNMENT == 0,
+            "pool sizes must be a multiple of MIN_ALIGNMENT");
+    static_assert(P0 < P1 && P1 < P2, "pool sizes must be in increasing order");
+
+    HandleAllocator(const char* name, size_t size) noexcept
+            : mHandleArena(name, size) {
+    }
+
+    HandleAllocator(HandleAllocator const& rhs) = delete;
+    HandleAllocator& operator=(HandleAllocator const& rhs) = delete;
+
+    // allocates memory for a D, without constructing it
+    template<typename D, typename B = D>
+    Handle<B> allocate() noexcept {
+        static_assert(std::is_base_of<B, D>::value, "D must derive from B");
+        static_assert(sizeof(D) <= MAX_HANDLE_SIZE, "Handle<> too large");
+        static_assert(alignof(D) <= MIN_ALIGNMENT, "Handle<> alignment too large");
+        return Handle<B>{ allocateHandle(sizeof(D)) };
+    }
+
+    // allocates memory for a D and constructs it
+    template<typename D, typename B = D, typename ... ARGS>
+    Handle<B> allocateAndConstruct(ARGS&& ... args) noexcept {
+        Handle<B> handle{ allocate<D, B>() };
+        construct<D>(handle, std::forward<ARGS>(args)...);
+        return handle;
+    }
+
+    // constructs a D in memory previously returned by allocate()
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        assert(handle);
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        new(addr) D(std::forward<ARGS>(args)...);
+        return addr;
+    }
+
+    // destroys the D referenced by handle and returns its memory to the arena
+    template<typename D, typename B>
+    typename std::enable_if<std::is_base_of<B, D>::value, void>::type
+    deallocate(Handle<B> const& handle) noexcept {
+        if (handle) {
+            D* p = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+            p->~D();
+            mHandleArena.free(p, sizeof(D));
+        }
+    }
+
+    /*
+     * handle_cast
+     *
+     * casts a Handle<> to a pointer to the data it refers to.
+     */
+    template<typename Dp, typename B>
+    inline
+    typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B>& handle) noexcept {
+        assert(handle);
+        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
+        char* const base = (char *)mHandleArena.getArea().begin();
+        size_t offset = size_t(handle.getId()) << MIN_ALIGNMENT_SHIFT;
+        // assert that this handle is even a valid one
+        assert(base + offset + sizeof(typename std::remove_pointer<Dp>::type) <=
+                (char *)mHandleArena.getArea().end());
+        return static_cast<Dp>(static_cast<void *>(base + offset));
+    }
+
+    template<typename Dp, typename B>
+    inline
+    typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B> const& handle) noexcept {
+        return handle_cast<Dp>(const_cast<Handle<B>&>(handle));
+    }
+
+private:
+    class Allocator {
+        utils::PoolAllocator<P0, MIN_ALIGNMENT> mPool0;
+        utils::PoolAllocator<P1, MIN_ALIGNMENT> mPool1;
+        utils::PoolAllocator<P2, MIN_ALIGNMENT> mPool2;
+    public:
+        // the arena is split in 1/16, 5/16 and 10/16 between the pools
+        explicit Allocator(const utils::HeapArea& area)
+                : mPool0(area.begin(),
+                        utils::pointermath::add(area.begin(), (1 * area.getSize()) / 16)),
+                  mPool1(utils::pointermath::add(area.begin(), (1 * area.getSize()) / 16),
+                        utils::pointermath::add(area.begin(), (6 * area.getSize()) / 16)),
+                  mPool2(utils::pointermath::add(area.begin(), (6 * area.getSize()) / 16),
+                        area.end()) {
+        }
+
+        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept {
+            if (size <= P0) return mPool0.alloc(size, MIN_ALIGNMENT, extra);
+            if (size <= P1) return mPool1.alloc(size, MIN_ALIGNMENT, extra);
+            if (size <= P2) return mPool2.alloc(size, MIN_ALIGNMENT, extra);
+            return nullptr;
+        }
+
+        void free(void* p, size_t size) noexcept {
+            if (size <= P0) { mPool0.free(p); return; }
+            if (size <= P1) { mPool1.free(p); return; }
+            if (size <= P2) { mPool2.free(p); return; }
+        }
+    };
+
+    // the arena for handle allocation needs to be thread-safe
+#ifndef NDEBUG
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock,
+            utils::TrackingPolicy::Debug>;
+#else
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock>;
+#endif
+
+    // This is "NOINLINE" because it ends-up generating more code than we'd like because of
+    // the locking.
+    UTILS_NOINLINE
+    HandleBase::HandleId allocateHandle(size_t size) noexcept {
+        void* addr = mHandleArena.alloc(size, MIN_ALIGNMENT);
+        ASSERT_POSTCONDITION(addr, "%s arena is full (%u bytes)",
+                mHandleArena.getName(), unsigned(mHandleArena.getArea().getSize()));
+        char* const base = (char *)mHandleArena.getArea().begin();
+        size_t offset = (char*)addr - base;
+        return HandleBase::HandleId(offset >> MIN_ALIGNMENT_SHIFT);
+    }
+
+    HandleArena mHandleArena;
+};
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
@@ -18,15 +18,18 @@
 #define TNT_FILAMENT_DRIVER_METALDRIVER_H
 
 #include "private/backend/Driver.h"
+#include "private/backend/HandleAllocator.h"
 #include "DriverBase.h"
 
 #include <utils/compiler.h>
 #include <utils/Log.h>
 
-#include <tsl/robin_map.h>
-
 #include <mutex>
 
+#ifndef FILAMENT_METAL_HANDLE_ARENA_SIZE_IN_MB
+#    define FILAMENT_METAL_HANDLE_ARENA_SIZE_IN_MB 8
+#endif
+
 namespace filament {
 namespace backend {
 
@@ -86,78 +89,42 @@ private:
      * Memory management
      */
 
-    // Copied from VulkanDriver.h
-
-    // For now we're not bothering to store handles in pools, just simple on-demand allocation.
-    // We have a little map from integer handles to "blobs" which get replaced with the Hw objects.
-    using Blob = void*;
-    using HandleMap = tsl::robin_map<HandleBase::HandleId, Blob>;
-    std::mutex mHandleMapMutex;
-    HandleMap mHandleMap;
-    HandleBase::HandleId mNextId = 1;
+    // Handles are allocated from size-classed pools, the HandleId being the offset of the object
+    // in the arena. This makes handle_cast<> lock-free and O(1).
+    using HandleAllocator = backend::HandleAllocator<64, 256, 1024>;
+    HandleAllocator mHandleAllocator;
 
     template<typename Dp, typename B>
-    Handle<B> alloc_handle() {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        mHandleMap[mNextId] = malloc(sizeof(Dp));
-        return Handle<B>(mNextId++);
+    Handle<B> alloc_handle() noexcept {
+        return mHandleAllocator.allocate<Dp, B>();
     }
 
     template<typename Dp, typename B, typename ... ARGS>
-    Handle<B> alloc_and_construct_handle(ARGS&& ... args) {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        Blob blob = mHandleMap[mNextId] = malloc(sizeof(Dp));
-        Dp* addr = reinterpret_cast<Dp*>(blob);
-        new(addr) Dp(std::forward<ARGS>(args)...);
-        return Handle<B>(mNextId++);
+    Handle<B> alloc_and_construct_handle(ARGS&& ... args) noexcept {
+        return mHandleAllocator.allocateAndConstruct<Dp, B>(std::forward<ARGS>(args)...);
     }
 
     template<typename Dp, typename B>
-    Dp* handle_cast(HandleMap& handleMap, Handle<B> handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter.value();
-        return reinterpret_cast<Dp*>(blob);
+    Dp* handle_cast(Handle<B> handle) noexcept {
+        return mHandleAllocator.handle_cast<Dp*>(handle);
     }
 
     template<typename Dp, typename B>
-    const Dp* handle_const_cast(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter.value();
-        return reinterpret_cast<const Dp*>(blob);
+    const Dp* handle_const_cast(const Handle<B>& handle) noexcept {
+        return mHandleAllocator.handle_cast<Dp*>(handle);
     }
 
     template<typename Dp, typename B, typename ... ARGS>
-    Dp* construct_handle(HandleMap& handleMap, Handle<B>& handle, ARGS&& ... args) noexcept {
+    Dp* construct_handle(Handle<B>& handle, ARGS&& ... args) noexcept {
         assert(handle);
         if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter.value();
-        Dp* addr = reinterpret_cast<Dp*>(blob);
-        new(addr) Dp(std::forward<ARGS>(args)...);
-        return addr;
+        return mHandleAllocator.construct<Dp>(handle, std::forward<ARGS>(args)...);
     }
 
     template<typename Dp, typename B>
-    void destruct_handle(HandleMap& handleMap, Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
+    void destruct_handle(Handle<B>& handle) noexcept {
         assert(handle);
-        // Call the destructor, remove the blob, don't bother reclaiming the integer id.
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter.value();
-        reinterpret_cast<Dp*>(blob)->~Dp();
-        free(blob);
-        handleMap.erase(handle.getId());
+        mHandleAllocator.deallocate<Dp>(handle);
     }
 
     void enumerateSamplerGroups(const MetalProgram* program,
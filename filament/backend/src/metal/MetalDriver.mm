@@ -35,6 +35,8 @@
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <limits>
+
 namespace filament {
 namespace backend {
 
@@ -53,7 +55,8 @@ Driver* MetalDriver::create(MetalPlatform* const platform) {
 MetalDriver::MetalDriver(backend::MetalPlatform* platform) noexcept
         : DriverBase(new ConcreteDispatcher<MetalDriver>()),
         mPlatform(*platform),
-        mContext(new MetalContext) {
+        mContext(new MetalContext),
+        mHandleAllocator("Handles", FILAMENT_METAL_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U) {
     mContext->driver = this;
     mContext->device = MTLCreateSystemDefaultDevice();
     mContext->commandQueue = [mContext->device newCommandQueue];
@@ -108,13 +111,13 @@ void MetalDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
 
 void MetalDriver::setFrameScheduledCallback(Handle<HwSwapChain> sch,
         backend::FrameScheduledCallback callback, void* user) {
-    auto* swapChain = handle_cast<MetalSwapChain>(mHandleMap, sch);
+    auto* swapChain = handle_cast<MetalSwapChain>(sch);
     swapChain->setFrameScheduledCallback(callback, user);
 }
 
 void MetalDriver::setFrameCompletedCallback(Handle<HwSwapChain> sch,
         backend::FrameCompletedCallback callback, void* user) {
-    auto* swapChain = handle_cast<MetalSwapChain>(mHandleMap, sch);
+    auto* swapChain = handle_cast<MetalSwapChain>(sch);
     swapChain->setFrameCompletedCallback(callback, user);
 }
 
@@ -160,20 +163,20 @@ void MetalDriver::createVertexBufferR(Handle<HwVertexBuffer> vbh, uint8_t buffer
         uint8_t attributeCount, uint32_t vertexCount, AttributeArray attributes,
         BufferUsage usage) {
     // TODO: Take BufferUsage into account when creating the buffer.
-    construct_handle<MetalVertexBuffer>(mHandleMap, vbh, *mContext, bufferCount,
+    construct_handle<MetalVertexBuffer>(vbh, *mContext, bufferCount,
             attributeCount, vertexCount, attributes);
 }
 
 void MetalDriver::createIndexBufferR(Handle<HwIndexBuffer> ibh, ElementType elementType,
         uint32_t indexCount, BufferUsage usage) {
     auto elementSize = (uint8_t) getElementTypeSize(elementType);
-    construct_handle<MetalIndexBuffer>(mHandleMap, ibh, *mContext, elementSize, indexCount);
+    construct_handle<MetalIndexBuffer>(ibh, *mContext, elementSize, indexCount);
 }
 
 void MetalDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
         uint32_t depth, TextureUsage usage) {
-    construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels, format, samples,
+    construct_handle<MetalTexture>(th, *mContext, target, levels, format, samples,
             width, height, depth, usage);
 }
 
@@ -181,7 +184,7 @@ void MetalDriver::createTextureSwizzledR(Handle<HwTexture> th, SamplerType targe
         TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
         uint32_t depth, TextureUsage usage,
         TextureSwizzle r, TextureSwizzle g, TextureSwizzle b, TextureSwizzle a) {
-    construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels, format, samples,
+    construct_handle<MetalTexture>(th, *mContext, target, levels, format, samples,
             width, height, depth, usage);
     // TODO: implement texture swizzle
 }
@@ -208,29 +211,29 @@ void MetalDriver::importTextureR(Handle<HwTexture> th, intptr_t i,
     ASSERT_PRECONDITION(metalTexture.textureType == filamentMetalType,
             "Imported id<MTLTexture> type (%d) != Filament texture type (%d)",
             metalTexture.textureType, filamentMetalType);
-    construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels, format, samples,
+    construct_handle<MetalTexture>(th, *mContext, target, levels, format, samples,
         width, height, depth, usage, metalTexture);
 }
 
 void MetalDriver::createSamplerGroupR(Handle<HwSamplerGroup> sbh, size_t size) {
-    mContext->samplerGroups.insert(construct_handle<MetalSamplerGroup>(mHandleMap, sbh, size));
+    mContext->samplerGroups.insert(construct_handle<MetalSamplerGroup>(sbh, size));
 }
 
 void MetalDriver::createUniformBufferR(Handle<HwUniformBuffer> ubh, size_t size,
         BufferUsage usage) {
-    construct_handle<MetalUniformBuffer>(mHandleMap, ubh, *mContext, size);
+    construct_handle<MetalUniformBuffer>(ubh, *mContext, size);
 }
 
 void MetalDriver::createRenderPrimitiveR(Handle<HwRenderPrimitive> rph, int dummy) {
-    construct_handle<MetalRenderPrimitive>(mHandleMap, rph);
+    construct_handle<MetalRenderPrimitive>(rph);
 }
 
 void MetalDriver::createProgramR(Handle<HwProgram> rph, Program&& program) {
-    construct_handle<MetalProgram>(mHandleMap, rph, mContext->device, program);
+    construct_handle<MetalProgram>(rph, mContext->device, program);
 }
 
 void MetalDriver::createDefaultRenderTargetR(Handle<HwRenderTarget> rth, int dummy) {
-    construct_handle<MetalRenderTarget>(mHandleMap, rth, mContext);
+    construct_handle<MetalRenderTarget>(rth, mContext);
 }
 
 void MetalDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
@@ -247,7 +250,7 @@ void MetalDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
             continue;
         }
 
-        auto colorTexture = handle_cast<MetalTexture>(mHandleMap, buffer.handle);
+        auto colorTexture = handle_cast<MetalTexture>(buffer.handle);
         ASSERT_PRECONDITION(colorTexture->texture,
                 "Color texture passed to render target has no texture allocation");
         colorTexture->updateLodRange(buffer.level);
@@ -258,7 +261,7 @@ void MetalDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
 
     MetalRenderTarget::Attachment depthAttachment = { 0 };
     if (depth.handle) {
-        auto depthTexture = handle_cast<MetalTexture>(mHandleMap, depth.handle);
+        auto depthTexture = handle_cast<MetalTexture>(depth.handle);
         ASSERT_PRECONDITION(depthTexture->texture,
                 "Depth texture passed to render target has no texture allocation.");
         depthTexture->updateLodRange(depth.level);
@@ -269,7 +272,7 @@ void MetalDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
     ASSERT_POSTCONDITION(!depth.handle || any(targetBufferFlags & TargetBufferFlags::DEPTH),
             "The DEPTH flag was specified, but no depth texture provided.");
 
-    construct_handle<MetalRenderTarget>(mHandleMap, rth, mContext, width, height, samples,
+    construct_handle<MetalRenderTarget>(rth, mContext, width, height, samples,
             colorAttachments, depthAttachment);
 
     ASSERT_POSTCONDITION(
@@ -279,28 +282,28 @@ void MetalDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
 }
 
 void MetalDriver::createFenceR(Handle<HwFence> fh, int dummy) {
-    auto* fence = handle_cast<MetalFence>(mHandleMap, fh);
+    auto* fence = handle_cast<MetalFence>(fh);
     fence->encode();
 }
 
 void MetalDriver::createSyncR(Handle<HwSync> sh, int) {
-    auto* fence = handle_cast<MetalFence>(mHandleMap, sh);
-    fence->encode();
+    auto* sync = handle_cast<MetalSync>(sh);
+    sync->fence.encode();
 }
 
 void MetalDriver::createSwapChainR(Handle<HwSwapChain> sch, void* nativeWindow, uint64_t flags) {
     if (UTILS_UNLIKELY(flags & backend::SWAP_CHAIN_CONFIG_APPLE_CVPIXELBUFFER)) {
         CVPixelBufferRef pixelBuffer = (CVPixelBufferRef) nativeWindow;
-        construct_handle<MetalSwapChain>(mHandleMap, sch, *mContext, pixelBuffer, flags);
+        construct_handle<MetalSwapChain>(sch, *mContext, pixelBuffer, flags);
     } else {
         auto* metalLayer = (__bridge CAMetalLayer*) nativeWindow;
-        construct_handle<MetalSwapChain>(mHandleMap, sch, *mContext, metalLayer, flags);
+        construct_handle<MetalSwapChain>(sch, *mContext, metalLayer, flags);
     }
 }
 
 void MetalDriver::createSwapChainHeadlessR(Handle<HwSwapChain> sch,
         uint32_t width, uint32_t height, uint64_t flags) {
-    construct_handle<MetalSwapChain>(mHandleMap, sch, *mContext, width, height, flags);
+    construct_handle<MetalSwapChain>(sch, *mContext, width, height, flags);
 }
 
 void MetalDriver::createStreamFromTextureIdR(Handle<HwStream>, intptr_t externalTextureId,
@@ -364,7 +367,7 @@ Handle<HwFence> MetalDriver::createFenceS() noexcept {
 Handle<HwSync> MetalDriver::createSyncS() noexcept {
     // The handle must be constructed here, as a synchronous call to getSyncStatus might happen
     // before createSyncR is executed.
-    return alloc_and_construct_handle<MetalFence, HwSync>(*mContext);
+    return alloc_and_construct_handle<MetalSync, HwSync>(*mContext);
 }
 
 Handle<HwSwapChain> MetalDriver::createSwapChainS() noexcept {
@@ -387,25 +390,25 @@ Handle<HwTimerQuery> MetalDriver::createTimerQueryS() noexcept {
 
 void MetalDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
     if (vbh) {
-        destruct_handle<MetalVertexBuffer>(mHandleMap, vbh);
+        destruct_handle<MetalVertexBuffer>(vbh);
     }
 }
 
 void MetalDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
     if (ibh) {
-        destruct_handle<MetalIndexBuffer>(mHandleMap, ibh);
+        destruct_handle<MetalIndexBuffer>(ibh);
     }
 }
 
 void MetalDriver::destroyRenderPrimitive(Handle<HwRenderPrimitive> rph) {
     if (rph) {
-        destruct_handle<MetalRenderPrimitive>(mHandleMap, rph);
+        destruct_handle<MetalRenderPrimitive>(rph);
     }
 }
 
 void MetalDriver::destroyProgram(Handle<HwProgram> ph) {
     if (ph) {
-        destruct_handle<MetalProgram>(mHandleMap, ph);
+        destruct_handle<MetalProgram>(ph);
     }
 }
 
@@ -414,21 +417,21 @@ void MetalDriver::destroySamplerGroup(Handle<HwSamplerGroup> sbh) {
         return;
     }
     // Unbind this sampler group from our internal state.
-    auto* metalSampler = handle_cast<MetalSamplerGroup>(mHandleMap, sbh);
+    auto* metalSampler = handle_cast<MetalSamplerGroup>(sbh);
     for (auto& samplerBinding : mContext->samplerBindings) {
         if (samplerBinding == metalSampler) {
             samplerBinding = {};
         }
     }
     mContext->samplerGroups.erase(metalSampler);
-    destruct_handle<MetalSamplerGroup>(mHandleMap, sbh);
+    destruct_handle<MetalSamplerGroup>(sbh);
 }
 
 void MetalDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
     if (!ubh) {
         return;
     }
-    destruct_handle<MetalUniformBuffer>(mHandleMap, ubh);
+    destruct_handle<MetalUniformBuffer>(ubh);
     for (auto& thisUniform : mContext->uniformState) {
         if (thisUniform.ubh == ubh) {
             thisUniform.bound = false;
@@ -452,18 +455,18 @@ void MetalDriver::destroyTexture(Handle<HwTexture> th) {
         }
     }
 
-    destruct_handle<MetalTexture>(mHandleMap, th);
+    destruct_handle<MetalTexture>(th);
 }
 
 void MetalDriver::destroyRenderTarget(Handle<HwRenderTarget> rth) {
     if (rth) {
-        destruct_handle<MetalRenderTarget>(mHandleMap, rth);
+        destruct_handle<MetalRenderTarget>(rth);
     }
 }
 
 void MetalDriver::destroySwapChain(Handle<HwSwapChain> sch) {
     if (sch) {
-        destruct_handle<MetalSwapChain>(mHandleMap, sch);
+        destruct_handle<MetalSwapChain>(sch);
     }
 }
 
@@ -473,13 +476,13 @@ void MetalDriver::destroyStream(Handle<HwStream> sh) {
 
 void MetalDriver::destroyTimerQuery(Handle<HwTimerQuery> tqh) {
     if (tqh) {
-        destruct_handle<MetalTimerQuery>(mHandleMap, tqh);
+        destruct_handle<MetalTimerQuery>(tqh);
     }
 }
 
 void MetalDriver::destroySync(Handle<HwSync> sh) {
     if (sh) {
-        destruct_handle<MetalFence>(mHandleMap, sh);
+        destruct_handle<MetalSync>(sh);
     }
 }
 
@@ -531,12 +534,12 @@ void MetalDriver::updateStreams(backend::DriverApi* driver) {
 
 void MetalDriver::destroyFence(Handle<HwFence> fh) {
     if (fh) {
-        destruct_handle<MetalFence>(mHandleMap, fh);
+        destruct_handle<MetalFence>(fh);
     }
 }
 
 FenceStatus MetalDriver::wait(Handle<HwFence> fh, uint64_t timeout) {
-    auto* fence = handle_cast<MetalFence>(mHandleMap, fh);
+    auto* fence = handle_cast<MetalFence>(fh);
     if (!fence) {
         return FenceStatus::ERROR;
     }
@@ -619,6 +622,11 @@ bool MetalDriver::areFeedbackLoopsSupported() {
     return true;
 }
 
+size_t MetalDriver::getMaxUniformBufferSize() {
+    // Metal doesn't limit the size of the buffers bound to the constant address space
+    return std::numeric_limits<uint32_t>::max();
+}
+
 math::float2 MetalDriver::getClipSpaceParams() {
     // z-coordinate of clip-space is in [0,w]
     return math::float2{ -0.5f, 0.5f };
@@ -627,7 +635,7 @@ math::float2 MetalDriver::getClipSpaceParams() {
 void MetalDriver::updateVertexBuffer(Handle<HwVertexBuffer> vbh, size_t index,
         BufferDescriptor&& data, uint32_t byteOffset) {
     assert(byteOffset == 0);    // TODO: handle byteOffset for vertex buffers
-    auto* vb = handle_cast<MetalVertexBuffer>(mHandleMap, vbh);
+    auto* vb = handle_cast<MetalVertexBuffer>(vbh);
     vb->buffers[index]->copyIntoBuffer(data.buffer, data.size);
     scheduleDestroy(std::move(data));
 }
@@ -635,7 +643,7 @@ void MetalDriver::updateVertexBuffer(Handle<HwVertexBuffer> vbh, size_t index,
 void MetalDriver::updateIndexBuffer(Handle<HwIndexBuffer> ibh, BufferDescriptor&& data,
         uint32_t byteOffset) {
     assert(byteOffset == 0);    // TODO: handle byteOffset for index buffers
-    auto* ib = handle_cast<MetalIndexBuffer>(mHandleMap, ibh);
+    auto* ib = handle_cast<MetalIndexBuffer>(ibh);
     ib->buffer.copyIntoBuffer(data.buffer, data.size);
     scheduleDestroy(std::move(data));
 }
@@ -644,7 +652,7 @@ void MetalDriver::update2DImage(Handle<HwTexture> th, uint32_t level, uint32_t x
         uint32_t yoffset, uint32_t width, uint32_t height, PixelBufferDescriptor&& data) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
             "update2DImage must be called outside of a render pass.");
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture>(th);
     tex->load2DImage(level, xoffset, yoffset, width, height, data);
     scheduleDestroy(std::move(data));
 }
@@ -658,7 +666,7 @@ void MetalDriver::update3DImage(Handle<HwTexture> th, uint32_t level,
         PixelBufferDescriptor&& data) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
             "update3DImage must be called outside of a render pass.");
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture>(th);
     tex->load3DImage(level, xoffset, yoffset, zoffset, width, height, depth, data);
     scheduleDestroy(std::move(data));
 }
@@ -667,7 +675,7 @@ void MetalDriver::updateCubeImage(Handle<HwTexture> th, uint32_t level,
         PixelBufferDescriptor&& data, FaceOffsets faceOffsets) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
             "updateCubeImage must be called outside of a render pass.");
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture>(th);
     tex->loadCubeImage(faceOffsets, level, data);
     scheduleDestroy(std::move(data));
 }
@@ -687,12 +695,12 @@ void MetalDriver::cancelExternalImage(void* image) {
 }
 
 void MetalDriver::setExternalImage(Handle<HwTexture> th, void* image) {
-    auto texture = handle_cast<MetalTexture>(mHandleMap, th);
+    auto texture = handle_cast<MetalTexture>(th);
     texture->externalImage.set((CVPixelBufferRef) image);
 }
 
 void MetalDriver::setExternalImagePlane(Handle<HwTexture> th, void* image, size_t plane) {
-    auto texture = handle_cast<MetalTexture>(mHandleMap, th);
+    auto texture = handle_cast<MetalTexture>(th);
     texture->externalImage.set((CVPixelBufferRef) image, plane);
 }
 
@@ -700,13 +708,13 @@ void MetalDriver::setExternalStream(Handle<HwTexture> th, Handle<HwStream> sh) {
 }
 
 bool MetalDriver::getTimerQueryValue(Handle<HwTimerQuery> tqh, uint64_t* elapsedTime) {
-    auto* tq = handle_cast<MetalTimerQuery>(mHandleMap, tqh);
+    auto* tq = handle_cast<MetalTimerQuery>(tqh);
     return mContext->timerQueryImpl->getQueryResult(tq, elapsedTime);
 }
 
 SyncStatus MetalDriver::getSyncStatus(Handle<HwSync> sh) {
-    auto* fence = handle_cast<MetalFence>(mHandleMap, sh);
-    FenceStatus status = fence->wait(0);
+    auto* sync = handle_cast<MetalSync>(sh);
+    FenceStatus status = sync->fence.wait(0);
     if (status == FenceStatus::TIMEOUT_EXPIRED) {
         return SyncStatus::NOT_SIGNALED;
     } else if (status == FenceStatus::CONDITION_SATISFIED) {
@@ -718,7 +726,7 @@ SyncStatus MetalDriver::getSyncStatus(Handle<HwSync> sh) {
 void MetalDriver::generateMipmaps(Handle<HwTexture> th) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
                         "generateMipmaps must be called outside of a render pass.");
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture>(th);
     id <MTLBlitCommandEncoder> blitEncoder = [getPendingCommandBuffer(mContext) blitCommandEncoder];
     [blitEncoder generateMipmapsForTexture:tex->texture];
     [blitEncoder endEncoding];
@@ -736,7 +744,7 @@ void MetalDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh,
        return;
     }
 
-    auto uniform = handle_cast<MetalUniformBuffer>(mHandleMap, ubh);
+    auto uniform = handle_cast<MetalUniformBuffer>(ubh);
 
     uniform->buffer.copyIntoBuffer(data.buffer, data.size);
     scheduleDestroy(std::move(data));
@@ -744,13 +752,13 @@ void MetalDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh,
 
 void MetalDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
-    auto sb = handle_cast<MetalSamplerGroup>(mHandleMap, sbh);
+    auto sb = handle_cast<MetalSamplerGroup>(sbh);
     *sb->sb = samplerGroup;
 }
 
 void MetalDriver::beginRenderPass(Handle<HwRenderTarget> rth,
         const RenderPassParams& params) {
-    auto renderTarget = handle_cast<MetalRenderTarget>(mHandleMap, rth);
+    auto renderTarget = handle_cast<MetalRenderTarget>(rth);
     mContext->currentRenderTarget = renderTarget;
     mContext->currentRenderPassFlags = params.flags;
 
@@ -796,16 +804,16 @@ void MetalDriver::endRenderPass(int dummy) {
 
 void MetalDriver::setRenderPrimitiveBuffer(Handle<HwRenderPrimitive> rph,
         Handle<HwVertexBuffer> vbh, Handle<HwIndexBuffer> ibh, uint32_t enabledAttributes) {
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
-    auto vertexBuffer = handle_cast<MetalVertexBuffer>(mHandleMap, vbh);
-    auto indexBuffer = handle_cast<MetalIndexBuffer>(mHandleMap, ibh);
+    auto primitive = handle_cast<MetalRenderPrimitive>(rph);
+    auto vertexBuffer = handle_cast<MetalVertexBuffer>(vbh);
+    auto indexBuffer = handle_cast<MetalIndexBuffer>(ibh);
     primitive->setBuffers(vertexBuffer, indexBuffer, enabledAttributes);
 }
 
 void MetalDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
         PrimitiveType pt, uint32_t offset, uint32_t minIndex, uint32_t maxIndex,
         uint32_t count) {
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
+    auto primitive = handle_cast<MetalRenderPrimitive>(rph);
     primitive->type = pt;
     primitive->offset = offset * primitive->indexBuffer->elementSize;
     primitive->count = count;
@@ -815,17 +823,17 @@ void MetalDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
 
 void MetalDriver::makeCurrent(Handle<HwSwapChain> schDraw, Handle<HwSwapChain> schRead) {
     ASSERT_PRECONDITION_NON_FATAL(schDraw, "A draw SwapChain must be set.");
-    auto* drawSwapChain = handle_cast<MetalSwapChain>(mHandleMap, schDraw);
+    auto* drawSwapChain = handle_cast<MetalSwapChain>(schDraw);
     mContext->currentDrawSwapChain = drawSwapChain;
 
     if (schRead) {
-        auto* readSwapChain = handle_cast<MetalSwapChain>(mHandleMap, schRead);
+        auto* readSwapChain = handle_cast<MetalSwapChain>(schRead);
         mContext->currentReadSwapChain = readSwapChain;
     }
 }
 
 void MetalDriver::commit(Handle<HwSwapChain> sch) {
-    auto* swapChain = handle_cast<MetalSwapChain>(mHandleMap, sch);
+    auto* swapChain = handle_cast<MetalSwapChain>(sch);
     swapChain->present();
     submitPendingCommands(mContext);
     swapChain->releaseDrawable();
@@ -849,7 +857,7 @@ void MetalDriver::bindUniformBufferRange(size_t index, Handle<HwUniformBuffer> u
 }
 
 void MetalDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
-    auto sb = handle_cast<MetalSamplerGroup>(mHandleMap, sbh);
+    auto sb = handle_cast<MetalSamplerGroup>(sbh);
     mContext->samplerBindings[index] = sb;
 }
 
@@ -892,7 +900,7 @@ void MetalDriver::readPixels(Handle<HwRenderTarget> src, uint32_t x, uint32_t y,
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
                         "readPixels must be called outside of a render pass.");
 
-    auto srcTarget = handle_cast<MetalRenderTarget>(mHandleMap, src);
+    auto srcTarget = handle_cast<MetalRenderTarget>(src);
     // We always readPixels from the COLOR0 attachment.
     MetalRenderTarget::Attachment color = srcTarget->getDrawColorAttachment(0);
     id<MTLTexture> srcTexture = color.texture;
@@ -981,8 +989,8 @@ void MetalDriver::blit(TargetBufferFlags buffers,
         mContext->currentRenderPassEncoder = nil;
     }
 
-    auto srcTarget = handle_cast<MetalRenderTarget>(mHandleMap, src);
-    auto dstTarget = handle_cast<MetalRenderTarget>(mHandleMap, dst);
+    auto srcTarget = handle_cast<MetalRenderTarget>(src);
+    auto dstTarget = handle_cast<MetalRenderTarget>(dst);
 
     ASSERT_PRECONDITION(srcRect.left >= 0 && srcRect.bottom >= 0 &&
                         dstRect.left >= 0 && dstRect.bottom >= 0,
@@ -1081,8 +1089,8 @@ void MetalDriver::blit(TargetBufferFlags buffers,
 void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph) {
     ASSERT_PRECONDITION(mContext->currentRenderPassEncoder != nullptr,
             "Attempted to draw without a valid command encoder.");
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
-    auto program = handle_cast<MetalProgram>(mHandleMap, ps.program);
+    auto primitive = handle_cast<MetalRenderPrimitive>(rph);
+    auto program = handle_cast<MetalProgram>(ps.program);
     const auto& rs = ps.rasterState;
 
     // If the material debugger is enabled, avoid fatal (or cascading) errors and that can occur
@@ -1202,7 +1210,7 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
         if (binding >= SAMPLER_BINDING_COUNT) {
             return;
         }
-        const auto metalTexture = handle_const_cast<MetalTexture>(mHandleMap, sampler->t);
+        const auto metalTexture = handle_const_cast<MetalTexture>(sampler->t);
         texturesToBind[binding] = metalTexture->texture;
 
         if (metalTexture->externalImage.isValid()) {
@@ -1270,14 +1278,14 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
 void MetalDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
             "beginTimerQuery must be called outside of a render pass.");
-    auto* tq = handle_cast<MetalTimerQuery>(mHandleMap, tqh);
+    auto* tq = handle_cast<MetalTimerQuery>(tqh);
     mContext->timerQueryImpl->beginTimeElapsedQuery(tq);
 }
 
 void MetalDriver::endTimerQuery(Handle<HwTimerQuery> tqh) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
             "endTimerQuery must be called outside of a render pass.");
-    auto* tq = handle_cast<MetalTimerQuery>(mHandleMap, tqh);
+    auto* tq = handle_cast<MetalTimerQuery>(tqh);
     mContext->timerQueryImpl->endTimeElapsedQuery(tq);
 }
 
@@ -1319,7 +1327,7 @@ void MetalDriver::enumerateBoundUniformBuffers(
         if (!thisUniform.bound) {
             continue;
         }
-        auto* uniform = handle_cast<MetalUniformBuffer>(mHandleMap, thisUniform.ubh);
+        auto* uniform = handle_cast<MetalUniformBuffer>(thisUniform.ubh);
         f(thisUniform, uniform, i);
     }
 }
@@ -279,6 +279,13 @@ private:
     uint64_t value;
 };
 
+struct MetalSync : public HwSync {
+    // A sync is a fence behind an HwSync handle. It is constructed on the Filament thread and
+    // encoded on the driver thread, exactly like MetalFence.
+    explicit MetalSync(MetalContext& context) : fence(context) {}
+    MetalFence fence;
+};
+
 struct MetalTimerQuery : public HwTimerQuery {
     MetalTimerQuery() : status(std::make_shared<Status>()) {}
 
@@ -17,6 +17,8 @@
 #include "noop/NoopDriver.h"
 #include "CommandStreamDispatcher.h"
 
+#include <limits>
+
 namespace filament {
 
 using namespace backend;
@@ -164,6 +166,10 @@ bool NoopDriver::areFeedbackLoopsSupported() {
     return true;
 }
 
+size_t NoopDriver::getMaxUniformBufferSize() {
+    return std::numeric_limits<uint32_t>::max();
+}
+
 math::float2 NoopDriver::getClipSpaceParams() {
     return math::float2{ -1.0f, 0.0f };
 }
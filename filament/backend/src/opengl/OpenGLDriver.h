@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DRIVER_OPENGLDRIVER_H
 
 #include "private/backend/Driver.h"
+#include "private/backend/HandleAllocator.h"
 #include "DriverBase.h"
 #include "OpenGLContext.h"
 
@@ -240,30 +241,11 @@ private:
 
     // Memory management...
 
-    class HandleAllocator {
-        utils::PoolAllocator< 16, 16>   mPool0;
-        utils::PoolAllocator< 64, 32>   mPool1;
-        utils::PoolAllocator<208, 32>   mPool2;
-    public:
-        static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
-        explicit HandleAllocator(const utils::HeapArea& area);
-        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
-        void free(void* p, size_t size) noexcept;
-    };
-
-    // the arenas for handle allocation needs to be thread-safe
-#ifndef NDEBUG
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock,
-            utils::TrackingPolicy::Debug>;
-#else
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock>;
-#endif
-
-    HandleArena mHandleArena;
-
-    backend::HandleBase::HandleId allocateHandle(size_t size) noexcept;
+    // the small pool fits fences, index buffers and sampler groups, the medium pool fits
+    // primitives, textures, programs and render targets, the large pool fits vertex buffers,
+    // streams and uniform buffers.
+    using HandleAllocator = backend::HandleAllocator<16, 64, 208>;
+    HandleAllocator mHandleAllocator;
 
     template<typename D, typename ... ARGS>
     backend::Handle<D> initHandle(ARGS&& ... args) noexcept;
@@ -289,13 +271,7 @@ private:
             std::is_pointer<Dp>::value &&
             std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
     handle_cast(backend::Handle<B>& handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        char* const base = (char *)mHandleArena.getArea().begin();
-        size_t offset = handle.getId() << HandleAllocator::MIN_ALIGNMENT_SHIFT;
-        // assert that this handle is even a valid one
-        assert(base + offset + sizeof(typename std::remove_pointer<Dp>::type) <= (char *)mHandleArena.getArea().end());
-        return static_cast<Dp>(static_cast<void *>(base + offset));
+        return mHandleAllocator.handle_cast<Dp>(handle);
     }
 
     template<typename Dp, typename B>
@@ -68,22 +68,34 @@ VulkanBinder::~VulkanBinder() {
 }
 
 bool VulkanBinder::getOrCreateDescriptors(VkDescriptorSet descriptorSets[3],
-        VkPipelineLayout* pipelineLayout) noexcept {
+        VkPipelineLayout* pipelineLayout, uint32_t dynamicOffsets[UBUFFER_BINDING_COUNT]) noexcept {
     // If this method has never been called before, we need to create a new layout object.
     if (!mPipelineLayout) {
         createLayoutsAndDescriptors();
     }
 
+    // Uniform buffers are dynamic descriptors, so the offsets are always needed at bind time.
+    for (uint32_t binding = 0; binding < UBUFFER_BINDING_COUNT; binding++) {
+        dynamicOffsets[binding] = mDynamicOffsets[binding];
+    }
+
     // If no bindings have been dirtied, update the timestamp (most recent access) and return false
-    // to indicate there's no need to re-bind.
+    // to indicate there's no need to re-bind, unless the dynamic offsets have changed.
     if (!mDirtyDescriptor) {
         assert(mCurrentDescriptorBundle && mCurrentDescriptorBundle->bound);
         descriptorSets[0] = mCurrentDescriptorBundle->handles[0];
         descriptorSets[1] = mCurrentDescriptorBundle->handles[1];
         descriptorSets[2] = mCurrentDescriptorBundle->handles[2];
         mCurrentDescriptorBundle->timestamp = mCurrentTime;
+        if (mDirtyDynamicOffsets) {
+            mDirtyDynamicOffsets = false;
+            mDescriptorStats.offsetRebinds++;
+            *pipelineLayout = mPipelineLayout;
+            return true;
+        }
         return false;
     }
+    mDirtyDynamicOffsets = false;
 
     // Release the previously bound descriptor and update its time stamp.
     if (mCurrentDescriptorBundle) {
@@ -103,10 +115,13 @@ bool VulkanBinder::getOrCreateDescriptors(VkDescriptorSet descriptorSets[3],
         mCurrentDescriptorBundle->timestamp = mCurrentTime;
         mCurrentDescriptorBundle->bound = true;
         mDirtyDescriptor = false;
+        mDescriptorStats.hits++;
         *pipelineLayout = mPipelineLayout;
         return true;
     }
 
+    mDescriptorStats.misses++;
+
     // Allocate one descriptor set for each type: uniforms, samplers, and input attachments.
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -137,7 +152,7 @@ bool VulkanBinder::getOrCreateDescriptors(VkDescriptorSet descriptorSets[3],
         if (mDescriptorKey.uniformBuffers[binding]) {
             VkDescriptorBufferInfo& bufferInfo = mDescriptorBuffers[binding];
             bufferInfo.buffer = mDescriptorKey.uniformBuffers[binding];
-            bufferInfo.offset = mDescriptorKey.uniformBufferOffsets[binding];
+            bufferInfo.offset = 0;
             bufferInfo.range = mDescriptorKey.uniformBufferSizes[binding];
             VkWriteDescriptorSet& writeInfo = writes[nwrites++];
             writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -146,7 +161,7 @@ bool VulkanBinder::getOrCreateDescriptors(VkDescriptorSet descriptorSets[3],
             writeInfo.dstBinding = binding;
             writeInfo.dstArrayElement = 0;
             writeInfo.descriptorCount = 1;
-            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             writeInfo.pImageInfo = nullptr;
             writeInfo.pBufferInfo = &bufferInfo;
             writeInfo.pTexelBufferView = nullptr;
@@ -299,13 +314,32 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
             << mShaderStages[0].module << ", " << mShaderStages[1].module << ")" << utils::io::endl;
     #endif
 
-    VkResult err = vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
+    VkPipelineCreationFeedbackEXT creationFeedback = {};
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT,
+        .pPipelineCreationFeedback = &creationFeedback,
+    };
+    if (mPipelineCreationFeedback) {
+        pipelineCreateInfo.pNext = &feedbackInfo;
+    }
+
+    VkResult err = vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCreateInfo,
             VKALLOC, pipeline);
     if (err) {
         utils::slog.e << "vkCreateGraphicsPipelines error " << err << utils::io::endl;
         utils::debug_trap();
     }
 
+    mPipelineStats.created++;
+    if (creationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) {
+        if (creationFeedback.flags &
+                VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+            mPipelineStats.cacheHits++;
+        } else {
+            mPipelineStats.cacheMisses++;
+        }
+    }
+
     // Here we construct a PipelineVal in place, then stash its pointer to allow fast subsequent
     // calls to getOrCreatePipeline when nothing has been dirtied. Note that the robin_map
     // iterator type proffers a "value" method, which returns a stable reference.
@@ -401,12 +435,12 @@ void VulkanBinder::unbindUniformBuffer(VkBuffer uniformBuffer) noexcept {
         if (key.uniformBuffers[bindingIndex] == uniformBuffer) {
             key.uniformBuffers[bindingIndex] = {};
             key.uniformBufferSizes[bindingIndex] = {};
-            key.uniformBufferOffsets[bindingIndex] = {};
+            mDynamicOffsets[bindingIndex] = 0;
             mDirtyDescriptor = true;
         }
     }
     // This function is often called before deleting a uniform buffer. For safety, we need to evict
-    // all descriptors that refer to the extinct uniform buffer, regardless of the binding offsets.
+    // all descriptors that refer to the extinct uniform buffer, regardless of the binding sizes.
     evictDescriptors([uniformBuffer] (const DescriptorKey& key) {
         for (VkBuffer buf : key.uniformBuffers) {
             if (buf == uniformBuffer) {
@@ -469,15 +503,20 @@ void VulkanBinder::bindUniformBuffer(uint32_t bindingIndex, VkBuffer uniformBuff
     ASSERT_POSTCONDITION(bindingIndex < UBUFFER_BINDING_COUNT,
             "Uniform bindings overflow: index = %d, capacity = %d.",
             bindingIndex, UBUFFER_BINDING_COUNT);
+    // The descriptor is written with a zero offset and the offset is applied at bind time, so a
+    // VK_WHOLE_SIZE range would always overflow a dynamic offset.
+    assert(offset == 0 || size != VK_WHOLE_SIZE);
     auto& key = mDescriptorKey;
     if (key.uniformBuffers[bindingIndex] != uniformBuffer ||
-        key.uniformBufferOffsets[bindingIndex] != offset ||
         key.uniformBufferSizes[bindingIndex] != size) {
         key.uniformBuffers[bindingIndex] = uniformBuffer;
-        key.uniformBufferOffsets[bindingIndex] = offset;
         key.uniformBufferSizes[bindingIndex] = size;
         mDirtyDescriptor = true;
     }
+    if (mDynamicOffsets[bindingIndex] != offset) {
+        mDynamicOffsets[bindingIndex] = (uint32_t) offset;
+        mDirtyDynamicOffsets = true;
+    }
 }
 
 void VulkanBinder::bindSamplers(VkDescriptorImageInfo samplers[SAMPLER_BINDING_COUNT]) noexcept {
@@ -512,6 +551,15 @@ void VulkanBinder::destroyCache() noexcept {
     for (auto& iter : mPipelines) {
         vkDestroyPipeline(mDevice, iter.second.handle, VKALLOC);
     }
+
+    #ifndef NDEBUG
+    if (mPipelineStats.created > 0) {
+        utils::slog.d << "Created " << mPipelineStats.created << " pipelines, "
+                << mPipelineStats.cacheHits << " pipeline cache hits, "
+                << mPipelineStats.cacheMisses << " pipeline cache misses." << utils::io::endl;
+    }
+    #endif
+
     mPipelines.clear();
     mCurrentPipeline = nullptr;
     mDirtyPipeline = true;
@@ -520,6 +568,7 @@ void VulkanBinder::destroyCache() noexcept {
 void VulkanBinder::resetBindings() noexcept {
     mDirtyPipeline = true;
     mDirtyDescriptor = true;
+    mDirtyDynamicOffsets = true;
 }
 
 // Frees up old descriptor sets and pipelines, then nulls out their key.
@@ -578,8 +627,10 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
     binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS; // NOTE: This is potentially non-optimal.
 
     // First create the descriptor set layout for UBO's.
+    // UBO's are dynamic descriptors, which lets renderables that share a material instance but use
+    // different ranges of a uniform buffer share the same descriptor set.
     VkDescriptorSetLayoutBinding ubindings[UBUFFER_BINDING_COUNT];
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     for (uint32_t i = 0; i < UBUFFER_BINDING_COUNT; i++) {
         binding.binding = i;
         ubindings[i] = binding;
@@ -632,7 +683,7 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
         .poolSizeCount = 3,
         .pPoolSizes = poolSizes
     };
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     poolSizes[0].descriptorCount = poolInfo.maxSets * UBUFFER_BINDING_COUNT;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = poolInfo.maxSets * SAMPLER_BINDING_COUNT;
@@ -651,8 +702,10 @@ void VulkanBinder::destroyLayoutsAndDescriptors() noexcept {
     // Our current descriptor set strategy can cause the # of descriptor sets to explode in certain
     // situations, so it's interesting to report the number that get stuffed into the cache.
     #ifndef NDEBUG
-    utils::slog.d << "Destroying " << mDescriptorBundles.size() << " bundles of descriptor sets."
-            << utils::io::endl;
+    utils::slog.d << "Destroying " << mDescriptorBundles.size() << " bundles of descriptor sets, "
+            << mDescriptorStats.hits << " descriptor cache hits, "
+            << mDescriptorStats.misses << " descriptor cache misses, "
+            << mDescriptorStats.offsetRebinds << " dynamic offset rebinds." << utils::io::endl;
     #endif
 
     mDescriptorBundles.clear();
@@ -677,7 +730,6 @@ bool VulkanBinder::DescEqual::operator()(const VulkanBinder::DescriptorKey& k1,
         const VulkanBinder::DescriptorKey& k2) const {
     for (uint32_t i = 0; i < UBUFFER_BINDING_COUNT; i++) {
         if (k1.uniformBuffers[i] != k2.uniformBuffers[i] ||
-            k1.uniformBufferOffsets[i] != k2.uniformBufferOffsets[i] ||
             k1.uniformBufferSizes[i] != k2.uniformBufferSizes[i]) {
             return false;
         }
@@ -50,8 +50,9 @@ namespace backend {
 //        mBinder.bindPrimitiveTopology(geo.topology);
 //        mBinder.bindVertexArray(geo.varray);
 //        VkDescriptorSet descriptors[3];
-//        if (mBinder.getOrCreateDescriptors(descriptors, ...)) {
-//            vkCmdBindDescriptorSets(... descriptors ...);
+//        uint32_t offsets[VulkanBinder::UBUFFER_BINDING_COUNT];
+//        if (mBinder.getOrCreateDescriptors(descriptors, ..., offsets)) {
+//            vkCmdBindDescriptorSets(... descriptors ..., offsets);
 //        }
 //        VkPipeline pipeline;
 //        if (mBinder.getOrCreatePipeline(&pipeline)) {
@@ -107,6 +108,24 @@ public:
     };
     static_assert(std::is_pod<RasterState>::value, "RasterState must be a POD for fast hashing.");
 
+    // Counters that reflect the effectiveness of the pipeline caches. Hits and misses in the
+    // persistent VkPipelineCache are only known when VK_EXT_pipeline_creation_feedback is
+    // available, otherwise both stay at zero.
+    struct PipelineStats {
+        uint32_t created;     // number of calls to vkCreateGraphicsPipelines
+        uint32_t cacheHits;   // pipelines that were found in the VkPipelineCache
+        uint32_t cacheMisses; // pipelines that were compiled from scratch
+    };
+
+    // Counters that reflect the effectiveness of the descriptor set cache. Uniform buffer offsets
+    // are not part of the descriptor key, so binding a different range of the same UBO only
+    // requires a re-bind with new dynamic offsets (offsetRebinds).
+    struct DescriptorStats {
+        uint32_t hits;          // descriptor sets found in the cache
+        uint32_t misses;        // descriptor sets allocated and written with vkUpdateDescriptorSets
+        uint32_t offsetRebinds; // re-binds where only the dynamic offsets changed
+    };
+
     // Upon construction, the binder initializes some internal state but does not make any Vulkan
     // calls. On destruction it will free any cached Vulkan objects that haven't already been freed
     // via resetBindings(). We don't pass the VkDevice to the constructor to allow the client to own
@@ -115,13 +134,24 @@ public:
     ~VulkanBinder();
     void setDevice(VkDevice device) { mDevice = device; }
 
+    // Sets the VkPipelineCache used when creating pipelines. The binder does not own the cache.
+    // If creationFeedback is true, VK_EXT_pipeline_creation_feedback is used to gather statistics.
+    void setPipelineCache(VkPipelineCache cache, bool creationFeedback) {
+        mPipelineCache = cache;
+        mPipelineCreationFeedback = creationFeedback;
+    }
+
+    const PipelineStats& getPipelineStats() const noexcept { return mPipelineStats; }
+    const DescriptorStats& getDescriptorStats() const noexcept { return mDescriptorStats; }
+
     // Clients should initialize their copy of the raster state using this method. They can then
     // mutate their copy and pass it back through bindRasterState().
     const RasterState& getDefaultRasterState() const { return mDefaultRasterState; }
 
-    // Returns true if vkCmdBindDescriptorSets is required.
-    bool getOrCreateDescriptors(VkDescriptorSet descriptors[3], VkPipelineLayout* pipelineLayout)
-            noexcept;
+    // Returns true if vkCmdBindDescriptorSets is required. Uniform buffers are bound as dynamic
+    // descriptors, the offsets to pass to vkCmdBindDescriptorSets are returned in dynamicOffsets.
+    bool getOrCreateDescriptors(VkDescriptorSet descriptors[3], VkPipelineLayout* pipelineLayout,
+            uint32_t dynamicOffsets[UBUFFER_BINDING_COUNT]) noexcept;
 
     // Returns true if any pipeline bindings have changed. (i.e., vkCmdBindPipeline is required)
     bool getOrCreatePipeline(VkPipeline* pipeline) noexcept;
@@ -193,13 +223,13 @@ private:
 
     // The descriptor key is a POD that represents all currently bound states that go into the
     // descriptor set. We apply a hash function to its contents only if has been mutated since
-    // the previous call to getOrCreateDescriptors.
+    // the previous call to getOrCreateDescriptors. Uniform buffer offsets are not part of the key
+    // since they are supplied at bind time, as dynamic offsets.
     #pragma pack(push, 1)
     struct UTILS_PACKED DescriptorKey {
         VkBuffer uniformBuffers[UBUFFER_BINDING_COUNT];
         VkDescriptorImageInfo samplers[SAMPLER_BINDING_COUNT];
         VkDescriptorImageInfo inputAttachments[TARGET_BINDING_COUNT];
-        VkDeviceSize uniformBufferOffsets[UBUFFER_BINDING_COUNT];
         VkDeviceSize uniformBufferSizes[UBUFFER_BINDING_COUNT];
     };
     #pragma pack(pop)
@@ -224,6 +254,10 @@ private:
     void evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept;
 
     VkDevice mDevice = nullptr;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    bool mPipelineCreationFeedback = false;
+    PipelineStats mPipelineStats = {};
+    DescriptorStats mDescriptorStats = {};
     const RasterState mDefaultRasterState;
 
     // These structs are used only in a transient way but are stored for convenience.
@@ -241,6 +275,7 @@ private:
     // uniform buffers).
     PipelineKey mPipelineKey;
     DescriptorKey mDescriptorKey;
+    uint32_t mDynamicOffsets[UBUFFER_BINDING_COUNT] = {};
 
     // Weak references to the currently bound pipeline and descriptor sets.
     PipelineVal* mCurrentPipeline = nullptr;
@@ -250,6 +285,7 @@ private:
     // a new pipeline or descriptor set needs to be retrieved from the cache or created.
     bool mDirtyPipeline = true;
     bool mDirtyDescriptor = true;
+    bool mDirtyDynamicOffsets = true;
 
     // Cached Vulkan objects. These objects are owned by the Binder.
     VkDescriptorSetLayout mDescriptorSetLayouts[3] = {};
@@ -45,16 +45,12 @@ VulkanBuffer::~VulkanBuffer() {
 
 void VulkanBuffer::loadFromCpu(const void* cpuData, uint32_t byteOffset, uint32_t numBytes) {
     assert(byteOffset == 0);
-    VulkanStage const* stage = mStagePool.acquireStage(numBytes);
-    void* mapped;
-    vmaMapMemory(mContext.allocator, stage->memory, &mapped);
-    memcpy(mapped, cpuData, numBytes);
-    vmaUnmapMemory(mContext.allocator, stage->memory);
-    vmaFlushAllocation(mContext.allocator, stage->memory, byteOffset, numBytes);
+    VulkanStageRange const stage = mStagePool.acquireStageRange(numBytes);
+    memcpy(stage.mapping, cpuData, numBytes);
 
     auto copyToDevice = [this, numBytes, stage] (VulkanCommandBuffer& commands) {
-        VkBufferCopy region { .size = numBytes };
-        vkCmdCopyBuffer(commands.cmdbuffer, stage->buffer, mGpuBuffer, 1, &region);
+        VkBufferCopy region { .srcOffset = stage.offset, .size = numBytes };
+        vkCmdCopyBuffer(commands.cmdbuffer, stage.buffer, mGpuBuffer, 1, &region);
         mDisposer.acquire(mDisposerKey, commands.resources);
 
         // Ensure that the copy finishes before the next draw call.
@@ -70,7 +66,7 @@ void VulkanBuffer::loadFromCpu(const void* cpuData, uint32_t byteOffset, uint32_
         vkCmdPipelineBarrier(commands.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 
-        mStagePool.releaseStage(stage, commands);
+        mStagePool.releaseStageRange(stage, commands);
     };
 
     // If inside beginFrame / endFrame, use the swap context, otherwise use the work cmdbuffer.
@@ -118,6 +118,7 @@ void selectPhysicalDevice(VulkanContext& context) {
         ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkEnumerateDeviceExtensionProperties error.");
         bool supportsSwapchain = false;
         context.debugMarkersSupported = false;
+        context.pipelineCreationFeedbackSupported = false;
         for (uint32_t k = 0; k < extensionCount; ++k) {
             if (!strcmp(extensions[k].extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
                 supportsSwapchain = true;
@@ -125,6 +126,10 @@ void selectPhysicalDevice(VulkanContext& context) {
             if (!strcmp(extensions[k].extensionName, VK_EXT_DEBUG_MARKER_EXTENSION_NAME)) {
                 context.debugMarkersSupported = true;
             }
+            if (!strcmp(extensions[k].extensionName,
+                    VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)) {
+                context.pipelineCreationFeedbackSupported = true;
+            }
         }
         if (!supportsSwapchain) continue;
 
@@ -190,6 +195,9 @@ void createLogicalDevice(VulkanContext& context) {
     if (context.debugMarkersSupported && !context.debugUtilsSupported) {
         deviceExtensionNames.push_back(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
     }
+    if (context.pipelineCreationFeedbackSupported) {
+        deviceExtensionNames.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    }
     deviceQueueCreateInfo->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     deviceQueueCreateInfo->queueFamilyIndex = context.graphicsQueueFamilyIndex;
     deviceQueueCreateInfo->queueCount = 1;
@@ -848,5 +856,93 @@ void createEmptyTexture(VulkanContext& context, VulkanStagePool& stagePool) {
     context.emptyTexture->update2DImage(pbd, 1, 1, 0);
 }
 
+// The key under which the pipeline cache is stored in the platform's blob cache. The contents are
+// device-specific, but the blob carries its own header which we validate upon retrieval.
+static constexpr const char PIPELINE_CACHE_BLOB_KEY[] = "filament.vulkan.pipeline_cache";
+
+// Vulkan 1.0 guarantees that the pipeline cache data starts with the following header, see
+// VkPipelineCacheHeaderVersion in the specification.
+struct PipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+static_assert(sizeof(PipelineCacheHeader) == 16 + VK_UUID_SIZE,
+        "PipelineCacheHeader must match the layout mandated by the Vulkan specification.");
+
+static bool isPipelineCacheValid(const VkPhysicalDeviceProperties& props,
+        const uint8_t* data, size_t size) {
+    PipelineCacheHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    return header.headerSize >= sizeof(header) && header.headerSize <= size &&
+            header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            header.vendorID == props.vendorID &&
+            header.deviceID == props.deviceID &&
+            !memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+void createPipelineCache(VulkanContext& context, Platform& platform) {
+    std::vector<uint8_t> data;
+    if (platform.hasBlobFunc()) {
+        const size_t size = platform.retrieveBlob(PIPELINE_CACHE_BLOB_KEY,
+                sizeof(PIPELINE_CACHE_BLOB_KEY), nullptr, 0);
+        if (size > 0) {
+            data.resize(size);
+            if (platform.retrieveBlob(PIPELINE_CACHE_BLOB_KEY, sizeof(PIPELINE_CACHE_BLOB_KEY),
+                    data.data(), size) != size) {
+                data.clear();
+            }
+        }
+        if (!data.empty() &&
+                !isPipelineCacheValid(context.physicalDeviceProperties, data.data(), data.size())) {
+            utils::slog.i << "Discarding stale Vulkan pipeline cache." << utils::io::endl;
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data()
+    };
+    VkResult result = vkCreatePipelineCache(context.device, &createInfo, VKALLOC,
+            &context.pipelineCache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // Some drivers reject data they consider corrupt; fall back to an empty cache.
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(context.device, &createInfo, VKALLOC,
+                &context.pipelineCache);
+    }
+    ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkCreatePipelineCache error.");
+}
+
+void destroyPipelineCache(VulkanContext& context, Platform& platform) {
+    if (context.pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+    if (platform.hasBlobFunc()) {
+        size_t size = 0;
+        vkGetPipelineCacheData(context.device, context.pipelineCache, &size, nullptr);
+        if (size > 0) {
+            std::vector<uint8_t> data(size);
+            VkResult result = vkGetPipelineCacheData(context.device, context.pipelineCache, &size,
+                    data.data());
+            if (result == VK_SUCCESS && size > 0) {
+                platform.insertBlob(PIPELINE_CACHE_BLOB_KEY, sizeof(PIPELINE_CACHE_BLOB_KEY),
+                        data.data(), size);
+            }
+        }
+    }
+    vkDestroyPipelineCache(context.device, context.pipelineCache, VKALLOC);
+    context.pipelineCache = VK_NULL_HANDLE;
+}
+
 } // namespace filament
 } // namespace backend
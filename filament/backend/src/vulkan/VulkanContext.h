@@ -21,6 +21,7 @@
 #include "VulkanDisposer.h"
 
 #include <backend/DriverEnums.h>
+#include <backend/Platform.h>
 
 #include <bluevk/BlueVK.h>
 
@@ -105,6 +106,7 @@ struct VulkanContext {
     VkQueue graphicsQueue;
     bool debugMarkersSupported;
     bool debugUtilsSupported;
+    bool pipelineCreationFeedbackSupported;
     VulkanBinder::RasterState rasterState;
     VulkanCommandBuffer* currentCommands;
     VulkanSurfaceContext* currentSurface;
@@ -114,6 +116,9 @@ struct VulkanContext {
     VmaAllocator allocator;
     VulkanTexture* emptyTexture = nullptr;
 
+    // Persistent pipeline cache, seeded from (and written back to) the Platform's blob cache.
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
     // The work context is used for activities unrelated to the swap chain or draw calls, such as
     // uploads, blits, and transitions.
     VulkanCommandBuffer work;
@@ -180,6 +185,13 @@ void createFinalDepthBuffer(VulkanContext& context, VulkanSurfaceContext& sc, Vk
 VkImageLayout getTextureLayout(TextureUsage usage);
 void createEmptyTexture(VulkanContext& context, VulkanStagePool& stagePool);
 
+// Creates the VkPipelineCache, seeding it with the blob stored in the platform if the blob's header
+// matches the current device. Otherwise the cache starts out empty.
+void createPipelineCache(VulkanContext& context, Platform& platform);
+
+// Writes the contents of the VkPipelineCache back into the platform, then destroys it.
+void destroyPipelineCache(VulkanContext& context, Platform& platform);
+
 } // namespace filament
 } // namespace backend
 
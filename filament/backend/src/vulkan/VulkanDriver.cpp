@@ -96,10 +96,37 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
         const char* const* ppEnabledExtensions, uint32_t enabledExtensionCount) noexcept :
         DriverBase(new ConcreteDispatcher<VulkanDriver>()),
         mContextManager(*platform),
+        mHandleAllocator("Handles", FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U),
         mBlitter(mContext),
         mStagePool(mContext, mDisposer),
         mFramebufferCache(mContext),
         mSamplerCache(mContext) {
+    // every handle type must fit in the large pool of the handle allocator
+    static_assert(sizeof(VulkanProgram) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanProgram too large");
+    static_assert(sizeof(VulkanRenderTarget) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanRenderTarget too large");
+    static_assert(sizeof(VulkanSwapChain) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanSwapChain too large");
+    static_assert(sizeof(VulkanVertexBuffer) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanVertexBuffer too large");
+    static_assert(sizeof(VulkanIndexBuffer) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanIndexBuffer too large");
+    static_assert(sizeof(VulkanUniformBuffer) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanUniformBuffer too large");
+    static_assert(sizeof(VulkanSamplerGroup) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanSamplerGroup too large");
+    static_assert(sizeof(VulkanTexture) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanTexture too large");
+    static_assert(sizeof(VulkanRenderPrimitive) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanRenderPrimitive too large");
+    static_assert(sizeof(VulkanFence) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanFence too large");
+    static_assert(sizeof(VulkanSync) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanSync too large");
+    static_assert(sizeof(VulkanTimerQuery) <= HandleAllocator::MAX_HANDLE_SIZE,
+            "VulkanTimerQuery too large");
+
     mContext.rasterState = mBinder.getDefaultRasterState();
 
     // Load Vulkan entry points.
@@ -203,7 +230,9 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
 
     // Initialize device and graphicsQueue.
     createLogicalDevice(mContext);
+    createPipelineCache(mContext, mContextManager);
     mBinder.setDevice(mContext.device);
+    mBinder.setPipelineCache(mContext.pipelineCache, mContext.pipelineCreationFeedbackSupported);
     createEmptyTexture(mContext, mStagePool);
 
     // Choose a depth format that meets our requirements. Take care not to include stencil formats
@@ -278,6 +307,7 @@ void VulkanDriver::terminate() {
     mBinder.destroyCache();
     mFramebufferCache.reset();
     mSamplerCache.reset();
+    destroyPipelineCache(mContext, mContextManager);
 
     vmaDestroyAllocator(mContext.allocator);
     vkDestroyQueryPool(mContext.device, mContext.timestamps.pool, VKALLOC);
@@ -399,21 +429,21 @@ void VulkanDriver::finish(int) {
 }
 
 void VulkanDriver::createSamplerGroupR(Handle<HwSamplerGroup> sbh, size_t count) {
-    construct_handle<VulkanSamplerGroup>(mHandleMap, sbh, mContext, count);
+    construct_handle<VulkanSamplerGroup>(sbh, mContext, count);
 }
 
 void VulkanDriver::createUniformBufferR(Handle<HwUniformBuffer> ubh, size_t size,
         BufferUsage usage) {
-    auto uniformBuffer = construct_handle<VulkanUniformBuffer>(mHandleMap, ubh, mContext,
+    auto uniformBuffer = construct_handle<VulkanUniformBuffer>(ubh, mContext,
             mStagePool, mDisposer, size, usage);
     mDisposer.createDisposable(uniformBuffer, [this, ubh] () {
-        destruct_handle<VulkanUniformBuffer>(mHandleMap, ubh);
+        destruct_handle<VulkanUniformBuffer>(ubh);
     });
 }
 
 void VulkanDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
     if (ubh) {
-        auto buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        auto buffer = handle_cast<VulkanUniformBuffer>(ubh);
         mBinder.unbindUniformBuffer(buffer->getGpuBuffer());
 
         // We do not know if any pending draw calls are making use of this uniform buffer,
@@ -429,28 +459,28 @@ void VulkanDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
 }
 
 void VulkanDriver::createRenderPrimitiveR(Handle<HwRenderPrimitive> rph, int) {
-    construct_handle<VulkanRenderPrimitive>(mHandleMap, rph, mContext);
+    construct_handle<VulkanRenderPrimitive>(rph, mContext);
 }
 
 void VulkanDriver::destroyRenderPrimitive(Handle<HwRenderPrimitive> rph) {
     if (rph) {
-        destruct_handle<VulkanRenderPrimitive>(mHandleMap, rph);
+        destruct_handle<VulkanRenderPrimitive>(rph);
     }
 }
 
 void VulkanDriver::createVertexBufferR(Handle<HwVertexBuffer> vbh, uint8_t bufferCount,
         uint8_t attributeCount, uint32_t elementCount, AttributeArray attributes,
         BufferUsage usage) {
-    auto vertexBuffer = construct_handle<VulkanVertexBuffer>(mHandleMap, vbh, mContext, mStagePool,
+    auto vertexBuffer = construct_handle<VulkanVertexBuffer>(vbh, mContext, mStagePool,
             mDisposer, bufferCount, attributeCount, elementCount, attributes);
     mDisposer.createDisposable(vertexBuffer, [this, vbh] () {
-        destruct_handle<VulkanVertexBuffer>(mHandleMap, vbh);
+        destruct_handle<VulkanVertexBuffer>(vbh);
     });
 }
 
 void VulkanDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
     if (vbh) {
-        auto vertexBuffer = handle_cast<VulkanVertexBuffer>(mHandleMap, vbh);
+        auto vertexBuffer = handle_cast<VulkanVertexBuffer>(vbh);
         mDisposer.removeReference(vertexBuffer);
     }
 }
@@ -458,16 +488,16 @@ void VulkanDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
 void VulkanDriver::createIndexBufferR(Handle<HwIndexBuffer> ibh,
         ElementType elementType, uint32_t indexCount, BufferUsage usage) {
     auto elementSize = (uint8_t) getElementTypeSize(elementType);
-    auto indexBuffer = construct_handle<VulkanIndexBuffer>(mHandleMap, ibh, mContext, mStagePool,
+    auto indexBuffer = construct_handle<VulkanIndexBuffer>(ibh, mContext, mStagePool,
             mDisposer, elementSize, indexCount);
     mDisposer.createDisposable(indexBuffer, [this, ibh] () {
-        destruct_handle<VulkanIndexBuffer>(mHandleMap, ibh);
+        destruct_handle<VulkanIndexBuffer>(ibh);
     });
 }
 
 void VulkanDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
     if (ibh) {
-        auto indexBuffer = handle_cast<VulkanIndexBuffer>(mHandleMap, ibh);
+        auto indexBuffer = handle_cast<VulkanIndexBuffer>(ibh);
         mDisposer.removeReference(indexBuffer);
     }
 }
@@ -475,10 +505,10 @@ void VulkanDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
 void VulkanDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
         TextureUsage usage) {
-    auto vktexture = construct_handle<VulkanTexture>(mHandleMap, th, mContext, target, levels,
+    auto vktexture = construct_handle<VulkanTexture>(th, mContext, target, levels,
             format, samples, w, h, depth, usage, mStagePool);
     mDisposer.createDisposable(vktexture, [this, th] () {
-        destruct_handle<VulkanTexture>(mHandleMap, th);
+        destruct_handle<VulkanTexture>(th);
     });
 }
 
@@ -486,10 +516,10 @@ void VulkanDriver::createTextureSwizzledR(Handle<HwTexture> th, SamplerType targ
         TextureFormat format, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
         TextureUsage usage,
         TextureSwizzle r, TextureSwizzle g, TextureSwizzle b, TextureSwizzle a) {
-    auto vktexture = construct_handle<VulkanTexture>(mHandleMap, th, mContext, target, levels,
+    auto vktexture = construct_handle<VulkanTexture>(th, mContext, target, levels,
             format, samples, w, h, depth, usage, mStagePool);
     mDisposer.createDisposable(vktexture, [this, th] () {
-        destruct_handle<VulkanTexture>(mHandleMap, th);
+        destruct_handle<VulkanTexture>(th);
     });
     // TODO: implement texture swizzling
 }
@@ -503,29 +533,29 @@ void VulkanDriver::importTextureR(Handle<HwTexture> th, intptr_t id,
 
 void VulkanDriver::destroyTexture(Handle<HwTexture> th) {
     if (th) {
-        auto texture = handle_cast<VulkanTexture>(mHandleMap, th);
+        auto texture = handle_cast<VulkanTexture>(th);
         mBinder.unbindImageView(texture->getPrimaryImageView());
         mDisposer.removeReference(texture);
     }
 }
 
 void VulkanDriver::createProgramR(Handle<HwProgram> ph, Program&& program) {
-    auto vkprogram = construct_handle<VulkanProgram>(mHandleMap, ph, mContext, program);
+    auto vkprogram = construct_handle<VulkanProgram>(ph, mContext, program);
     mDisposer.createDisposable(vkprogram, [this, ph] () {
-        destruct_handle<VulkanProgram>(mHandleMap, ph);
+        destruct_handle<VulkanProgram>(ph);
     });
 }
 
 void VulkanDriver::destroyProgram(Handle<HwProgram> ph) {
     if (ph) {
-        mDisposer.removeReference(handle_cast<VulkanProgram>(mHandleMap, ph));
+        mDisposer.removeReference(handle_cast<VulkanProgram>(ph));
     }
 }
 
 void VulkanDriver::createDefaultRenderTargetR(Handle<HwRenderTarget> rth, int) {
-    auto renderTarget = construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext);
+    auto renderTarget = construct_handle<VulkanRenderTarget>(rth, mContext);
     mDisposer.createDisposable(renderTarget, [this, rth] () {
-        destruct_handle<VulkanRenderTarget>(mHandleMap, rth);
+        destruct_handle<VulkanRenderTarget>(rth);
     });
 }
 
@@ -535,7 +565,7 @@ void VulkanDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
     VulkanAttachment colorTargets[MRT::TARGET_COUNT] = {};
     for (int i = 0; i < MRT::TARGET_COUNT; i++) {
         if (color[i].handle) {
-            colorTargets[i].texture = handle_cast<VulkanTexture>(mHandleMap, color[i].handle);
+            colorTargets[i].texture = handle_cast<VulkanTexture>(color[i].handle);
         }
         colorTargets[i].level = color[i].level;
         colorTargets[i].layer = color[i].layer;
@@ -543,25 +573,25 @@ void VulkanDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
 
     VulkanAttachment depthStencil[2] = {};
     TextureHandle handle = depth.handle;
-    depthStencil[0].texture = handle ? handle_cast<VulkanTexture>(mHandleMap, handle) : nullptr;
+    depthStencil[0].texture = handle ? handle_cast<VulkanTexture>(handle) : nullptr;
     depthStencil[0].level = depth.level;
     depthStencil[0].layer = depth.layer;
 
     handle = stencil.handle;
-    depthStencil[1].texture = handle ? handle_cast<VulkanTexture>(mHandleMap, handle) : nullptr;
+    depthStencil[1].texture = handle ? handle_cast<VulkanTexture>(handle) : nullptr;
     depthStencil[1].level = stencil.level;
     depthStencil[1].layer = stencil.layer;
 
-    auto renderTarget = construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext,
+    auto renderTarget = construct_handle<VulkanRenderTarget>(rth, mContext,
             width, height, samples, colorTargets, depthStencil, mStagePool);
     mDisposer.createDisposable(renderTarget, [this, rth] () {
-        destruct_handle<VulkanRenderTarget>(mHandleMap, rth);
+        destruct_handle<VulkanRenderTarget>(rth);
     });
 }
 
 void VulkanDriver::destroyRenderTarget(Handle<HwRenderTarget> rth) {
     if (rth) {
-        mDisposer.removeReference(handle_cast<VulkanRenderTarget>(mHandleMap, rth));
+        mDisposer.removeReference(handle_cast<VulkanRenderTarget>(rth));
     }
 }
 
@@ -571,23 +601,23 @@ void VulkanDriver::createFenceR(Handle<HwFence> fh, int) {
 
      // As a fallback in release builds, trigger the fence based on the work command buffer.
     if (mContext.currentCommands == nullptr) {
-        construct_handle<VulkanFence>(mHandleMap, fh, mContext.work);
+        construct_handle<VulkanFence>(fh, mContext.work);
         return;
     }
 
-     construct_handle<VulkanFence>(mHandleMap, fh, *mContext.currentCommands);
+     construct_handle<VulkanFence>(fh, *mContext.currentCommands);
 }
 
 void VulkanDriver::createSyncR(Handle<HwSync> sh, int) {
     ASSERT_PRECONDITION(mContext.currentCommands, "Syncs must be created within a frame.");
-    construct_handle<VulkanSync>(mHandleMap, sh, *mContext.currentCommands);
+    construct_handle<VulkanSync>(sh, *mContext.currentCommands);
 }
 
 void VulkanDriver::createSwapChainR(Handle<HwSwapChain> sch, void* nativeWindow, uint64_t flags) {
     const VkInstance instance = mContext.instance;
     auto vksurface = (VkSurfaceKHR) mContextManager.createVkSurfaceKHR(nativeWindow, instance,
             flags);
-    auto* swapChain = construct_handle<VulkanSwapChain>(mHandleMap, sch, mContext, vksurface);
+    auto* swapChain = construct_handle<VulkanSwapChain>(sch, mContext, vksurface);
 
     // TODO: move the following line into makeCurrent.
     mContext.currentSurface = &swapChain->surfaceContext;
@@ -596,7 +626,7 @@ void VulkanDriver::createSwapChainR(Handle<HwSwapChain> sch, void* nativeWindow,
 void VulkanDriver::createSwapChainHeadlessR(Handle<HwSwapChain> sch,
         uint32_t width, uint32_t height, uint64_t flags) {
     assert(width > 0 && height > 0 && "Vulkan requires non-zero swap chain dimensions.");
-    auto* swapChain = construct_handle<VulkanSwapChain>(mHandleMap, sch, mContext, width, height);
+    auto* swapChain = construct_handle<VulkanSwapChain>(sch, mContext, width, height);
     mContext.currentSurface = &swapChain->surfaceContext;
 }
 
@@ -676,9 +706,9 @@ Handle<HwTimerQuery> VulkanDriver::createTimerQueryS() noexcept {
     // The handle must be constructed here, as a synchronous call to getTimerQueryValue might happen
     // before createTimerQueryR is executed.
     Handle<HwTimerQuery> tqh = alloc_handle<VulkanTimerQuery, HwTimerQuery>();
-    auto query = construct_handle<VulkanTimerQuery>(mHandleMap, tqh, mContext);
+    auto query = construct_handle<VulkanTimerQuery>(tqh, mContext);
     mDisposer.createDisposable(query, [this, tqh] () {
-        destruct_handle<VulkanTimerQuery>(mHandleMap, tqh);
+        destruct_handle<VulkanTimerQuery>(tqh);
     });
     return tqh;
 }
@@ -689,19 +719,19 @@ void VulkanDriver::destroySamplerGroup(Handle<HwSamplerGroup> sbh) {
         // not map to any Vulkan objects. To handle destruction, the only thing we need to do is
         // ensure that the next draw call doesn't try to access a zombie sampler buffer. Therefore,
         // simply replace all weak references with null.
-        auto* hwsb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+        auto* hwsb = handle_cast<VulkanSamplerGroup>(sbh);
         for (auto& binding : mSamplerBindings) {
             if (binding == hwsb) {
                 binding = nullptr;
             }
         }
-        destruct_handle<VulkanSamplerGroup>(mHandleMap, sbh);
+        destruct_handle<VulkanSamplerGroup>(sbh);
     }
 }
 
 void VulkanDriver::destroySwapChain(Handle<HwSwapChain> sch) {
     if (sch) {
-        VulkanSurfaceContext& surfaceContext = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+        VulkanSurfaceContext& surfaceContext = handle_cast<VulkanSwapChain>(sch)->surfaceContext;
         backend::destroySwapChain(mContext, surfaceContext, mDisposer);
 
         vkDestroySurfaceKHR(mContext.instance, surfaceContext.surface, VKALLOC);
@@ -709,7 +739,7 @@ void VulkanDriver::destroySwapChain(Handle<HwSwapChain> sch) {
             mContext.currentSurface = nullptr;
         }
 
-        destruct_handle<VulkanSwapChain>(mHandleMap, sch);
+        destruct_handle<VulkanSwapChain>(sch);
     }
 }
 
@@ -718,12 +748,12 @@ void VulkanDriver::destroyStream(Handle<HwStream> sh) {
 
 void VulkanDriver::destroyTimerQuery(Handle<HwTimerQuery> tqh) {
     if (tqh) {
-        mDisposer.removeReference(handle_cast<VulkanTimerQuery>(mHandleMap, tqh));
+        mDisposer.removeReference(handle_cast<VulkanTimerQuery>(tqh));
     }
 }
 
 void VulkanDriver::destroySync(Handle<HwSync> sh) {
-    destruct_handle<VulkanSync>(mHandleMap, sh);
+    destruct_handle<VulkanSync>(sh);
 }
 
 
@@ -750,11 +780,11 @@ void VulkanDriver::updateStreams(CommandStream* driver) {
 }
 
 void VulkanDriver::destroyFence(Handle<HwFence> fh) {
-    destruct_handle<VulkanFence>(mHandleMap, fh);
+    destruct_handle<VulkanFence>(fh);
 }
 
 FenceStatus VulkanDriver::wait(Handle<HwFence> fh, uint64_t timeout) {
-    auto& cmdfence = handle_cast<VulkanFence>(mHandleMap, fh)->fence;
+    auto& cmdfence = handle_cast<VulkanFence>(fh)->fence;
 
     // The condition variable is used only to guarantee that we're calling vkWaitForFences *after*
     // calling vkQueueSubmit.
@@ -829,6 +859,10 @@ bool VulkanDriver::areFeedbackLoopsSupported() {
     return true;
 }
 
+size_t VulkanDriver::getMaxUniformBufferSize() {
+    return mContext.physicalDeviceProperties.limits.maxUniformBufferRange;
+}
+
 math::float2 VulkanDriver::getClipSpaceParams() {
     // z-coordinate of clip-space is in [0,w]
     return math::float2{ -0.5f, 0.5f };
@@ -836,14 +870,14 @@ math::float2 VulkanDriver::getClipSpaceParams() {
 
 void VulkanDriver::updateVertexBuffer(Handle<HwVertexBuffer> vbh, size_t index,
         BufferDescriptor&& p, uint32_t byteOffset) {
-    auto& vb = *handle_cast<VulkanVertexBuffer>(mHandleMap, vbh);
+    auto& vb = *handle_cast<VulkanVertexBuffer>(vbh);
     vb.buffers[index]->loadFromCpu(p.buffer, byteOffset, p.size);
     scheduleDestroy(std::move(p));
 }
 
 void VulkanDriver::updateIndexBuffer(Handle<HwIndexBuffer> ibh, BufferDescriptor&& p,
         uint32_t byteOffset) {
-    auto& ib = *handle_cast<VulkanIndexBuffer>(mHandleMap, ibh);
+    auto& ib = *handle_cast<VulkanIndexBuffer>(ibh);
     ib.buffer->loadFromCpu(p.buffer, byteOffset, p.size);
     scheduleDestroy(std::move(p));
 }
@@ -852,12 +886,12 @@ void VulkanDriver::update2DImage(Handle<HwTexture> th,
         uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         PixelBufferDescriptor&& data) {
     assert(xoffset == 0 && yoffset == 0 && "Offsets not yet supported.");
-    handle_cast<VulkanTexture>(mHandleMap, th)->update2DImage(data, width, height, level);
+    handle_cast<VulkanTexture>(th)->update2DImage(data, width, height, level);
     scheduleDestroy(std::move(data));
 }
 
 void VulkanDriver::setMinMaxLevels(Handle<HwTexture> th, uint32_t minLevel, uint32_t maxLevel) {
-    handle_cast<VulkanTexture>(mHandleMap, th)->setPrimaryRange(minLevel, maxLevel);
+    handle_cast<VulkanTexture>(th)->setPrimaryRange(minLevel, maxLevel);
 }
 
 void VulkanDriver::update3DImage(
@@ -866,13 +900,13 @@ void VulkanDriver::update3DImage(
         uint32_t width, uint32_t height, uint32_t depth,
         PixelBufferDescriptor&& data) {
     assert(xoffset == 0 && yoffset == 0 && zoffset == 0 && "Offsets not yet supported.");
-    handle_cast<VulkanTexture>(mHandleMap, th)->update3DImage(data, width, height, depth, level);
+    handle_cast<VulkanTexture>(th)->update3DImage(data, width, height, depth, level);
     scheduleDestroy(std::move(data));
 }
 
 void VulkanDriver::updateCubeImage(Handle<HwTexture> th, uint32_t level,
         PixelBufferDescriptor&& data, FaceOffsets faceOffsets) {
-    handle_cast<VulkanTexture>(mHandleMap, th)->updateCubeImage(data, faceOffsets, level);
+    handle_cast<VulkanTexture>(th)->updateCubeImage(data, faceOffsets, level);
     scheduleDestroy(std::move(data));
 }
 
@@ -883,7 +917,7 @@ void VulkanDriver::cancelExternalImage(void* image) {
 }
 
 bool VulkanDriver::getTimerQueryValue(Handle<HwTimerQuery> tqh, uint64_t* elapsedTime) {
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
 
     // This is a synchronous call and might occur before beginTimerQuery has written anything into
     // the command buffer, which is an error according to the validation layer that ships in the
@@ -928,7 +962,7 @@ bool VulkanDriver::getTimerQueryValue(Handle<HwTimerQuery> tqh, uint64_t* elapse
 }
 
 SyncStatus VulkanDriver::getSyncStatus(Handle<HwSync> sh) {
-    VulkanSync* sync = handle_cast<VulkanSync>(mHandleMap, sh);
+    VulkanSync* sync = handle_cast<VulkanSync>(sh);
     if (sync->fence == nullptr) {
         return SyncStatus::NOT_SIGNALED;
     }
@@ -960,7 +994,7 @@ bool VulkanDriver::canGenerateMipmaps() {
 
 void VulkanDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data) {
     if (data.size > 0) {
-        auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
         buffer->loadFromCpu(data.buffer, (uint32_t) data.size);
         scheduleDestroy(std::move(data));
     }
@@ -968,7 +1002,7 @@ void VulkanDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescript
 
 void VulkanDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
-    auto* sb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+    auto* sb = handle_cast<VulkanSamplerGroup>(sbh);
     *sb->sb = samplerGroup;
 }
 
@@ -976,7 +1010,7 @@ void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassP
     assert(mContext.currentCommands);
     assert(mContext.currentSurface);
     VulkanSurfaceContext& surface = *mContext.currentSurface;
-    mCurrentRenderTarget = handle_cast<VulkanRenderTarget>(mHandleMap, rth);
+    mCurrentRenderTarget = handle_cast<VulkanRenderTarget>(rth);
     VulkanRenderTarget* rt = mCurrentRenderTarget;
 
     const VkExtent2D extent = rt->getExtent();
@@ -1160,15 +1194,15 @@ void VulkanDriver::nextSubpass(int) {
 void VulkanDriver::setRenderPrimitiveBuffer(Handle<HwRenderPrimitive> rph,
         Handle<HwVertexBuffer> vbh, Handle<HwIndexBuffer> ibh,
         uint32_t enabledAttributes) {
-    auto primitive = handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
-    primitive->setBuffers(handle_cast<VulkanVertexBuffer>(mHandleMap, vbh),
-            handle_cast<VulkanIndexBuffer>(mHandleMap, ibh), enabledAttributes);
+    auto primitive = handle_cast<VulkanRenderPrimitive>(rph);
+    primitive->setBuffers(handle_cast<VulkanVertexBuffer>(vbh),
+            handle_cast<VulkanIndexBuffer>(ibh), enabledAttributes);
 }
 
 void VulkanDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
         PrimitiveType pt, uint32_t offset,
         uint32_t minIndex, uint32_t maxIndex, uint32_t count) {
-    auto& primitive = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
+    auto& primitive = *handle_cast<VulkanRenderPrimitive>(rph);
     primitive.setPrimitiveType(pt);
     primitive.offset = offset * primitive.indexBuffer->elementSize;
     primitive.count = count;
@@ -1179,7 +1213,7 @@ void VulkanDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
 void VulkanDriver::makeCurrent(Handle<HwSwapChain> drawSch, Handle<HwSwapChain> readSch) {
     ASSERT_PRECONDITION_NON_FATAL(drawSch == readSch,
                                   "Vulkan driver does not support distinct draw/read swap chains.");
-    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain>(mHandleMap, drawSch)->surfaceContext;
+    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain>(drawSch)->surfaceContext;
     mContext.currentSurface = &sContext;
 }
 
@@ -1232,7 +1266,7 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
     }
 
     // Present the backbuffer.
-    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain>(sch)->surfaceContext;
     VkPresentInfoKHR presentInfo {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
         .waitSemaphoreCount = 1,
@@ -1256,7 +1290,7 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
 }
 
 void VulkanDriver::bindUniformBuffer(size_t index, Handle<HwUniformBuffer> ubh) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+    auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
     // The driver API does not currently expose offset / range, but it will do so in the future.
     const VkDeviceSize offset = 0;
     const VkDeviceSize size = VK_WHOLE_SIZE;
@@ -1265,12 +1299,12 @@ void VulkanDriver::bindUniformBuffer(size_t index, Handle<HwUniformBuffer> ubh)
 
 void VulkanDriver::bindUniformBufferRange(size_t index, Handle<HwUniformBuffer> ubh,
         size_t offset, size_t size) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+    auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
     mBinder.bindUniformBuffer((uint32_t)index, buffer->getGpuBuffer(), offset, size);
 }
 
 void VulkanDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
-    auto* hwsb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+    auto* hwsb = handle_cast<VulkanSamplerGroup>(sbh);
     mSamplerBindings[index] = hwsb;
 }
 
@@ -1336,7 +1370,7 @@ void VulkanDriver::stopCapture(int) {
 void VulkanDriver::readPixels(Handle<HwRenderTarget> src, uint32_t x, uint32_t y,
         uint32_t width, uint32_t height, PixelBufferDescriptor&& pbd) {
     const VkDevice device = mContext.device;
-    const VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(mHandleMap, src);
+    const VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(src);
     const VulkanTexture* srcTexture = srcTarget->getColor(0).texture;
     const VkFormat swapChainFormat = mContext.currentSurface->surfaceFormat.format;
     const VkFormat srcFormat = srcTexture ? srcTexture->getVkFormat() : swapChainFormat;
@@ -1493,8 +1527,8 @@ void VulkanDriver::readStreamPixels(Handle<HwStream> sh, uint32_t x, uint32_t y,
 
 void VulkanDriver::blit(TargetBufferFlags buffers, Handle<HwRenderTarget> dst, Viewport dstRect,
         Handle<HwRenderTarget> src, Viewport srcRect, SamplerMagFilter filter) {
-    VulkanRenderTarget* dstTarget = handle_cast<VulkanRenderTarget>(mHandleMap, dst);
-    VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(mHandleMap, src);
+    VulkanRenderTarget* dstTarget = handle_cast<VulkanRenderTarget>(dst);
+    VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(src);
 
     VkFilter vkfilter = filter == SamplerMagFilter::NEAREST ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
 
@@ -1548,14 +1582,14 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Draw calls can occur only within a beginFrame / endFrame.");
     VkCommandBuffer cmdbuffer = commands->cmdbuffer;
-    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
+    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(rph);
 
     Handle<HwProgram> programHandle = pipelineState.program;
     RasterState rasterState = pipelineState.rasterState;
     PolygonOffset depthOffset = pipelineState.polygonOffset;
     const Viewport& viewportScissor = pipelineState.scissor;
 
-    auto* program = handle_cast<VulkanProgram>(mHandleMap, programHandle);
+    auto* program = handle_cast<VulkanProgram>(programHandle);
     mDisposer.acquire(program, commands->resources);
     mDisposer.acquire(prim.indexBuffer, commands->resources);
     mDisposer.acquire(prim.vertexBuffer, commands->resources);
@@ -1653,7 +1687,7 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
                 utils::slog.w << " at binding point " << +bindingPoint << utils::io::endl;
                 texture = mContext.emptyTexture;
             } else {
-                texture = handle_const_cast<VulkanTexture>(mHandleMap, boundSampler->t);
+                texture = handle_const_cast<VulkanTexture>(boundSampler->t);
                 mDisposer.acquire(texture, commands->resources);
             }
 
@@ -1688,13 +1722,14 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
     // Bind new descriptor sets if they need to change.
     VkDescriptorSet descriptors[3];
     VkPipelineLayout pipelineLayout;
-    if (mBinder.getOrCreateDescriptors(descriptors, &pipelineLayout)) {
+    uint32_t dynamicOffsets[VulkanBinder::UBUFFER_BINDING_COUNT];
+    if (mBinder.getOrCreateDescriptors(descriptors, &pipelineLayout, dynamicOffsets)) {
         vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 3,
-                descriptors, 0, nullptr);
+                descriptors, VulkanBinder::UBUFFER_BINDING_COUNT, dynamicOffsets);
     }
 
     // Bind the pipeline if it changed. This can happen, for example, if the raster state changed.
-    // Creating a new pipeline is slow, so we should consider using pipeline cache objects.
+    // Creating a new pipeline is slow, which is mitigated by the persistent VkPipelineCache.
     VkPipeline pipeline;
     if (mBinder.getOrCreatePipeline(&pipeline)) {
         vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -1721,7 +1756,7 @@ void VulkanDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Timer queries can occur only within a beginFrame / endFrame.");
 
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
     const uint32_t index = vtq->startingQueryIndex;
     const VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 
@@ -1734,7 +1769,7 @@ void VulkanDriver::endTimerQuery(Handle<HwTimerQuery> tqh) {
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Timer queries can occur only within a beginFrame / endFrame.");
 
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
     const uint32_t index = vtq->stoppingQueryIndex;
     const VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
     vkCmdWriteTimestamp(commands->cmdbuffer, stage, mContext.timestamps.pool, index);
@@ -27,14 +27,18 @@
 #include "VulkanUtility.h"
 
 #include "private/backend/Driver.h"
+#include "private/backend/HandleAllocator.h"
 #include "DriverBase.h"
 
 #include <utils/compiler.h>
 #include <utils/Allocator.h>
 
-#include <unordered_map>
 #include <vector>
 
+#ifndef FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB
+#    define FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB 8
+#endif
+
 namespace filament {
 namespace backend {
 
@@ -81,69 +85,39 @@ private:
 private:
     backend::VulkanPlatform& mContextManager;
 
-    // For now we're not bothering to store handles in pools, just simple on-demand allocation.
-    // We have a little map from integer handles to "blobs" which get replaced with the Hw objects.
-    using Blob = std::vector<uint8_t>;
-    using HandleMap = std::unordered_map<HandleBase::HandleId, Blob>;
-    HandleMap mHandleMap;
-    std::mutex mHandleMapMutex;
-    HandleBase::HandleId mNextId = 1;
+    // Handles are allocated from size-classed pools, the HandleId being the offset of the object
+    // in the arena. This makes handle_cast<> lock-free and O(1).
+    // The small pool fits buffers, fences and sampler groups, the medium pool fits vertex buffers,
+    // textures, programs and swap chains, the large pool fits render targets and primitives.
+    using HandleAllocator = backend::HandleAllocator<64, 256, 640>;
+    HandleAllocator mHandleAllocator;
 
     template<typename Dp, typename B>
-    Handle<B> alloc_handle() {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        mHandleMap[mNextId] = Blob(sizeof(Dp));
-        return Handle<B>(mNextId++);
+    Handle<B> alloc_handle() noexcept {
+        return mHandleAllocator.allocate<Dp, B>();
     }
 
     template<typename Dp, typename B>
-    Dp* handle_cast(HandleMap& handleMap, Handle<B> handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        return reinterpret_cast<Dp*>(blob.data());
+    Dp* handle_cast(Handle<B> handle) noexcept {
+        return mHandleAllocator.handle_cast<Dp*>(handle);
     }
 
     template<typename Dp, typename B>
-    const Dp* handle_const_cast(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        assert(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        return reinterpret_cast<const Dp*>(blob.data());
+    const Dp* handle_const_cast(const Handle<B>& handle) noexcept {
+        return mHandleAllocator.handle_cast<Dp*>(handle);
     }
 
     template<typename Dp, typename B, typename ... ARGS>
-    Dp* construct_handle(HandleMap& handleMap, Handle<B>& handle, ARGS&& ... args) noexcept {
+    Dp* construct_handle(Handle<B>& handle, ARGS&& ... args) noexcept {
         assert(handle);
         if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        Dp* addr = reinterpret_cast<Dp*>(blob.data());
-        new(addr) Dp(std::forward<ARGS>(args)...);
-        return addr;
+        return mHandleAllocator.construct<Dp>(handle, std::forward<ARGS>(args)...);
     }
 
     template<typename Dp, typename B>
-    void destruct_handle(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        // Call the destructor, remove the blob, don't bother reclaiming the integer id.
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        reinterpret_cast<Dp*>(blob.data())->~Dp();
-        handleMap.erase(handle.getId());
+    void destruct_handle(const Handle<B>& handle) noexcept {
+        assert(handle);
+        mHandleAllocator.deallocate<Dp>(handle);
     }
 
     void refreshSwapChain();
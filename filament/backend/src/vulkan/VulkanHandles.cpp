@@ -435,16 +435,12 @@ VulkanUniformBuffer::VulkanUniformBuffer(VulkanContext& context, VulkanStagePool
 }
 
 void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes) {
-    VulkanStage const* stage = mStagePool.acquireStage(numBytes);
-    void* mapped;
-    vmaMapMemory(mContext.allocator, stage->memory, &mapped);
-    memcpy(mapped, cpuData, numBytes);
-    vmaUnmapMemory(mContext.allocator, stage->memory);
-    vmaFlushAllocation(mContext.allocator, stage->memory, 0, numBytes);
+    VulkanStageRange const stage = mStagePool.acquireStageRange(numBytes);
+    memcpy(stage.mapping, cpuData, numBytes);
 
     auto copyToDevice = [this, numBytes, stage] (VulkanCommandBuffer& commands) {
-        VkBufferCopy region { .size = numBytes };
-        vkCmdCopyBuffer(commands.cmdbuffer, stage->buffer, mGpuBuffer, 1, &region);
+        VkBufferCopy region { .srcOffset = stage.offset, .size = numBytes };
+        vkCmdCopyBuffer(commands.cmdbuffer, stage.buffer, mGpuBuffer, 1, &region);
         mDisposer.acquire(this, commands.resources);
 
         // Ensure that the copy finishes before the next draw call.
@@ -460,7 +456,7 @@ void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes) {
         vkCmdPipelineBarrier(commands.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 
-        mStagePool.releaseStage(stage, commands);
+        mStagePool.releaseStageRange(stage, commands);
     };
 
     // If inside beginFrame / endFrame, use the swap context, otherwise use the work cmdbuffer.
@@ -73,13 +73,120 @@ void VulkanStagePool::releaseStage(VulkanStage const* stage, VulkanCommandBuffer
     mDisposer.removeReference(stage);
 }
 
+VulkanStageRange VulkanStagePool::acquireStageRange(uint32_t numBytes) {
+    const uint32_t alignedSize = (numBytes + STAGE_RANGE_ALIGNMENT - 1) &
+            ~(STAGE_RANGE_ALIGNMENT - 1);
+
+    VulkanStageBlock* block = mCurrentBlock;
+    if (!block || block->capacity - block->cursor < alignedSize) {
+        if (alignedSize > STAGE_BLOCK_SIZE / 2) {
+            // Large requests get a dedicated block, which is retired as soon as it's released.
+            block = acquireStageBlock(alignedSize);
+        } else {
+            if (mCurrentBlock) {
+                retireStageBlock(mCurrentBlock);
+            }
+            block = mCurrentBlock = acquireStageBlock(STAGE_BLOCK_SIZE);
+        }
+    }
+
+    const uint32_t offset = block->cursor;
+    block->cursor += alignedSize;
+    return {
+        .block = block,
+        .buffer = block->buffer,
+        .offset = offset,
+        .size = numBytes,
+        .mapping = block->mapping + offset,
+    };
+}
+
+void VulkanStagePool::releaseStageRange(VulkanStageRange const& range,
+        VulkanCommandBuffer& cmd) noexcept {
+    VulkanStageBlock* block = range.block;
+    vmaFlushAllocation(mContext.allocator, block->memory, range.offset, range.size);
+    mDisposer.acquire(block, cmd.resources);
+    if (block != mCurrentBlock) {
+        retireStageBlock(block);
+    }
+}
+
+VulkanStageBlock* VulkanStagePool::acquireStageBlock(uint32_t numBytes) {
+    VulkanStageBlock* block;
+    auto iter = mFreeBlocks.lower_bound(numBytes);
+    if (iter != mFreeBlocks.end()) {
+        block = iter->second;
+        mFreeBlocks.erase(iter);
+    } else {
+        block = new VulkanStageBlock({
+            .memory = VK_NULL_HANDLE,
+            .buffer = VK_NULL_HANDLE,
+            .mapping = nullptr,
+            .capacity = numBytes,
+            .cursor = 0,
+            .lastAccessed = mCurrentFrame,
+        });
+        VkBufferCreateInfo bufferInfo {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = numBytes,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        };
+        VmaAllocationCreateInfo allocInfo {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_ONLY
+        };
+        VmaAllocationInfo allocationInfo;
+        vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo, &block->buffer,
+                &block->memory, &allocationInfo);
+        block->mapping = static_cast<uint8_t*>(allocationInfo.pMappedData);
+        ASSERT_POSTCONDITION(block->mapping, "Unable to map a staging block.");
+    }
+
+    // The pool holds a reference to the block until it's retired, command buffers using it hold
+    // the others. The block goes back to the free list once all references are gone.
+    mDisposer.createDisposable(block, [this, block]() {
+        block->cursor = 0;
+        block->lastAccessed = mCurrentFrame;
+        mFreeBlocks.insert(std::make_pair(block->capacity, block));
+    });
+    return block;
+}
+
+void VulkanStagePool::retireStageBlock(VulkanStageBlock* block) noexcept {
+    if (block == mCurrentBlock) {
+        mCurrentBlock = nullptr;
+    }
+    mDisposer.removeReference(block);
+}
+
+void VulkanStagePool::destroyStageBlock(VulkanStageBlock* block) noexcept {
+    vmaDestroyBuffer(mContext.allocator, block->buffer, block->memory);
+    delete block;
+}
+
 void VulkanStagePool::gc() noexcept {
+    // Start a new staging block every frame, so that the current one can be recycled as soon as
+    // the GPU is done with this frame.
+    if (mCurrentBlock) {
+        retireStageBlock(mCurrentBlock);
+    }
+
     // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
     if (++mCurrentFrame <= TIME_BEFORE_EVICTION) {
         return;
     }
     const uint64_t evictionTime = mCurrentFrame - TIME_BEFORE_EVICTION;
 
+    decltype(mFreeBlocks) blocks;
+    blocks.swap(mFreeBlocks);
+    for (auto pair : blocks) {
+        if (pair.second->lastAccessed < evictionTime) {
+            destroyStageBlock(pair.second);
+        } else {
+            mFreeBlocks.insert(pair);
+        }
+    }
+
     decltype(mFreeStages) stages;
     stages.swap(mFreeStages);
     for (auto pair : stages) {
@@ -94,11 +201,16 @@ void VulkanStagePool::gc() noexcept {
 
 void VulkanStagePool::reset() noexcept {
     assert(mUsedStages.empty());
+    assert(mCurrentBlock == nullptr);
     for (auto pair : mFreeStages) {
         vmaDestroyBuffer(mContext.allocator, pair.second->buffer, pair.second->memory);
         delete pair.second;
     }
     mFreeStages.clear();
+    for (auto pair : mFreeBlocks) {
+        destroyStageBlock(pair.second);
+    }
+    mFreeBlocks.clear();
 }
 
 } // namespace filament
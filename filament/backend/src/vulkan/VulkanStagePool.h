@@ -35,6 +35,25 @@ struct VulkanStage {
     mutable uint64_t lastAccessed;
 };
 
+// A large, persistently mapped staging buffer that small uploads are linearly sub-allocated from.
+struct VulkanStageBlock {
+    VmaAllocation memory;
+    VkBuffer buffer;
+    uint8_t* mapping;
+    uint32_t capacity;
+    uint32_t cursor;
+    uint64_t lastAccessed;
+};
+
+// A range of a VulkanStageBlock, reserved for a single upload.
+struct VulkanStageRange {
+    VulkanStageBlock* block;
+    VkBuffer buffer;
+    uint32_t offset;
+    uint32_t size;
+    void* mapping;
+};
+
 // Manages a pool of stages, periodically releasing stages that have been unused for a while.
 class VulkanStagePool {
 public:
@@ -48,6 +67,16 @@ public:
     void releaseStage(VulkanStage const* stage) noexcept;
     void releaseStage(VulkanStage const* stage, VulkanCommandBuffer& cmd) noexcept;
 
+    // Reserves a range of a staging block, the returned range is mapped and ready to be written.
+    // This avoids creating a buffer per upload and is meant for buffer uploads; requests that
+    // don't fit in a block get a block of their own.
+    VulkanStageRange acquireStageRange(uint32_t numBytes);
+
+    // Flushes the CPU writes to the range, and marks it as used by the given command buffer. The
+    // range is recycled with its block, once all the command buffers using the block have
+    // finished executing.
+    void releaseStageRange(VulkanStageRange const& range, VulkanCommandBuffer& cmd) noexcept;
+
     // Evicts old unused stages and bumps the current frame number.
     void gc() noexcept;
 
@@ -66,6 +95,19 @@ private:
     // In theory this need not exist, but is useful for validation and ensuring no leaks.
     std::unordered_set<VulkanStage const*> mUsedStages;
 
+    VulkanStageBlock* acquireStageBlock(uint32_t numBytes);
+    void retireStageBlock(VulkanStageBlock* block) noexcept;
+    void destroyStageBlock(VulkanStageBlock* block) noexcept;
+
+    // Free blocks, ready to be reused (capacity => block).
+    std::multimap<uint32_t, VulkanStageBlock*> mFreeBlocks;
+
+    // The block that stage ranges are currently allocated from. A new one is started every frame.
+    VulkanStageBlock* mCurrentBlock = nullptr;
+
+    static constexpr uint32_t STAGE_BLOCK_SIZE = 1024 * 1024;
+    static constexpr uint32_t STAGE_RANGE_ALIGNMENT = 16;
+
     // Store the current "time" (really just a frame count) and LRU eviction parameters.
     uint64_t mCurrentFrame = 0;
     static constexpr uint32_t TIME_BEFORE_EVICTION = 3;
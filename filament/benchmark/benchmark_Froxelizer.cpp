@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "details/Camera.h"
+#include "details/Engine.h"
+#include "details/Froxelizer.h"
+#include "details/Scene.h"
+
+#include <filament/LightManager.h>
+
+#include <private/filament/EngineEnums.h>
+
+#include <utils/Entity.h>
+#include <utils/EntityManager.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+// Froxelizes 256 to 8192 lights. Only froxelizeLights() is timed.
+// A view has at most CONFIG_MAX_LIGHT_COUNT lights (256 by default), larger light counts are
+// skipped unless the tree is configured with a larger FILAMENT_MAX_LIGHT_COUNT, e.g.:
+//     cmake -DFILAMENT_MAX_LIGHT_COUNT=8192
+static constexpr size_t MIN_LIGHT_COUNT = 256;
+static constexpr size_t MAX_LIGHT_COUNT = 8192;
+
+class FroxelizerFixture : public benchmark::Fixture {
+protected:
+    FEngine* engine = nullptr;
+    Froxelizer* froxelizer = nullptr;
+    std::vector<Entity> lights;
+    // two sets of lights, so that consecutive froxelizations can't reuse each other's result
+    FScene::LightSoa lightData[2];
+    CameraInfo camera;
+    Viewport viewport{ 0, 0, 1920, 1080 };
+
+public:
+    void SetUp(const ::benchmark::State& state) override {
+        const size_t lightCount = size_t(state.range(0));
+        if (lightCount > CONFIG_MAX_LIGHT_COUNT) {
+            return;
+        }
+
+        engine = FEngine::create(Engine::Backend::NOOP);
+        froxelizer = new Froxelizer(*engine);
+        froxelizer->setOptions(5.0f, 100.0f);
+
+        camera.projection = mat4f::perspective(60.0f, 1920.0f / 1080.0f, 0.1f, 100.0f);
+        camera.cullingProjection = camera.projection;
+        camera.zn = 0.1f;
+        camera.zf = 100.0f;
+
+        // half point lights, half spot lights
+        lights.resize(lightCount);
+        EntityManager::get().create(lights.size(), lights.data());
+        for (size_t i = 0; i < lights.size(); i++) {
+            const auto type = (i & 1u) ? LightManager::Type::SPOT : LightManager::Type::POINT;
+            LightManager::Builder(type)
+                    .falloff(4.0f)
+                    .spotLightCone(0.5f, 0.8f)
+                    .build(*engine, lights[i]);
+        }
+
+        // lights in front of the camera, with a radius between 0.5m and 4m
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(-1.0f, 1.0f);
+        auto& lcm = engine->getLightManager();
+        for (auto& soa : lightData) {
+            soa.resize(FScene::DIRECTIONAL_LIGHTS_COUNT + lightCount);
+            for (size_t i = 0; i < lightCount; i++) {
+                const size_t j = FScene::DIRECTIONAL_LIGHTS_COUNT + i;
+                const float z = -50.0f * (rand(gen) + 1.0f) - 1.0f;
+                soa.elementAt<FScene::POSITION_RADIUS>(j) =
+                        float4{ rand(gen) * z, rand(gen) * z, z, 2.25f + 1.75f * rand(gen) };
+                soa.elementAt<FScene::DIRECTION>(j) =
+                        normalize(float3{ rand(gen), rand(gen), rand(gen) });
+                soa.elementAt<FScene::LIGHT_INSTANCE>(j) = lcm.getInstance(lights[i]);
+            }
+        }
+    }
+
+    void TearDown(const ::benchmark::State&) override {
+        if (!engine) {
+            return;
+        }
+        for (auto& soa : lightData) {
+            soa.clear();
+        }
+        for (Entity light : lights) {
+            engine->getLightManager().destroy(light);
+        }
+        EntityManager::get().destroy(lights.size(), lights.data());
+        froxelizer->terminate(engine->getDriverApi());
+        delete froxelizer;
+        Engine* e = engine;
+        Engine::destroy(&e);
+        engine = nullptr;
+    }
+};
+
+BENCHMARK_DEFINE_F(FroxelizerFixture, froxelizeLights)(benchmark::State& state) {
+    const size_t lightCount = size_t(state.range(0));
+    if (lightCount > CONFIG_MAX_LIGHT_COUNT) {
+        state.SkipWithError("needs a larger FILAMENT_MAX_LIGHT_COUNT");
+        return;
+    }
+    // The light records and the per-job froxel data take about 2 KiB per light.
+    const size_t arenaSize = std::max(FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE,
+            CONFIG_MAX_LIGHT_COUNT * 2048 + 1024 * 1024);
+    LinearAllocatorArena arena("benchmark", arenaSize);
+    filament::ArenaScope scope(arena);
+
+    // The froxel buffers are allocated once, each iteration overwrites them.
+    froxelizer->prepare(engine->getDriverApi(), scope, viewport,
+            camera.projection, camera.zn, camera.zf);
+    {
+        PerformanceCounters pc(state);
+        size_t frame = 0;
+        for (auto _ : state) {
+            froxelizer->froxelizeLights(*engine, camera, lightData[frame++ & 1u]);
+        }
+        pc.stop();
+        state.SetItemsProcessed(int64_t(state.iterations() * lightCount));
+    }
+    froxelizer->commit(engine->getDriverApi());
+    engine->flush();
+}
+
+BENCHMARK_REGISTER_F(FroxelizerFixture, froxelizeLights)
+        ->RangeMultiplier(2)
+        ->Range(MIN_LIGHT_COUNT, MAX_LIGHT_COUNT)
+        ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <private/backend/HandleAllocator.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace filament::backend;
+
+namespace {
+
+struct HwObject { };
+
+struct Object : public HwObject {
+    explicit Object(uint32_t value) noexcept : value(value) { }
+    uint32_t value;
+    uint8_t payload[140];
+};
+
+static constexpr size_t HANDLE_COUNT = 4096;
+
+// The handle table used by the Vulkan and Metal backends before HandleAllocator, for reference.
+class HandleMap {
+    using Blob = std::vector<uint8_t>;
+    std::unordered_map<HandleBase::HandleId, Blob> mHandleMap;
+    std::mutex mHandleMapMutex;
+    HandleBase::HandleId mNextId = 1;
+public:
+    Handle<HwObject> create(uint32_t value) {
+        std::lock_guard<std::mutex> lock(mHandleMapMutex);
+        Blob& blob = mHandleMap[mNextId] = Blob(sizeof(Object));
+        new(blob.data()) Object(value);
+        return Handle<HwObject>(mNextId++);
+    }
+
+    Object* handle_cast(Handle<HwObject> handle) noexcept {
+        std::lock_guard<std::mutex> lock(mHandleMapMutex);
+        return reinterpret_cast<Object*>(mHandleMap.find(handle.getId())->second.data());
+    }
+};
+
+} // anonymous namespace
+
+static void BM_handle_cast_arena(benchmark::State& state) {
+    HandleAllocator<64, 256, 640> allocator("Handles", 4 * 1024 * 1024);
+    std::vector<Handle<HwObject>> handles;
+    for (uint32_t i = 0; i < HANDLE_COUNT; i++) {
+        handles.push_back(allocator.allocateAndConstruct<Object, HwObject>(i));
+    }
+
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (auto const& handle : handles) {
+            sum += allocator.handle_cast<Object*>(handle)->value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * HANDLE_COUNT));
+
+    for (auto const& handle : handles) {
+        allocator.deallocate<Object>(handle);
+    }
+}
+
+static void BM_handle_cast_map(benchmark::State& state) {
+    HandleMap map;
+    std::vector<Handle<HwObject>> handles;
+    for (uint32_t i = 0; i < HANDLE_COUNT; i++) {
+        handles.push_back(map.create(i));
+    }
+
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (auto const& handle : handles) {
+            sum += map.handle_cast(handle)->value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * HANDLE_COUNT));
+}
+
+static void BM_handle_alloc_free_arena(benchmark::State& state) {
+    HandleAllocator<64, 256, 640> allocator("Handles", 4 * 1024 * 1024);
+    for (auto _ : state) {
+        Handle<HwObject> handle = allocator.allocateAndConstruct<Object, HwObject>(0u);
+        benchmark::DoNotOptimize(handle);
+        allocator.deallocate<Object>(handle);
+    }
+}
+
+BENCHMARK(BM_handle_cast_arena);
+BENCHMARK(BM_handle_cast_map);
+BENCHMARK(BM_handle_alloc_free_arena);
@@ -30,6 +30,7 @@ namespace filament {
 
 class Camera;
 class ColorGrading;
+class MaterialLibrary;
 class DebugRegistry;
 class Fence;
 class IndexBuffer;
@@ -409,6 +410,7 @@ public:
     bool destroy(const Scene* p);               //!< Destroys a Scene object.
     bool destroy(const Skybox* p);              //!< Destroys a SkyBox object.
     bool destroy(const ColorGrading* p);        //!< Destroys a ColorGrading object.
+    bool destroy(const MaterialLibrary* p);     //!< Destroys a MaterialLibrary object.
     bool destroy(const SwapChain* p);           //!< Destroys a SwapChain object.
     bool destroy(const Stream* p);              //!< Destroys a Stream object.
     bool destroy(const Texture* p);             //!< Destroys a Texture object.
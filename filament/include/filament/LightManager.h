@@ -267,6 +267,19 @@ public:
          */
         bool stable = false;
 
+        /**
+         * Whether the shadow map is kept from one frame to the next, and only rendered again
+         * when the light, the shadow casters, their transforms or their material instances
+         * change. This saves rendering the shadow map at every frame in mostly static scenes.
+         * A cached spot light shadow map is not reduced when the light covers a small part of the
+         * view, so that it keeps its place in the shadow atlas when the camera moves.
+         * Changes to the content of the shadow casters' vertex or index buffers or textures are
+         * not detected, and skinned shadow casters are always rendered again. This is ignored
+         * with VSM shadows.
+         * (off by default)
+         */
+        bool cached = false;
+
         /**
          * Constant bias in depth-resolution units by which shadows are moved away from the
          * light. The default value of 0.5 is used to round depth values up.
@@ -36,6 +36,7 @@ namespace utils {
 
 namespace filament {
 
+class MaterialLibrary;
 class Texture;
 class TextureSampler;
 
@@ -105,6 +106,14 @@ public:
          */
         Builder& package(const void* payload, size_t size);
 
+        /**
+         * Specifies the material library holding the shaders of this material. This is required
+         * for materials built with a filamat::MaterialLibrary, and ignored otherwise.
+         *
+         * @param library The library the material was built with, must outlive the material.
+         */
+        Builder& library(MaterialLibrary const* library) noexcept;
+
         /**
          * Creates the Material object and returns a pointer to it.
          *
@@ -277,6 +286,58 @@ public:
 
     //! Returns this material's default instance.
     MaterialInstance const* getDefaultInstance() const noexcept;
+
+    /**
+     * Selects how eagerly Material::compile() creates the requested programs.
+     */
+    enum class CompilerPriorityQueue : uint8_t {
+        HIGH,   //!< all programs are created immediately
+        LOW     //!< programs are created a few at a time, at each Renderer::beginFrame()
+    };
+
+    /**
+     * Callback invoked once all the programs requested by compile() have been processed by the
+     * backend. It is always called on the Engine's thread, during Renderer::beginFrame().
+     */
+    using CompilationCallback = void(*)(void* user);
+
+    /**
+     * Creates the GPU programs of the given variants ahead of time, so that the first frame
+     * using them doesn't stall. This is typically used behind a loading screen.
+     *
+     * Variants not supported by this material (e.g. lighting variants of an unlit material, or
+     * variants filtered out when the material was built) are ignored, as well as the ones
+     * already created.
+     *
+     * @param priority  Whether all programs are created now or spread over several frames.
+     * @param variants  A combination of UserVariantFilterBit selecting the variants to create.
+     * @param callback  Optional callback invoked when all the requested programs are created.
+     * @param user      User data passed to the callback.
+     */
+    void compile(CompilerPriorityQueue priority,
+            UserVariantFilterMask variants = UserVariantFilterMask(UserVariantFilterBit::ALL),
+            CompilationCallback callback = nullptr, void* user = nullptr) noexcept;
+
+    /**
+     * Gets the variants of this material that have been used for rendering so far. Variants
+     * created with compile() but never rendered with are not included.
+     *
+     * The returned variant keys are opaque, they are meant to be written in a variant profile
+     * and passed to matc with --variant-profile, so that the material only includes the
+     * variants an application actually uses. A variant profile is a text file, where each line
+     * is a comma-separated list of hexadecimal variant keys followed by a space and the name of
+     * the material, for instance:
+     *
+     *     0x00,0x01,0x05,0x10 DefaultMaterial
+     *
+     * @param variants A pointer to a list of variant keys. The list must be at least "count"
+     *                 large.
+     * @param count The maximum number of variant keys to retrieve. Filament materials have at
+     *              most 128 variants.
+     *
+     * @return The number of variant keys written to the variants pointer.
+     */
+    size_t getUsedVariants(uint8_t* variants, size_t count) const noexcept;
 };
 
 } // namespace filament
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! \file
+
+#ifndef TNT_FILAMENT_MATERIAL_LIBRARY_H
+#define TNT_FILAMENT_MATERIAL_LIBRARY_H
+
+#include <filament/FilamentAPI.h>
+
+#include <utils/compiler.h>
+
+#include <stddef.h>
+
+namespace filament {
+
+class Engine;
+class FMaterialLibrary;
+
+/**
+ * A MaterialLibrary holds the shader dictionaries shared by a set of materials, as produced by
+ * filamat::MaterialLibrary (or matc --library). Such materials don't embed their own copy of the
+ * dictionaries, which makes them much smaller and faster to load.
+ *
+ * Creation, usage and destruction
+ * ===============================
+ *
+ * A MaterialLibrary is created using the MaterialLibrary::Builder and destroyed by calling
+ * Engine::destroy(const MaterialLibrary*). It must be passed to Material::Builder::library() when
+ * building the materials that use it, and must outlive them.
+ *
+ * ~~~~~~~~~~~{.cpp}
+ *  filament::MaterialLibrary* library = filament::MaterialLibrary::Builder()
+ *              .package(libraryData, librarySize)
+ *              .build(*engine);
+ *
+ *  filament::Material* material = filament::Material::Builder()
+ *              .package(materialData, materialSize)
+ *              .library(library)
+ *              .build(*engine);
+ *
+ *  engine->destroy(material);
+ *  engine->destroy(library);
+ * ~~~~~~~~~~~
+ */
+class UTILS_PUBLIC MaterialLibrary : public FilamentAPI {
+    struct BuilderDetails;
+
+public:
+    class Builder : public BuilderBase<BuilderDetails> {
+        friend struct BuilderDetails;
+    public:
+        Builder() noexcept;
+        Builder(Builder const& rhs) noexcept;
+        Builder(Builder&& rhs) noexcept;
+        ~Builder() noexcept;
+        Builder& operator=(Builder const& rhs) noexcept;
+        Builder& operator=(Builder&& rhs) noexcept;
+
+        /**
+         * Specifies the library data. The library data is a binary blob produced by libfilamat
+         * or by matc.
+         *
+         * @param payload Pointer to the library data, must stay valid until build() is called.
+         * @param size Size of the library data pointed to by "payload" in bytes.
+         */
+        Builder& package(const void* payload, size_t size);
+
+        /**
+         * Creates the MaterialLibrary object and returns a pointer to it.
+         *
+         * @param engine Reference to the filament::Engine to associate this MaterialLibrary with.
+         *
+         * @return pointer to the newly created object or nullptr if the package is invalid or
+         *         wasn't built for the Engine's backend.
+         */
+        MaterialLibrary* build(Engine& engine);
+
+    private:
+        friend class FMaterialLibrary;
+    };
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_MATERIAL_LIBRARY_H
@@ -400,6 +400,13 @@ public:
      */
     void setMorphWeights(Instance instance, math::float4 const& weights) noexcept;
 
+    /**
+     * Gets the vertex morphing weights of a renderable.
+     *
+     * @see setMorphWeights()
+     */
+    math::float4 getMorphWeights(Instance instance) const noexcept;
+
     /**
      * Gets the bounding box used for frustum culling.
      *
@@ -112,6 +112,22 @@ public:
      */
     Instance getInstance(utils::Entity e) const noexcept;
 
+    /**
+     * Returns the number of components in the TransformManager, note that components are not
+     * guaranteed to be active. Use the EntityManager::isAlive() before use if needed.
+     *
+     * @return number of components in the TransformManager
+     */
+    size_t getComponentCount() const noexcept;
+
+    /**
+     * Returns the list of Entity for all components. Use getComponentCount() to know the size
+     * of the list. The component of the Entity at index k has the Instance k + 1, this can be
+     * used to check that a previously retrieved Instance is still the Entity's.
+     * @return a pointer to Entity
+     */
+    utils::Entity const* getEntities() const noexcept;
+
     /**
      * Creates a transform component and associate it with the given entity.
      * @param entity            An Entity to associate a transform component to.
@@ -202,6 +218,37 @@ public:
      */
     void setTransform(Instance ci, const math::mat4f& localTransform) noexcept;
 
+    /**
+     * Sets the local transforms of several transform components at once. This is equivalent
+     * to calling setTransform() for each of them, but the world transforms are computed once all
+     * the local transforms are set, and each updated subtree of the hierarchy is only transformed
+     * once, which is much faster when updating a lot of transforms, e.g. for animations. The cost
+     * is proportional to the size of the updated subtrees plus the depth of the updated
+     * components.
+     *
+     * If a local transform transaction is open, the world transforms are computed by
+     * commitLocalTransformTransaction() instead.
+     *
+     * @param instances       The instances of the transform components to set the local
+     *                        transform to. Invalid instances are ignored.
+     * @param localTransforms The local transforms (i.e. relative to the parent), one per instance.
+     * @param count           The number of instances and local transforms.
+     * @see setTransform()
+     */
+    void setTransforms(Instance const* instances, const math::mat4f* localTransforms,
+            size_t count) noexcept;
+
+    /**
+     * Sets the local transforms of several transform components at once, reading them with the
+     * given stride. This allows the local transforms to be read directly from an array of
+     * structures.
+     *
+     * @param stride The distance in bytes between two consecutive local transforms.
+     * @see setTransforms(Instance const*, const math::mat4f*, size_t)
+     */
+    void setTransforms(Instance const* instances, const math::mat4f* localTransforms,
+            size_t count, size_t stride) noexcept;
+
     /**
      * Returns the local transform of a transform component.
      * @param ci The instance of the transform component to query the local transform from.
@@ -238,6 +285,9 @@ public:
      * Commits the currently open local transform transaction. When this returns, calls
      * to getWorldTransform() will return the proper value.
      *
+     * Only the world transforms of the components modified during the transaction, and of their
+     * descendants, are computed.
+     *
      * @attention failing to call this method when done updating the local transform will cause
      *            a lot of rendering problems. The system never closes the transaction
      *            automatically.
@@ -703,6 +703,25 @@ public:
      */
     void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
 
+    /**
+     * Sets the maximum number of point and spot lights this view shades.
+     *
+     * When more lights are visible, only the ones contributing the most to the image are kept.
+     * A light's contribution is estimated from its intensity and from the part of the viewport
+     * its sphere of influence covers. Lights entering or leaving the budget fade in or out over
+     * a few frames, and the lights already shaded are favored over the others, so that lights
+     * don't pop or flicker when the contributions change.
+     *
+     * @param count Maximum number of point and spot lights, clamped to 256. (Default 256).
+     */
+    void setDynamicLightBudget(uint32_t count) noexcept;
+
+    /**
+     * Returns the maximum number of point and spot lights this view shades.
+     * @return value set by setDynamicLightBudget().
+     */
+    uint32_t getDynamicLightBudget() const noexcept;
+
     /*
      * Set the shadow mapping technique this View uses.
      *
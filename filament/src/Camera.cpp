@@ -230,8 +230,8 @@ math::details::TMat44<T> inverseProjection(const math::details::TMat44<T>& p) no
 UTILS_NOINLINE
 mat4f FCamera::getViewMatrix(mat4f const& model) noexcept {
     // We can't use rigidTransformInverse here. The camera's model matrix might have scaling, which
-    // would make it non-rigid.
-    return inverse(model);
+    // would make it non-rigid. It is almost always affine though, which is much cheaper to invert.
+    return model.isAffine() ? mat4f::affineInverse(model) : inverse(model);
 }
 
 Frustum FCamera::getFrustum(mat4 const& projection, mat4f const& viewMatrix) noexcept {
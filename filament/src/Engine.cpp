@@ -45,7 +45,9 @@
 #include <utils/Panic.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 
 #include "generated/resources/materials.h"
 
@@ -172,6 +174,7 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
         mCameraManager(*this),
         mCommandBufferQueue(CONFIG_MIN_COMMAND_BUFFERS_SIZE, CONFIG_COMMAND_BUFFERS_SIZE),
         mPerRenderPassAllocator("per-renderpass allocator", CONFIG_PER_RENDER_PASS_ARENA_SIZE),
+        mJobSystem(0, 1, 1),
         mEngineEpoch(std::chrono::steady_clock::now()),
         mDriverBarrier(1),
         mMainThreadId(std::this_thread::get_id())
@@ -248,8 +251,16 @@ void FEngine::init() {
                     .package(MATERIALS_DEFAULTMATERIAL_DATA, MATERIALS_DEFAULTMATERIAL_SIZE)
                     .build(*const_cast<FEngine*>(this)));
 
+    // the bones uniform block of the materials is sized for FILAMENT_MAX_BONE_COUNT bones
+    const size_t maxUniformBufferSize = driverApi.getMaxUniformBufferSize();
+    ASSERT_POSTCONDITION_NON_FATAL(FScene::BONES_BLOCK_SIZE <= maxUniformBufferSize,
+            "FILAMENT_MAX_BONE_COUNT=%u needs %u bytes uniform blocks, the backend supports %u",
+            unsigned(CONFIG_MAX_BONE_COUNT), unsigned(FScene::BONES_BLOCK_SIZE),
+            unsigned(maxUniformBufferSize));
+
     mPostProcessManager.init();
     mLightManager.init(*this);
+    mTransformManager.init(*this);
     mDFG = std::make_unique<DFG>(*this);
 }
 
@@ -326,6 +337,8 @@ void FEngine::shutdown() {
     for (auto& item : mMaterialInstances) {
         cleanupResourceList(item.second);
     }
+    mMaterialInstanceUniforms.terminate(driver);
+    cleanupResourceList(mMaterialLibraries);
     cleanupResourceList(mFences);
 
     /*
@@ -366,17 +379,67 @@ void FEngine::prepare() {
     // prepare() is called once per Renderer frame. Ideally we would upload the content of
     // UBOs that are visible only. It's not such a big issue because the actual upload() is
     // skipped is the UBO hasn't changed. Still we could have a lot of these.
+    // The uniforms of the material instances are gathered in mMaterialInstanceUniforms and
+    // uploaded with a single copy.
     FEngine::DriverApi& driver = getDriverApi();
+    size_t committed = 0;
     for (auto& materialInstanceList : mMaterialInstances) {
         for (const auto& item : materialInstanceList.second) {
-            item->commit(driver);
+            committed += item->commit(driver, true);
         }
     }
+    mMaterialInstanceUniforms.commit(driver);
+    mCommittedMaterialInstanceCount = committed;
+    SYSTRACE_VALUE32("committedMaterialInstances", committed);
 
     // Commit default material instances.
     for (const auto& material : mMaterials) {
         material->getDefaultInstance()->commit(driver);
     }
+
+    compilePendingMaterials();
+    dispatchCompilationCallbacks();
+}
+
+void FEngine::scheduleMaterialCompilation(FMaterial* material) noexcept {
+    auto pos = std::find(mPendingCompilations.begin(), mPendingCompilations.end(), material);
+    if (pos == mPendingCompilations.end()) {
+        mPendingCompilations.push_back(material);
+    }
+}
+
+void FEngine::scheduleCompilationCallback(
+        Material::CompilationCallback callback, void* user) noexcept {
+    // the programs are created on the driver thread, so we complete the compilation only
+    // once it has reached this point in the command stream.
+    getDriverApi().queueCommand([this, callback, user]() {
+        std::lock_guard<utils::Mutex> guard(mCompletedCompilationsLock);
+        mCompletedCompilations.emplace_back(callback, user);
+    });
+}
+
+void FEngine::compilePendingMaterials() noexcept {
+    SYSTRACE_CALL();
+    size_t budget = MAX_PENDING_PROGRAMS_PER_FRAME;
+    auto& pending = mPendingCompilations;
+    while (budget && !pending.empty()) {
+        FMaterial* material = pending.front();
+        budget -= std::min(budget, material->compilePendingPrograms(budget));
+        if (!material->hasPendingPrograms()) {
+            pending.erase(pending.begin());
+        }
+    }
+}
+
+void FEngine::dispatchCompilationCallbacks() noexcept {
+    std::vector<std::pair<Material::CompilationCallback, void*>> completed;
+    {
+        std::lock_guard<utils::Mutex> guard(mCompletedCompilationsLock);
+        std::swap(completed, mCompletedCompilations);
+    }
+    for (auto const& item : completed) {
+        item.first(item.second);
+    }
 }
 
 void FEngine::gc() {
@@ -574,6 +637,11 @@ FColorGrading* FEngine::createColorGrading(const ColorGrading::Builder& builder)
     return create(mColorGradings, builder);
 }
 
+FMaterialLibrary* FEngine::createMaterialLibrary(
+        const MaterialLibrary::Builder& builder) noexcept {
+    return create(mMaterialLibraries, builder);
+}
+
 FStream* FEngine::createStream(const Stream::Builder& builder) noexcept {
     return create(mStreams, builder);
 }
@@ -748,6 +816,10 @@ inline bool FEngine::destroy(const FColorGrading* p) {
     return terminateAndDestroy(p, mColorGradings);
 }
 
+inline bool FEngine::destroy(const FMaterialLibrary* p) {
+    return terminateAndDestroy(p, mMaterialLibraries);
+}
+
 UTILS_NOINLINE
 bool FEngine::destroy(const FTexture* p) {
     return terminateAndDestroy(p, mTextures);
@@ -790,6 +862,9 @@ bool FEngine::destroy(const FMaterial* ptr) {
             return false;
         }
     }
+    mPendingCompilations.erase(
+            std::remove(mPendingCompilations.begin(), mPendingCompilations.end(), ptr),
+            mPendingCompilations.end());
     return terminateAndDestroy(ptr, mMaterials);
 }
 
@@ -965,6 +1040,10 @@ bool Engine::destroy(const ColorGrading* p) {
     return upcast(this)->destroy(upcast(p));
 }
 
+bool Engine::destroy(const MaterialLibrary* p) {
+    return upcast(this)->destroy(upcast(p));
+}
+
 bool Engine::destroy(const Stream* p) {
     return upcast(this)->destroy(upcast(p));
 }
@@ -24,6 +24,7 @@
 #include <filament/Viewport.h>
 
 #include <utils/BinaryTreeArray.h>
+#include <utils/Hash.h>
 #include <utils/Systrace.h>
 
 #include <math/mat4.h>
@@ -33,6 +34,7 @@
 #include <algorithm>
 
 #include <stddef.h>
+#include <string.h>
 
 using namespace filament::math;
 using namespace utils;
@@ -511,9 +513,11 @@ std::pair<size_t, size_t> Froxelizer::clipToIndices(float2 const& clip) const no
 
 
 void Froxelizer::commit(backend::DriverApi& driverApi) {
-    // send data to GPU
-    mFroxelBuffer.commit(driverApi, mFroxelBufferUser);
-    mRecordsBuffer.commit(driverApi, mRecordBufferUser);
+    // send data to GPU, unless it already has it
+    if (!mFroxelizationReused) {
+        mFroxelBuffer.commit(driverApi, mFroxelBufferUser);
+        mRecordsBuffer.commit(driverApi, mRecordBufferUser);
+    }
 #ifndef NDEBUG
     mFroxelBufferUser.clear();
     mRecordBufferUser.clear();
@@ -525,6 +529,14 @@ void Froxelizer::froxelizeLights(FEngine& engine,
         CameraInfo const& UTILS_RESTRICT camera,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     // note: this is called asynchronously
+
+    // Skip everything if the result would be the same as the previous froxelization, this is
+    // common with a static camera and static lights (e.g. architectural visualization).
+    mFroxelizationReused = updateFroxelizationState(engine, camera, lightData);
+    if (mFroxelizationReused) {
+        return;
+    }
+
     froxelizeLoop(engine, camera, lightData);
     froxelizeAssignRecordsCompress();
 
@@ -552,6 +564,69 @@ void Froxelizer::froxelizeLights(FEngine& engine,
 #endif
 }
 
+bool Froxelizer::updateFroxelizationState(FEngine& engine,
+        CameraInfo const& UTILS_RESTRICT camera,
+        const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
+    SYSTRACE_CALL();
+
+    static_assert(sizeof(FroxelizationLayout) == 4 * (16 + 16 + 4 + 2 + 4 + 3 + 4 + 4 + 1),
+            "FroxelizationLayout must not have padding");
+    static_assert(sizeof(FroxelizationLight) == 4 * (4 + 3 + 2),
+            "FroxelizationLight must not have padding");
+
+    const FroxelizationLayout layout = {
+            .view = camera.view,
+            .projection = mProjection,
+            .viewport = { mViewport.left, mViewport.bottom,
+                          int32_t(mViewport.width), int32_t(mViewport.height) },
+            .froxelDimension = mFroxelDimension,
+            .paramsZ = mParamsZ,
+            .paramsF = mParamsF,
+            .clipToFroxelX = mClipToFroxelX,
+            .clipToFroxelY = mClipToFroxelY,
+            .zLightNear = mZLightNear,
+            .zLightFar = mZLightFar,
+            .froxelCount = { mFroxelCountX, mFroxelCountY, mFroxelCountZ, mFroxelCount },
+            .lightCount = uint32_t(lightData.size()),
+    };
+
+    auto& lcm = engine.getLightManager();
+    auto const* UTILS_RESTRICT spheres      = lightData.data<FScene::POSITION_RADIUS>();
+    auto const* UTILS_RESTRICT directions   = lightData.data<FScene::DIRECTION>();
+    auto const* UTILS_RESTRICT instances    = lightData.data<FScene::LIGHT_INSTANCE>();
+    const size_t first = FScene::DIRECTIONAL_LIGHTS_COUNT;
+    const size_t count = lightData.size() > first ? lightData.size() - first : 0;
+    auto& lights = mPendingFroxelizationLights;
+    lights.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t j = first + i;
+        lights[i] = {
+                .sphere = spheres[j],
+                .direction = directions[j],
+                .cosSqr = lcm.getCosOuterSquared(instances[j]),
+                .invSin = lcm.getSinInverse(instances[j]),
+        };
+    }
+
+    uint32_t key = hash::murmur3((uint32_t const*)&layout, sizeof(layout) / 4, 0);
+    key = hash::murmur3((uint32_t const*)lights.data(),
+            lights.size() * sizeof(FroxelizationLight) / 4, key);
+
+    // The hash only rejects quickly, a collision must not reuse a stale froxelization.
+    const bool same = mHasFroxelization && key == mFroxelizationKey &&
+            !memcmp(&layout, &mFroxelizationLayout, sizeof(layout)) &&
+            lights.size() == mFroxelizationLights.size() &&
+            (lights.empty() || !memcmp(lights.data(), mFroxelizationLights.data(),
+                    lights.size() * sizeof(FroxelizationLight)));
+    if (!same) {
+        mFroxelizationKey = key;
+        mFroxelizationLayout = layout;
+        std::swap(mFroxelizationLights, mPendingFroxelizationLights);
+        mHasFroxelization = true;
+    }
+    return same;
+}
+
 void Froxelizer::froxelizeLoop(FEngine& engine,
         const CameraInfo& UTILS_RESTRICT camera,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
@@ -597,10 +672,11 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
 
     constexpr bool SINGLE_THREADED = false;
     if (!SINGLE_THREADED) {
+        // don't bother scheduling the groups without lights
+        const size_t lightCount = lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT;
         auto *parent = js.createJob();
-        for (size_t i = 0; i < GROUP_COUNT; i++) {
-            js.run(jobs::createJob(js, parent, std::cref(process),
-                    lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT, i, GROUP_COUNT));
+        for (size_t i = 0, c = std::min(GROUP_COUNT, lightCount); i < c; i++) {
+            js.run(jobs::createJob(js, parent, std::cref(process), lightCount, i, GROUP_COUNT));
         }
         js.runAndWait(parent);
     } else {
@@ -822,24 +898,20 @@ void Froxelizer::froxelizePointAndSpotLight(
                     size_t bx = std::numeric_limits<size_t>::max(); // horizontal begin index
                     size_t ex = 0; // horizontal end index
 
-                    // find the begin index (left side)
+                    // Find the range of froxels intersected by the reduced sphere. Froxels left
+                    // of the center are tested against their right plane, and vice-versa; the
+                    // froxel containing the center of the sphere is always participating.
+                    // Both planes are read unconditionally, which makes this loop branch-less
+                    // so it gets vectorized -- this is the hot loop with many lights.
                     for (size_t ix = x0; ix < x1; ++ix) {
-                        // The froxel that contains the center of the sphere is special,
-                        // we don't even need to do the intersection check, it's always true.
-                        if (UTILS_LIKELY(ix != xcenter)) {
-                            float4 const& plane = ix < xcenter ? planesX[ix + 1] : planesX[ix];
-                            if (spherePlaneDistanceSquared(cy, plane.x, plane.z) > 0) {
-                                // The reduced sphere from the previous stage intersects this
-                                // vertical plane, we record the min/max froxel indices
-                                bx = std::min(bx, ix);
-                                ex = std::max(ex, ix);
-                            }
-                        } else {
-                            // this is the froxel containing the center of the sphere, it is
-                            // definitely participating
-                            bx = std::min(bx, ix);
-                            ex = std::max(ex, ix);
-                        }
+                        float4 const& right = planesX[ix + 1];
+                        float4 const& left  = planesX[ix];
+                        const float dr = spherePlaneDistanceSquared(cy, right.x, right.z);
+                        const float dl = spherePlaneDistanceSquared(cy, left.x, left.z);
+                        const float d = ix < xcenter ? dr : dl;
+                        const bool intersect = ix == xcenter || d > 0;
+                        bx = intersect ? std::min(bx, ix) : bx;
+                        ex = intersect ? std::max(ex, ix) : ex;
                     }
 
                     if (UTILS_UNLIKELY(bx > ex)) {
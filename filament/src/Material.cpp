@@ -44,8 +44,9 @@ namespace filament {
 
 using namespace backend;
 
-static MaterialParser* createParser(Backend backend, const void* data, size_t size) {
-    MaterialParser* materialParser = new MaterialParser(backend, data, size);
+static MaterialParser* createParser(Backend backend, const void* data, size_t size,
+        FMaterialLibrary const* library) {
+    MaterialParser* materialParser = new MaterialParser(backend, data, size, library);
 
     MaterialParser::ParseResult materialResult = materialParser->parse();
 
@@ -55,11 +56,20 @@ static MaterialParser* createParser(Backend backend, const void* data, size_t si
 
     if (!ASSERT_POSTCONDITION_NON_FATAL(materialResult != MaterialParser::ParseResult::ERROR_MISSING_BACKEND,
                 "the material was not built for the %s backend\n", backendToString(backend))) {
+        delete materialParser;
+        return nullptr;
+    }
+
+    if (!ASSERT_POSTCONDITION_NON_FATAL(materialResult != MaterialParser::ParseResult::ERROR_MISSING_LIBRARY,
+                "the material was built with a material library, which must be passed to "
+                "Material::Builder::library()")) {
+        delete materialParser;
         return nullptr;
     }
 
     if (!ASSERT_POSTCONDITION_NON_FATAL(materialResult == MaterialParser::ParseResult::SUCCESS,
                 "could not parse the material package")) {
+        delete materialParser;
         return nullptr;
     }
 
@@ -76,6 +86,7 @@ static MaterialParser* createParser(Backend backend, const void* data, size_t si
 struct Material::BuilderDetails {
     const void* mPayload = nullptr;
     size_t mSize = 0;
+    FMaterialLibrary const* mLibrary = nullptr;
     MaterialParser* mMaterialParser = nullptr;
     bool mDefaultMaterial = false;
 };
@@ -98,9 +109,17 @@ Material::Builder& Material::Builder::package(const void* payload, size_t size)
     return *this;
 }
 
+Material::Builder& Material::Builder::library(MaterialLibrary const* library) noexcept {
+    mImpl->mLibrary = upcast(library);
+    return *this;
+}
+
 Material* Material::Builder::build(Engine& engine) {
     MaterialParser* materialParser = createParser(
-            upcast(engine).getBackend(), mImpl->mPayload, mImpl->mSize);
+            upcast(engine).getBackend(), mImpl->mPayload, mImpl->mSize, mImpl->mLibrary);
+    if (!materialParser) {
+        return nullptr;
+    }
 
     uint32_t v = 0;
     materialParser->getShaderModels(&v);
@@ -119,6 +138,7 @@ Material* Material::Builder::build(Engine& engine) {
         }
         slog.e << "Compiled material contains shader models 0x"
                 << io::hex << shaderModels.getValue() << io::dec << "." << io::endl;
+        delete materialParser;
         return nullptr;
     }
 
@@ -164,6 +184,7 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
 {
     MaterialParser* parser = builder->mMaterialParser;
     mMaterialParser = parser;
+    mLibrary = builder->mLibrary;
 
     UTILS_UNUSED_IN_RELEASE bool nameOk = parser->getName(&mName);
     assert(nameOk);
@@ -291,7 +312,7 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
         auto& cachedPrograms = mCachedPrograms;
         for (uint8_t i = 0, n = cachedPrograms.size(); i < n; ++i) {
             if (Variant(i).isDepthPass()) {
-                cachedPrograms[i] = engine.getDefaultMaterial()->getProgram(i);
+                cachedPrograms[i] = engine.getDefaultMaterial()->getOrCreateProgram(i);
             }
         }
     }
@@ -317,6 +338,9 @@ FMaterial::~FMaterial() noexcept {
 }
 
 void FMaterial::terminate(FEngine& engine) {
+    // pending compilations are abandoned, but their callbacks are still honored
+    mPendingPrograms.reset();
+    scheduleCompilationCallbacks();
     destroyPrograms(engine);
     mDefaultInstance.terminate(engine);
 }
@@ -444,6 +468,9 @@ Handle<HwProgram> FMaterial::createAndCacheProgram(Program&& p,
     auto program = mEngine.getDriverApi().createProgram(std::move(p));
     assert(program);
 
+    // The shaders have been copied into the program, release the decoded ones over budget.
+    mMaterialParser->trimShaderCache();
+
     mCachedPrograms[variantKey] = program;
     return program;
 }
@@ -522,7 +549,8 @@ void FMaterial::onEditCallback(void* userdata, const utils::CString& name, const
 
     // This is called on a web server thread so we defer clearing the program cache
     // and swapping out the MaterialParser until the next getProgram call.
-    material->mPendingEdits = createParser(engine.getBackend(), packageData, packageSize);
+    material->mPendingEdits = createParser(engine.getBackend(), packageData, packageSize,
+            material->mLibrary);
 }
 
 void FMaterial::onQueryCallback(void* userdata, uint64_t* pVariants) {
@@ -556,6 +584,92 @@ void FMaterial::destroyPrograms(FEngine& engine) {
     }
 }
 
+bool FMaterial::isVariantAvailable(uint8_t variantKey) const noexcept {
+    const ShaderModel sm = mEngine.getDriver().getShaderModel();
+    uint8_t vertexVariantKey = variantKey;
+    uint8_t fragmentVariantKey = variantKey;
+    if (getMaterialDomain() == MaterialDomain::SURFACE) {
+        if (Variant::isReserved(variantKey) ||
+                Variant::filterVariant(variantKey, isVariantLit()) != variantKey) {
+            return false;
+        }
+        vertexVariantKey = Variant::filterVariantVertex(variantKey);
+        fragmentVariantKey = Variant::filterVariantFragment(variantKey);
+    }
+    // variants can be filtered out when the material is built
+    return mMaterialParser->hasShader(sm, vertexVariantKey, ShaderType::VERTEX) &&
+           mMaterialParser->hasShader(sm, fragmentVariantKey, ShaderType::FRAGMENT);
+}
+
+void FMaterial::compile(CompilerPriorityQueue priority, UserVariantFilterMask variants,
+        CompilationCallback callback, void* user) noexcept {
+    // the variant filter only makes sense for surface materials, and depth variants are
+    // always included.
+    const uint8_t mask = getMaterialDomain() == MaterialDomain::SURFACE ?
+            uint8_t(variants | Variant::DEPTH) : uint8_t(0xFF);
+
+    for (size_t i = 0; i < VARIANT_COUNT; i++) {
+        const uint8_t variantKey = uint8_t(i);
+        if ((variantKey & ~mask) || mCachedPrograms[variantKey] ||
+                !isVariantAvailable(variantKey)) {
+            continue;
+        }
+        if (priority == CompilerPriorityQueue::HIGH) {
+            getOrCreateProgram(variantKey);
+        } else {
+            mPendingPrograms.set(i);
+        }
+    }
+
+    if (priority == CompilerPriorityQueue::HIGH || !hasPendingPrograms()) {
+        // everything we need has been handed to the backend already
+        if (callback) {
+            mEngine.scheduleCompilationCallback(callback, user);
+        }
+        return;
+    }
+
+    if (callback) {
+        mPendingCompilationCallbacks.emplace_back(callback, user);
+    }
+    mEngine.scheduleMaterialCompilation(this);
+}
+
+size_t FMaterial::compilePendingPrograms(size_t maxCount) noexcept {
+    size_t count = 0;
+    for (size_t i = 0; i < VARIANT_COUNT && count < maxCount; i++) {
+        if (mPendingPrograms[i]) {
+            mPendingPrograms.unset(i);
+            // the program might have been created by a draw call in the meantime
+            if (!mCachedPrograms[i]) {
+                getOrCreateProgram(uint8_t(i));
+                count++;
+            }
+        }
+    }
+    if (!hasPendingPrograms()) {
+        scheduleCompilationCallbacks();
+    }
+    return count;
+}
+
+size_t FMaterial::getUsedVariants(uint8_t* variants, size_t count) const noexcept {
+    size_t n = 0;
+    mUsedVariants.forEachSetBit([&](size_t variantKey) {
+        if (n < count) {
+            variants[n++] = uint8_t(variantKey);
+        }
+    });
+    return n;
+}
+
+void FMaterial::scheduleCompilationCallbacks() noexcept {
+    for (auto const& item : mPendingCompilationCallbacks) {
+        mEngine.scheduleCompilationCallback(item.first, item.second);
+    }
+    mPendingCompilationCallbacks.clear();
+}
+
 // ------------------------------------------------------------------------------------------------
 // Trampoline calling into private implementation
 // ------------------------------------------------------------------------------------------------
@@ -668,4 +782,13 @@ MaterialInstance const* Material::getDefaultInstance() const noexcept {
     return upcast(this)->getDefaultInstance();
 }
 
+void Material::compile(CompilerPriorityQueue priority, UserVariantFilterMask variants,
+        CompilationCallback callback, void* user) noexcept {
+    upcast(this)->compile(priority, variants, callback, user);
+}
+
+size_t Material::getUsedVariants(uint8_t* variants, size_t count) const noexcept {
+    return upcast(this)->getUsedVariants(variants, count);
+}
+
 } // namespace filament
@@ -28,6 +28,8 @@
 
 #include <utils/Log.h>
 
+#include <atomic>
+
 #include <string.h>
 
 using namespace filament::math;
@@ -39,13 +41,22 @@ using namespace backend;
 
 FMaterialInstance::FMaterialInstance() noexcept = default;
 
+uint32_t FMaterialInstance::nextVersion() noexcept {
+    // instances can be created and modified concurrently, only the uniqueness of the versions
+    // matters
+    static std::atomic<uint32_t> sVersion = { 0 };
+    return sVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 FMaterialInstance::FMaterialInstance(FEngine& engine, FMaterial const* material, const char* name) :
         mName(name) {
     FEngine::DriverApi& driver = engine.getDriverApi();
 
     if (!material->getUniformInterfaceBlock().isEmpty()) {
+        // setUniforms() leaves the uniforms dirty, so they're uploaded at the next commit
         mUniforms.setUniforms(material->getDefaultInstance()->getUniformBuffer());
-        mUbHandle = driver.createUniformBuffer(mUniforms.getSize(), backend::BufferUsage::DYNAMIC);
+        mArena = &engine.getMaterialInstanceUniforms();
+        mUbOffset = mArena->allocate(driver, uint32_t(mUniforms.getSize()));
     }
 
     if (!material->getSamplerInterfaceBlock().isEmpty()) {
@@ -77,7 +88,11 @@ FMaterialInstance::~FMaterialInstance() noexcept = default;
 
 void FMaterialInstance::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
-    driver.destroyUniformBuffer(mUbHandle);
+    if (mArena) {
+        mArena->free(mUbOffset, uint32_t(mUniforms.getSize()));
+    } else {
+        driver.destroyUniformBuffer(mUbHandle);
+    }
     driver.destroySamplerGroup(mSbHandle);
 }
 
@@ -96,6 +111,7 @@ void FMaterialInstance::initialize(FMaterial const* material) {
 
     mMaterialSortingKey = RenderPass::makeMaterialSortingKey(
             material->getId(), material->generateMaterialInstanceId());
+    mVersion = nextVersion();
 
     if (material->getBlendingMode() == BlendingMode::MASKED) {
         static_cast<MaterialInstance*>(this)->setParameter(
@@ -115,10 +131,17 @@ void FMaterialInstance::initialize(FMaterial const* material) {
     }
 }
 
-void FMaterialInstance::commitSlow(DriverApi& driver) const {
+void FMaterialInstance::commitSlow(DriverApi& driver, bool deferred) const {
     // update uniforms if needed
     if (mUniforms.isDirty()) {
-        driver.loadUniformBuffer(mUbHandle, mUniforms.toBufferDescriptor(driver));
+        if (mArena) {
+            mArena->update(mUbOffset, mUniforms);
+            if (!deferred) {
+                mArena->commit(driver);
+            }
+        } else {
+            driver.loadUniformBuffer(mUbHandle, mUniforms.toBufferDescriptor(driver));
+        }
     }
     if (mSamplers.isDirty()) {
         driver.updateSamplerGroup(mSbHandle, std::move(mSamplers.toCommandStream()));
@@ -130,6 +153,7 @@ inline void FMaterialInstance::setParameter(const char* name, T value) noexcept
     ssize_t offset = mMaterial->getUniformInterfaceBlock().getUniformOffset(name, 0);
     if (offset >= 0) {
         mUniforms.setUniform<T>(size_t(offset), value);  // handles specialization for mat3f
+        mVersion = nextVersion();
     }
 }
 
@@ -138,6 +162,7 @@ inline void FMaterialInstance::setParameter(const char* name, const T* value, si
     ssize_t offset = mMaterial->getUniformInterfaceBlock().getUniformOffset(name, 0);
     if (offset >= 0) {
         mUniforms.setUniformArray<T>(size_t(offset), value, count);
+        mVersion = nextVersion();
     }
 }
 
@@ -150,6 +175,7 @@ void FMaterialInstance::setParameter(const char* name,
         backend::Handle<backend::HwTexture> texture, backend::SamplerParams params) noexcept {
     size_t index = mMaterial->getSamplerInterfaceBlock().getSamplerInfo(name)->offset;
     mSamplers.setSampler(index, { texture, params });
+    mVersion = nextVersion();
 }
 
 void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
@@ -165,18 +191,22 @@ void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
 
 void FMaterialInstance::setCullingMode(CullingMode culling) noexcept {
     mCulling = culling;
+    mVersion = nextVersion();
 }
 
 void FMaterialInstance::setColorWrite(bool enable) noexcept {
     mColorWrite = enable;
+    mVersion = nextVersion();
 }
 
 void FMaterialInstance::setDepthWrite(bool enable) noexcept {
     mDepthWrite = enable;
+    mVersion = nextVersion();
 }
 
 void FMaterialInstance::setDepthCulling(bool enable) noexcept {
     mDepthFunc = enable ? RasterState::DepthFunc::GE : RasterState::DepthFunc::A;
+    mVersion = nextVersion();
 }
 
 const char* FMaterialInstance::getName() const noexcept {
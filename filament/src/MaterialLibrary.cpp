@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/MaterialLibrary.h"
+
+#include "details/Engine.h"
+
+#include "FilamentAPI-impl.h"
+
+#include <filaflat/ChunkContainer.h>
+#include <filaflat/DictionaryReader.h>
+#include <filaflat/Unflattener.h>
+
+#include <filament/MaterialChunkType.h>
+#include <filament/MaterialEnums.h>
+
+#include <utils/Panic.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace filament {
+
+using namespace backend;
+using namespace filaflat;
+using namespace filamat;
+
+static ChunkType getDictionaryTag(Backend backend) noexcept {
+    return backend == Backend::VULKAN ? ChunkType::DictionarySpirv : ChunkType::DictionaryText;
+}
+
+struct MaterialLibrary::BuilderDetails {
+    const void* mPayload = nullptr;
+    size_t mSize = 0;
+};
+
+using BuilderType = MaterialLibrary;
+BuilderType::Builder::Builder() noexcept = default;
+BuilderType::Builder::~Builder() noexcept = default;
+BuilderType::Builder::Builder(BuilderType::Builder const& rhs) noexcept = default;
+BuilderType::Builder::Builder(BuilderType::Builder&& rhs) noexcept = default;
+BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder const& rhs) noexcept = default;
+BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder&& rhs) noexcept = default;
+
+MaterialLibrary::Builder& MaterialLibrary::Builder::package(const void* payload, size_t size) {
+    mImpl->mPayload = payload;
+    mImpl->mSize = size;
+    return *this;
+}
+
+MaterialLibrary* MaterialLibrary::Builder::build(Engine& engine) {
+    ChunkContainer container(mImpl->mPayload, mImpl->mSize);
+    if (!ASSERT_POSTCONDITION_NON_FATAL(container.parse() &&
+            container.hasChunk(ChunkType::MaterialVersion) &&
+            container.hasChunk(ChunkType::DictionaryLibrary),
+            "could not parse the material library package")) {
+        return nullptr;
+    }
+
+    uint32_t version = 0;
+    Unflattener versionUnflattener(
+            container.getChunkStart(ChunkType::MaterialVersion),
+            container.getChunkEnd(ChunkType::MaterialVersion));
+    versionUnflattener.read(&version);
+    ASSERT_PRECONDITION(version == MATERIAL_VERSION, "Material library version mismatch. "
+            "Expected %d but received %d.", MATERIAL_VERSION, version);
+
+    const Backend backend = upcast(engine).getBackend();
+    if (!ASSERT_POSTCONDITION_NON_FATAL(container.hasChunk(getDictionaryTag(backend)),
+            "the material library was not built for the %s backend\n",
+            backendToString(backend))) {
+        return nullptr;
+    }
+
+    return upcast(engine).createMaterialLibrary(*this);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+FMaterialLibrary::FMaterialLibrary(FEngine& engine, const Builder& builder) {
+    // The dictionary is read lazily, it references the package, which we must keep.
+    const size_t size = builder->mSize;
+    mPayload = malloc(size);
+    memcpy(mPayload, builder->mPayload, size);
+
+    ChunkContainer container(mPayload, size);
+    container.parse();
+
+    Unflattener unflattener(
+            container.getChunkStart(ChunkType::DictionaryLibrary),
+            container.getChunkEnd(ChunkType::DictionaryLibrary));
+    unflattener.read(&mId);
+
+    mDictionary.setDecodedSizeLimit(FILAMENT_MATERIAL_SHADER_CACHE_SIZE_IN_KB * 1024u);
+    UTILS_UNUSED_IN_RELEASE bool ok = DictionaryReader::unflatten(container,
+            getDictionaryTag(engine.getBackend()), mDictionary, true);
+    assert(ok);
+}
+
+FMaterialLibrary::~FMaterialLibrary() noexcept {
+    free(mPayload);
+}
+
+void FMaterialLibrary::terminate(FEngine& engine) {
+}
+
+} // namespace filament
@@ -17,6 +17,8 @@
 
 #include "MaterialParser.h"
 
+#include "details/MaterialLibrary.h"
+
 #include <filaflat/BlobDictionary.h>
 #include <filaflat/ChunkContainer.h>
 #include <filaflat/MaterialChunk.h>
@@ -43,10 +45,13 @@ namespace filament {
 
 // ------------------------------------------------------------------------------------------------
 
-MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend, const void* data, size_t size)
+MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend, const void* data, size_t size,
+        FMaterialLibrary const* library)
         : mManagedBuffer(data, size),
           mChunkContainer(mManagedBuffer.data(), mManagedBuffer.size()),
-          mMaterialChunk(mChunkContainer) {
+          mMaterialChunk(mChunkContainer),
+          mLibrary(library) {
+    mBlobDictionary.setDecodedSizeLimit(FILAMENT_MATERIAL_SHADER_CACHE_SIZE_IN_KB * 1024u);
     switch (backend) {
         case Backend::OPENGL:
             mMaterialTag = ChunkType::MaterialGlsl;
@@ -79,10 +84,15 @@ bool MaterialParser::MaterialParserDetails::getFromSimpleChunk(filamat::ChunkTyp
     return false;
 }
 
+BlobDictionary& MaterialParser::MaterialParserDetails::getDictionary() noexcept {
+    return mUsesLibrary ? mLibrary->getDictionary() : mBlobDictionary;
+}
+
 // ------------------------------------------------------------------------------------------------
 
-MaterialParser::MaterialParser(Backend backend, const void* data, size_t size)
-        : mImpl(backend, data, size) {
+MaterialParser::MaterialParser(Backend backend, const void* data, size_t size,
+        FMaterialLibrary const* library)
+        : mImpl(backend, data, size, library) {
 }
 
 ChunkContainer& MaterialParser::getChunkContainer() noexcept {
@@ -96,11 +106,27 @@ ChunkContainer const& MaterialParser::getChunkContainer() const noexcept {
 MaterialParser::ParseResult MaterialParser::parse() noexcept {
     ChunkContainer& cc = getChunkContainer();
     if (cc.parse()) {
-        if (!cc.hasChunk(mImpl.mMaterialTag) || !cc.hasChunk(mImpl.mDictionaryTag)) {
+        if (!cc.hasChunk(mImpl.mMaterialTag)) {
             return ParseResult::ERROR_MISSING_BACKEND;
         }
-        if (!DictionaryReader::unflatten(cc, mImpl.mDictionaryTag, mImpl.mBlobDictionary)) {
-            return ParseResult::ERROR_OTHER;
+        if (cc.hasChunk(ChunkType::DictionaryLibrary)) {
+            // The shaders are in the dictionary of a material library, which must be the one
+            // the material was built with.
+            uint64_t id = 0;
+            mImpl.getFromSimpleChunk(ChunkType::DictionaryLibrary, &id);
+            if (!mImpl.mLibrary || mImpl.mLibrary->getId() != id) {
+                return ParseResult::ERROR_MISSING_LIBRARY;
+            }
+            mImpl.mUsesLibrary = true;
+        } else {
+            if (!cc.hasChunk(mImpl.mDictionaryTag)) {
+                return ParseResult::ERROR_MISSING_BACKEND;
+            }
+            // Shaders are only decoded when they're needed, most variants are never used.
+            if (!DictionaryReader::unflatten(cc, mImpl.mDictionaryTag, mImpl.mBlobDictionary,
+                    true)) {
+                return ParseResult::ERROR_OTHER;
+            }
         }
         if (!mImpl.mMaterialChunk.readIndex(mImpl.mMaterialTag)) {
             return ParseResult::ERROR_OTHER;
@@ -270,7 +296,16 @@ bool MaterialParser::getRefractionType(RefractionType* value) const noexcept {
 bool MaterialParser::getShader(ShaderBuilder& shader,
         ShaderModel shaderModel, uint8_t variant, ShaderType stage) noexcept {
     return mImpl.mMaterialChunk.getShader(shader,
-            mImpl.mBlobDictionary, (uint8_t)shaderModel, variant, stage);
+            mImpl.getDictionary(), (uint8_t)shaderModel, variant, stage);
+}
+
+bool MaterialParser::hasShader(ShaderModel shaderModel,
+        uint8_t variant, ShaderType stage) const noexcept {
+    return mImpl.mMaterialChunk.hasShader((uint8_t)shaderModel, variant, (uint8_t)stage);
+}
+
+void MaterialParser::trimShaderCache() noexcept {
+    mImpl.getDictionary().trim();
 }
 
 // ------------------------------------------------------------------------------------------------
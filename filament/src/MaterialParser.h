@@ -38,13 +38,16 @@ class Unflattener;
 
 namespace filament {
 
+class FMaterialLibrary;
 class UniformInterfaceBlock;
 class SamplerInterfaceBlock;
 struct SubpassInfo;
 
 class MaterialParser {
 public:
-    MaterialParser(backend::Backend backend, const void* data, size_t size);
+    // library is the material library the shaders are read from, if the material uses one.
+    MaterialParser(backend::Backend backend, const void* data, size_t size,
+            FMaterialLibrary const* library = nullptr);
 
     MaterialParser(MaterialParser const& rhs) noexcept = delete;
     MaterialParser& operator=(MaterialParser const& rhs) noexcept = delete;
@@ -52,6 +55,7 @@ public:
     enum class ParseResult {
         SUCCESS,
         ERROR_MISSING_BACKEND,
+        ERROR_MISSING_LIBRARY,
         ERROR_OTHER
     };
 
@@ -93,13 +97,24 @@ public:
     bool getShader(filaflat::ShaderBuilder& shader, backend::ShaderModel shaderModel,
             uint8_t variant, backend::ShaderType stage) noexcept;
 
+    bool hasShader(backend::ShaderModel shaderModel,
+            uint8_t variant, backend::ShaderType stage) const noexcept;
+
+    // SPIR-V shaders are decoded on demand by getShader(). This releases the least recently used
+    // ones, down to FILAMENT_MATERIAL_SHADER_CACHE_SIZE_IN_KB.
+    void trimShaderCache() noexcept;
+
 private:
     struct MaterialParserDetails {
-        MaterialParserDetails(backend::Backend backend, const void* data, size_t size);
+        MaterialParserDetails(backend::Backend backend, const void* data, size_t size,
+                FMaterialLibrary const* library);
 
         template<typename T>
         bool getFromSimpleChunk(filamat::ChunkType type, T* value) const noexcept;
 
+        // Returns the library's dictionary if the material uses one, or its own otherwise.
+        filaflat::BlobDictionary& getDictionary() noexcept;
+
     private:
         friend class MaterialParser;
 
@@ -126,6 +141,8 @@ private:
         // Keep MaterialChunk alive between calls to getShader to avoid reload the shader index.
         filaflat::MaterialChunk mMaterialChunk;
         filaflat::BlobDictionary mBlobDictionary;
+        FMaterialLibrary const* mLibrary = nullptr;
+        bool mUsesLibrary = false;
         filamat::ChunkType mMaterialTag = filamat::ChunkType::Unknown;
         filamat::ChunkType mDictionaryTag = filamat::ChunkType::Unknown;
     };
@@ -51,10 +51,12 @@ RenderPass::RenderPass(RenderPass const& rhs) = default;
 RenderPass::~RenderPass() noexcept = default;
 
 void RenderPass::setGeometry(FScene::RenderableSoa const& soa, Range<uint32_t> vr,
-        backend::Handle<backend::HwUniformBuffer> uboHandle) noexcept {
+        backend::Handle<backend::HwUniformBuffer> uboHandle,
+        backend::Handle<backend::HwUniformBuffer> bonesHandle) noexcept {
     mRenderableSoa = &soa;
     mVisibleRenderables = vr;
     mUboHandle = uboHandle;
+    mBonesHandle = bonesHandle;
 }
 
 void RenderPass::setCamera(const CameraInfo& camera) noexcept {
@@ -201,6 +203,7 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
                 mPolygonOffsetOverride ? &dummyPolyOffset : &pipeline.polygonOffset;
 
         Handle<HwUniformBuffer> uboHandle = mUboHandle;
+        Handle<HwUniformBuffer> bonesHandle = mBonesHandle;
         FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
         FMaterial const* UTILS_RESTRICT ma = nullptr;
         auto const& customCommands = mCustomCommands;
@@ -233,9 +236,15 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
             size_t offset = info.index * sizeof(PerRenderableUib);
             driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
                     uboHandle, offset, sizeof(PerRenderableUib));
-            if (UTILS_UNLIKELY(info.perRenderableBones)) {
-                driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES,
-                        info.perRenderableBones);
+            if (UTILS_UNLIKELY(info.bonesOffset != FScene::NO_BONES)) {
+#if defined(__EMSCRIPTEN__)
+                // WebGL requires the bound range to cover the whole uniform block
+                const size_t bonesSize = FScene::BONES_BLOCK_SIZE;
+#else
+                const size_t bonesSize = FScene::getBonesSize(info.bonesOffset);
+#endif
+                driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_BONES, bonesHandle,
+                        FScene::getBonesOffset(info.bonesOffset), bonesSize);
             }
             driver.draw(pipeline, info.primitiveHandle);
         }
@@ -355,7 +364,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
     auto const* const UTILS_RESTRICT soaReversedWinding = soa.data<FScene::REVERSED_WINDING_ORDER>();
     auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
     auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
-    auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaBonesOffset     = soa.data<FScene::BONES_OFFSET>();
     auto const* const UTILS_RESTRICT soaVisibilityMask  = soa.data<FScene::VISIBLE_MASK>();
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
@@ -429,7 +438,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
 
         cmdColor.key = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdColor.primitive.index = (uint16_t)i;
-        cmdColor.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdColor.primitive.bonesOffset = soaBonesOffset[i];
         materialVariant.setShadowReceiver(soaVisibility[i].receiveShadows & hasShadowing);
         materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
 
@@ -440,7 +449,7 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
         cmdDepth.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdDepth.key |= makeField(distanceBits, DISTANCE_BITS_MASK, DISTANCE_BITS_SHIFT);
         cmdDepth.primitive.index = (uint16_t)i;
-        cmdDepth.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdDepth.primitive.bonesOffset = soaBonesOffset[i];
         cmdDepth.primitive.materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
         cmdDepth.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
 
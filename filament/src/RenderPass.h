@@ -212,7 +212,7 @@ public:
     struct PrimitiveInfo { // 24 bytes
         FMaterialInstance const* mi = nullptr;                          // 8 bytes (4)
         backend::Handle<backend::HwRenderPrimitive> primitiveHandle;    // 4 bytes
-        backend::Handle<backend::HwUniformBuffer> perRenderableBones;   // 4 bytes
+        uint32_t bonesOffset = FScene::NO_BONES;                        // 4 bytes
         backend::RasterState rasterState;                               // 4 bytes
         uint16_t index = 0;                                             // 2 bytes
         Variant materialVariant;                                        // 1 byte
@@ -247,7 +247,8 @@ public:
 
     void overridePolygonOffset(backend::PolygonOffset* polygonOffset) noexcept;
     void setGeometry(FScene::RenderableSoa const& soa, utils::Range<uint32_t> vr,
-            backend::Handle<backend::HwUniformBuffer> uboHandle) noexcept;
+            backend::Handle<backend::HwUniformBuffer> uboHandle,
+            backend::Handle<backend::HwUniformBuffer> bonesHandle) noexcept;
     void setCamera(const CameraInfo& camera) noexcept;
     void setRenderFlags(RenderFlags flags) noexcept;
 
@@ -339,6 +340,8 @@ private:
     utils::Range<uint32_t> mVisibleRenderables{};
     // the UBO containing the data for the renderables
     backend::Handle<backend::HwUniformBuffer> mUboHandle;
+    // the UBO containing the bones of the renderables, i.e. the bone palette
+    backend::Handle<backend::HwUniformBuffer> mBonesHandle;
 
     // info about the camera
     CameraInfo mCamera;
@@ -31,6 +31,7 @@
 #include <utils/Zip2Iterator.h>
 
 #include <algorithm>
+#include <memory>
 
 using namespace filament::math;
 using namespace utils;
@@ -122,7 +123,7 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
                     worldTransform,           // WORLD_TRANSFORM
                     reversedWindingOrder,     // REVERSED_WINDING_ORDER
                     rcm.getVisibility(ri),    // VISIBILITY_STATE
-                    rcm.getBonesUbh(ri),      // BONES_UBH
+                    rcm.hasBones(ri) ? 0u : NO_BONES, // BONES_OFFSET
                     worldAABB.center,         // WORLD_AABB_CENTER
                     0,                        // VISIBLE_MASK
                     rcm.getMorphWeights(ri),  // MORPH_WEIGHTS
@@ -156,7 +157,7 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
                     d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
                 }
                 lightData.push_back_unsafe(
-                        float4{ p.xyz, lcm.getRadius(li) }, d, li, {}, {}, {});
+                        float4{ p.xyz, lcm.getRadius(li) }, d, li, {}, {}, {}, 1.0f);
             }
         }
     }
@@ -241,9 +242,55 @@ void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Hand
     }
 }
 
+size_t FScene::prepareBones(utils::Range<uint32_t> visibleRenderables,
+        std::vector<uint64_t>* layout) noexcept {
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+    auto& sceneData = mRenderableData;
+    auto const* const UTILS_RESTRICT instances = sceneData.data<RENDERABLE_INSTANCE>();
+    uint32_t* const UTILS_RESTRICT offsets = sceneData.data<BONES_OFFSET>();
+    layout->clear();
+    size_t size = 0;
+    for (uint32_t i : visibleRenderables) {
+        if (UTILS_UNLIKELY(offsets[i] != NO_BONES)) {
+            // renderables using only morphing have no bones, but still need a bone palette bound
+            const size_t count = std::max(rcm.getBoneCount(instances[i]), 1u);
+            const size_t bonesSize = (count * sizeof(PerRenderableUibBone) + BONES_ALIGNMENT - 1) &
+                    ~(BONES_ALIGNMENT - 1);
+            offsets[i] = uint32_t(size) | uint32_t(bonesSize / BONES_ALIGNMENT - 1);
+            size += bonesSize;
+            layout->push_back(uint64_t(instances[i].asValue()) << 32u |
+                    rcm.getBonesVersion(instances[i]));
+        }
+    }
+    return size;
+}
+
+void FScene::updateBonesUBO(utils::Range<uint32_t> visibleRenderables, size_t size,
+        backend::Handle<backend::HwUniformBuffer> bonesUbh) noexcept {
+    FEngine::DriverApi& driver = mEngine.getDriverApi();
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+
+    // The bone palette can be too large for the command stream, and is uploaded only once.
+    char* const buffer = (char*)malloc(size);
+
+    auto& sceneData = mRenderableData;
+    auto const* const UTILS_RESTRICT instances = sceneData.data<RENDERABLE_INSTANCE>();
+    uint32_t const* const UTILS_RESTRICT offsets = sceneData.data<BONES_OFFSET>();
+    for (uint32_t i : visibleRenderables) {
+        if (UTILS_UNLIKELY(offsets[i] != NO_BONES)) {
+            std::uninitialized_copy_n(rcm.getBones(instances[i]), rcm.getBoneCount(instances[i]),
+                    reinterpret_cast<PerRenderableUibBone*>(buffer + getBonesOffset(offsets[i])));
+        }
+    }
+
+    driver.loadUniformBuffer(bonesUbh, { buffer, size,
+            [](void* buffer, size_t, void*) { ::free(buffer); } });
+}
+
 void FScene::terminate(FEngine& engine) {
-    // DO NOT destroy this UBO, it's owned by the View
+    // DO NOT destroy these UBOs, they're owned by the View
     mRenderableViewUbh.clear();
+    mBonesViewUbh.clear();
 }
 
 void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootArena, backend::Handle<backend::HwUniformBuffer> lightUbh) noexcept {
@@ -265,7 +312,7 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     size_t const size = lightData.size();
 
     // always allocate at least 4 entries, because the vectorized loops below rely on that
-    float* const UTILS_RESTRICT distances = arena.allocate<float>((size + 3u) & 3u, CACHELINE_SIZE);
+    float* const UTILS_RESTRICT distances = arena.allocate<float>((size + 3u) & ~3u, CACHELINE_SIZE);
 
     // pre-compute the lights' distance to the camera plane, for sorting below
     // - we don't skip the directional light, because we don't care, it's ignored during sorting
@@ -277,11 +324,11 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     std::sort(b + DIRECTIONAL_LIGHTS_COUNT, b + size,
             [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; });
 
-    // drop excess lights
+    // drop excess lights (FView::prepareVisibleLights() already enforced the view's budget)
     lightData.resize(std::min(size, CONFIG_MAX_LIGHT_COUNT + DIRECTIONAL_LIGHTS_COUNT));
 
     // number of point/spot lights
-    size_t positionalLightCount = size - DIRECTIONAL_LIGHTS_COUNT;
+    size_t positionalLightCount = lightData.size() - DIRECTIONAL_LIGHTS_COUNT;
 
     // compute the light ranges (needed when building light trees)
     float2* const zrange = lightData.data<FScene::SCREEN_SPACE_Z_RANGE>();
@@ -292,11 +339,12 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     auto const* UTILS_RESTRICT directions       = lightData.data<FScene::DIRECTION>();
     auto const* UTILS_RESTRICT instances        = lightData.data<FScene::LIGHT_INSTANCE>();
     auto const* UTILS_RESTRICT shadowInfo       = lightData.data<FScene::SHADOW_INFO>();
-    for (size_t i = DIRECTIONAL_LIGHTS_COUNT, c = size; i < c; ++i) {
+    auto const* UTILS_RESTRICT fade             = lightData.data<FScene::FADE>();
+    for (size_t i = DIRECTIONAL_LIGHTS_COUNT, c = lightData.size(); i < c; ++i) {
         const size_t gpuIndex = i - DIRECTIONAL_LIGHTS_COUNT;
         auto li = instances[i];
         lp[gpuIndex].positionFalloff      = { spheres[i].xyz, lcm.getSquaredFalloffInv(li) };
-        lp[gpuIndex].colorIntensity       = { lcm.getColor(li), lcm.getIntensity(li) };
+        lp[gpuIndex].colorIntensity       = { lcm.getColor(li), lcm.getIntensity(li) * fade[i] };
         lp[gpuIndex].directionIES         = { directions[i], 0.0f };
         lp[gpuIndex].spotScaleOffset      = lcm.getSpotParams(li).scaleOffset;
         lp[gpuIndex].shadow               = { shadowInfo[i].pack() };
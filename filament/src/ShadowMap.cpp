@@ -77,7 +77,8 @@ void ShadowMap::render(DriverApi& driver, FView::Range const& range, RenderPass&
     filament::CameraInfo cameraInfo(camera);
 
     pass.setCamera(cameraInfo);
-    pass.setGeometry(scene.getRenderableData(), range, scene.getRenderableUBO());
+    pass.setGeometry(scene.getRenderableData(), range, scene.getRenderableUBO(),
+            scene.getBonesUBO());
 
     // updatePrimitivesLod must be run before appendCommands.
     view.updatePrimitivesLod(engine, cameraInfo, scene.getRenderableData(), range);
@@ -600,12 +601,14 @@ mat4f ShadowMap::getTextureCoordsMapping() const noexcept {
             0.0f, 0.0f, 0.0f, 1.0f
     });
 
-    // apply the 1-texel border viewport transform
-    const float o = 1.0f / mShadowMapLayout.atlasDimension;
+    // apply the 1-texel border viewport transform, and move to the shadow map's position
+    // within the atlas
+    const float2 o = (float2(mShadowMapLayout.textureOffset) + 1.0f) /
+            mShadowMapLayout.atlasDimension;
     const float s = 1.0f - 2.0f * (1.0f / mShadowMapLayout.textureDimension);
     const mat4f Mb(mat4f::row_major_init{
-             s,    0.0f, 0.0f, o,
-             0.0f, s,    0.0f, o,
+             s,    0.0f, 0.0f, o.x,
+             0.0f, s,    0.0f, o.y,
              0.0f, 0.0f, 1.0f, 0.0f,
              0.0f, 0.0f, 0.0f, 1.0f
     });
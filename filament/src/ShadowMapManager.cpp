@@ -14,15 +14,24 @@
  * limitations under the License.
  */
 
+#include "details/MaterialInstance.h"
+#include "details/RenderPrimitive.h"
 #include "details/ShadowMap.h"
 #include "details/ShadowMapManager.h"
 #include "details/Texture.h"
 #include "details/View.h"
 
 #include "RenderPass.h"
+#include "ResourceAllocator.h"
 
 #include <private/filament/SibGenerator.h>
 
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+
 namespace filament {
 
 using namespace backend;
@@ -73,10 +82,13 @@ void ShadowMapManager::addSpotShadowMap(size_t lightIndex) noexcept {
     mSpotShadowMaps.emplace_back(mSpotShadowMapCache[maps].get(), lightIndex);
 }
 
+void ShadowMapManager::terminate(FEngine& engine) noexcept {
+    mCachedTexture.destroy(engine.getResourceAllocator());
+    mCachedTexture = {};
+}
+
 void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
         backend::DriverApi& driver, RenderPass& pass) noexcept {
-    constexpr size_t MAX_SHADOW_LAYERS =
-        CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
     struct ShadowPassData {
         FrameGraphId<FrameGraphTexture> shadows;
         FrameGraphId<FrameGraphTexture> tempDepth;
@@ -90,10 +102,51 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
 
     assert(mTextureRequirements.layers <= MAX_SHADOW_LAYERS);
 
+    const bool fillWithCheckerboard = engine.debug.shadowmap.checkerboard && !view.hasVsm();
+
+    FrameGraphTexture::Descriptor shadowTextureDesc {
+        .width = mTextureRequirements.size, .height = mTextureRequirements.size,
+        .depth = mTextureRequirements.layers,
+        .levels = mTextureRequirements.levels,
+        .type = SamplerType::SAMPLER_2D_ARRAY,
+        .format = mTextureFormat,
+        .usage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE
+            | (fillWithCheckerboard ? TextureUsage::UPLOADABLE : (TextureUsage) 0)
+    };
+
+    if (view.hasVsm()) {
+        // TODO: support 16-bit VSM depth textures.
+        shadowTextureDesc.format = TextureFormat::RG32F;
+        shadowTextureDesc.usage = TextureUsage::COLOR_ATTACHMENT |
+                TextureUsage::SAMPLEABLE;
+    }
+
+    // When possible, the shadow texture is kept from one frame to the next and only the layers
+    // whose content changed are rendered again.
+    auto isCached = [](ShadowMapEntry const& map) { return map.isCached(); };
+    const bool useCache = !view.hasVsm() && !fillWithCheckerboard &&
+            (std::any_of(mCascadeShadowMaps.begin(), mCascadeShadowMaps.end(), isCached) ||
+             std::any_of(mSpotShadowMaps.begin(), mSpotShadowMaps.end(), isCached));
+    const uint32_t dirtyLayers = useCache ?
+            updateCache(engine, view, shadowTextureDesc) : ~0u;
+    if (!useCache && mCachedTexture.texture) {
+        terminate(engine);
+    }
+
+    FrameGraphId<FrameGraphTexture> cachedShadows;
+    if (mCachedTexture.texture) {
+        cachedShadows = fg.import("Cached Shadow Texture", mCachedTextureDesc, mCachedTexture);
+        if (!dirtyLayers) {
+            // nothing to render, the shadow texture of the previous frame can be used as is
+            fg.getBlackboard().put("shadows", cachedShadows);
+            return;
+        }
+    }
+
     // These loops fill render passes with appropriate rendering commands for each shadow map.
     // The actual render pass execution is deferred to the frame graph.
     for (const auto& map : mCascadeShadowMaps) {
-        if (!map.hasVisibleShadows()) {
+        if (!map.hasVisibleShadows() || !(dirtyLayers & (1u << map.getLayout().layer))) {
             continue;
         }
 
@@ -108,7 +161,7 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     }
     for (size_t i = 0; i < mSpotShadowMaps.size(); i++) {
         const auto& map = mSpotShadowMaps[i];
-        if (!map.hasVisibleShadows()) {
+        if (!map.hasVisibleShadows() || !(dirtyLayers & (1u << map.getLayout().layer))) {
             continue;
         }
 
@@ -123,32 +176,17 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
         assert(layer < MAX_SHADOW_LAYERS);
         layerSampleCount[layer] = map.getLayout().vsmSamples;
     }
-    assert(passes.size() <= mTextureRequirements.layers);
-
-    const bool fillWithCheckerboard = engine.debug.shadowmap.checkerboard && !view.hasVsm();
+    assert(passes.size() <= MAX_SHADOW_LAYERS);
 
     auto& shadowPass = fg.addPass<ShadowPassData>("Shadow Pass",
             [&](FrameGraph::Builder& builder, auto& data) {
-                FrameGraphTexture::Descriptor shadowTextureDesc {
-                    .width = mTextureRequirements.size, .height = mTextureRequirements.size,
-                    .depth = mTextureRequirements.layers,
-                    .levels = mTextureRequirements.levels,
-                    .type = SamplerType::SAMPLER_2D_ARRAY,
-                    .format = mTextureFormat,
-                    .usage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE
-                        | (fillWithCheckerboard ? TextureUsage::UPLOADABLE : (TextureUsage) 0)
-                };
-
-                if (view.hasVsm()) {
-                    // TODO: support 16-bit VSM depth textures.
-                    shadowTextureDesc.format = TextureFormat::RG32F;
-                    shadowTextureDesc.usage = TextureUsage::COLOR_ATTACHMENT |
-                            TextureUsage::SAMPLEABLE;
+                if (cachedShadows.isValid()) {
+                    data.shadows = builder.write(cachedShadows);
+                } else {
+                    data.shadows = builder.createTexture("Shadow Texture", shadowTextureDesc);
+                    data.shadows = builder.write(data.shadows);
                 }
 
-                data.shadows = builder.createTexture("Shadow Texture", shadowTextureDesc);
-                data.shadows = builder.write(data.shadows);
-
                 if (view.hasVsm()) {
                     // When rendering VSM shadow maps, we still need a depth texture for correct
                     // sorting. The texture is cleared before each pass and discarded afterwards.
@@ -187,6 +225,9 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             },
             [=, passes = std::move(passes), &view, &engine](FrameGraphPassResources const& resources,
                     auto const& data, DriverApi& driver) mutable {
+                // Several shadow maps can share a layer, only the first pass rendering into a
+                // layer clears it, the following ones must preserve its content.
+                uint32_t clearedLayers = 0;
                 for (auto& [map, pass] : passes) {
                     FCamera const& camera = map->getShadowMap()->getCamera();
                     filament::CameraInfo cameraInfo(camera);
@@ -202,7 +243,9 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
                     // attachments to anything greater than 1.0, so we'd need a way to do this other
                     // than clearing.
                     const uint32_t dim = map->getLayout().size;
-                    filament::Viewport viewport { 1, 1, dim - 2, dim - 2 };
+                    const uint2 offset = map->getLayout().offset;
+                    filament::Viewport viewport {
+                            int32_t(offset.x + 1), int32_t(offset.y + 1), dim - 2, dim - 2 };
                     view.prepareViewport(viewport);
 
                     view.commitUniforms(driver);
@@ -210,6 +253,15 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
                     const auto layer = map->getLayout().layer;
                     auto rt = resources.get(data.rt[layer]);
                     rt.params.viewport = viewport;
+                    if (clearedLayers & (1u << layer)) {
+                        rt.params.flags.clear = TargetBufferFlags::NONE;
+                        rt.params.flags.discardStart = TargetBufferFlags::NONE;
+                    }
+                    clearedLayers |= 1u << layer;
+                    if (useCache) {
+                        // the content of the shadow texture must be kept for the next frame
+                        rt.params.flags.discardEnd = TargetBufferFlags::NONE;
+                    }
 
                     auto polygonOffset = map->getShadowMap()->getPolygonOffset();
                     pass.overridePolygonOffset(&polygonOffset);
@@ -217,6 +269,11 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
                     pass.execute("Shadow Pass", rt.target, rt.params);
                 }
 
+                if (useCache && !cachedShadows.isValid()) {
+                    // keep the new shadow texture for the next frames
+                    resources.detach(data.shadows, &mCachedTexture, &mCachedTextureDesc);
+                }
+
                 engine.flush(); // Wake-up the driver thread
             });
 
@@ -256,6 +313,109 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     fg.getBlackboard().put("shadows", shadows);
 }
 
+uint32_t ShadowMapManager::updateCache(FEngine& engine, FView const& view,
+        FrameGraphTexture::Descriptor const& desc) noexcept {
+    SYSTRACE_CALL();
+
+    auto const& d = mCachedTextureDesc;
+    if (d.width != desc.width || d.height != desc.height || d.depth != desc.depth ||
+            d.levels != desc.levels || d.format != desc.format || d.usage != desc.usage) {
+        terminate(engine);
+    }
+
+    // A layer can be reused if all its shadow maps are cached and none of them changed.
+    for (auto& state : mLayerStates) {
+        state.clear();
+    }
+    uint32_t cachedLayers = ~0u;
+    FRenderableManager const& rcm = engine.getRenderableManager();
+    auto const& renderableData = view.getScene()->getRenderableData();
+    auto appendLayerState = [&](ShadowMapEntry const& map, FView::Range range,
+            uint8_t visibilityMask) {
+        const uint8_t layer = map.getLayout().layer;
+        if (!map.isCached()) {
+            cachedLayers &= ~(1u << layer);
+            return;
+        }
+        if (!appendShadowMapState(*map.getShadowMap(), map.getLayout(), rcm, renderableData,
+                range, visibilityMask, &mLayerStates[layer])) {
+            cachedLayers &= ~(1u << layer);
+        }
+    };
+
+    for (auto const& map : mCascadeShadowMaps) {
+        if (map.hasVisibleShadows()) {
+            appendLayerState(map, view.getVisibleDirectionalShadowCasters(),
+                    VISIBLE_DIR_SHADOW_RENDERABLE);
+        }
+    }
+    for (size_t i = 0; i < mSpotShadowMaps.size(); i++) {
+        auto const& map = mSpotShadowMaps[i];
+        if (map.hasVisibleShadows()) {
+            appendLayerState(map, view.getVisibleSpotShadowCasters(),
+                    VISIBLE_SPOT_SHADOW_RENDERABLE_N(i));
+        }
+    }
+
+    uint32_t dirtyLayers = 0;
+    for (size_t layer = 0; layer < mTextureRequirements.layers; layer++) {
+        if (!mCachedTexture.texture || !(cachedLayers & (1u << layer)) ||
+                mLayerStates[layer] != mCachedLayerStates[layer]) {
+            dirtyLayers |= 1u << layer;
+        }
+    }
+    std::swap(mLayerStates, mCachedLayerStates);
+    return dirtyLayers;
+}
+
+template<typename T>
+static void appendState(std::vector<uint8_t>* state, T const& value) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value, "state must be trivially copyable");
+    uint8_t const* p = reinterpret_cast<uint8_t const*>(&value);
+    state->insert(state->end(), p, p + sizeof(T));
+}
+
+bool ShadowMapManager::appendShadowMapState(ShadowMap const& shadowMap,
+        ShadowLayout const& layout, FRenderableManager const& rcm,
+        FScene::RenderableSoa const& renderableData, utils::Range<uint32_t> range,
+        uint8_t visibilityMask, std::vector<uint8_t>* state) noexcept {
+    // The shadow map changes with the light's frustum, its place in the atlas, and the set of
+    // shadow casters along with their transforms, morph weights, and primitives. Rather than
+    // their content, the versions of the casters' primitives and of their material instances
+    // are compared: they change each time a primitive or an instance is set. The content of the
+    // casters' buffers and textures can't be compared, skinned casters are assumed to change at
+    // every frame.
+    // The state is appended field by field, so that no padding ends up in it.
+    appendState(state, shadowMap.getLightSpaceMatrix());
+    appendState(state, shadowMap.getPolygonOffset().slope);
+    appendState(state, shadowMap.getPolygonOffset().constant);
+    appendState(state, uint32_t(layout.layer));
+    appendState(state, layout.size);
+    appendState(state, layout.offset);
+
+    auto const* UTILS_RESTRICT visibleMask  = renderableData.data<FScene::VISIBLE_MASK>();
+    auto const* UTILS_RESTRICT instances    = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* UTILS_RESTRICT transforms   = renderableData.data<FScene::WORLD_TRANSFORM>();
+    auto const* UTILS_RESTRICT morphWeights = renderableData.data<FScene::MORPH_WEIGHTS>();
+    auto const* UTILS_RESTRICT bones        = renderableData.data<FScene::BONES_OFFSET>();
+    auto const* UTILS_RESTRICT primitives   = renderableData.data<FScene::PRIMITIVES>();
+    bool cacheable = true;
+    for (uint32_t i : range) {
+        if (!(visibleMask[i] & visibilityMask)) {
+            continue;
+        }
+        cacheable = cacheable && bones[i] == FScene::NO_BONES;
+        appendState(state, transforms[i]);
+        appendState(state, morphWeights[i]);
+        appendState(state, rcm.getPrimitivesVersion(instances[i]));
+        for (FRenderPrimitive const& primitive : primitives[i]) {
+            FMaterialInstance const* mi = primitive.getMaterialInstance();
+            appendState(state, mi ? mi->getVersion() : 0u);
+        }
+    }
+    return cacheable;
+}
+
 void ShadowMapManager::prepareShadow(backend::Handle<backend::HwTexture> texture,
         FView const& view) const noexcept {
     uint8_t anisotropy = 0;
@@ -457,7 +617,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
                 .zResolution = mTextureZResolution,
                 .atlasDimension = textureSize,
                 .textureDimension = textureDimension,
-                .shadowDimension = textureDimension - 2
+                .shadowDimension = textureDimension - 2,
+                .textureOffset = entry.getLayout().offset
         };
         shadowMap.update(lightData, l, scene, viewingCameraInfo, visibleLayers, layout, {});
 
@@ -532,15 +693,20 @@ void ShadowMapManager::calculateTextureRequirements(FEngine& engine, FView& view
         return std::max(3u, lcm.getShadowMapSize(light));
     };
 
+    auto isShadowMapCached = [&](size_t lightIndex) {
+        FLightManager::Instance light = lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
+        return lcm.getShadowOptions(light).cached;
+    };
+
     auto getShadowMapVsmSamples = [&](size_t lightIndex) {
         FLightManager::Instance light = lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
         LightManager::ShadowOptions const& options = lcm.getShadowOptions(light);
         return std::max((uint8_t) 1u, options.vsm.msaaSamples);
     };
 
-    // Lay out the shadow maps. For now, we take the largest requested dimension and allocate a
-    // texture of that size. Each cascade / shadow map gets its own layer in the array texture.
-    // The directional shadow cascades start on layer 0, followed by spot lights.
+    // Lay out the shadow maps. The texture dimension is the largest requested dimension, each
+    // cascade gets its own layer in the array texture, starting on layer 0. Spot lights follow,
+    // their shadow maps are packed together in the remaining layers.
     uint8_t layer = 0;
     uint16_t maxDimension = 0;
     for (auto& cascade : mCascadeShadowMaps) {
@@ -549,22 +715,59 @@ void ShadowMapManager::calculateTextureRequirements(FEngine& engine, FView& view
         const uint16_t dim = getShadowMapSize(lightIndex);
         const uint8_t vsmSamples = getShadowMapVsmSamples(lightIndex);
         maxDimension = std::max(maxDimension, dim);
+        cascade.setCached(isShadowMapCached(lightIndex));
         cascade.setLayout({
             .layer = layer++,
             .size = dim,
             .vsmSamples = vsmSamples
         });
     }
-    for (auto& spotShadowMap : mSpotShadowMaps) {
-        const size_t lightIndex = spotShadowMap.getLightIndex();
-        const uint16_t dim = getShadowMapSize(lightIndex);
-        const uint8_t vsmSamples = getShadowMapVsmSamples(lightIndex);
-        maxDimension = std::max(maxDimension, dim);
-        spotShadowMap.setLayout({
-            .layer = layer++,
-            .size = dim,
-            .vsmSamples = vsmSamples
-        });
+
+    if (!mSpotShadowMaps.empty()) {
+        // The resolution of a spot light shadow map depends on how much of the viewport the
+        // light covers: the requested size is halved when the light covers less than 1/4 of the
+        // viewport, and halved again below 1/16. Cached shadow maps always get their requested
+        // size, otherwise the atlas layout would change, and the cache be invalidated, whenever
+        // the camera moves. For the same reason, the texture is sized for the requested sizes.
+        const size_t count = mSpotShadowMaps.size();
+        float coverage[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+        float4 spheres[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+        for (size_t i = 0; i < count; i++) {
+            const size_t lightIndex = mSpotShadowMaps[i].getLightIndex();
+            spheres[i] = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex);
+            coverage[i] = 1.0f;
+        }
+        FView::computeLightScores(coverage, view.getCameraInfo(), spheres, count);
+
+        for (size_t i = 0; i < count; i++) {
+            auto& spotShadowMap = mSpotShadowMaps[i];
+            const size_t lightIndex = spotShadowMap.getLightIndex();
+            const uint16_t requested = getShadowMapSize(lightIndex);
+            const bool cached = isShadowMapCached(lightIndex);
+            const uint32_t shift = (coverage[i] < 1.0f / 4.0f) + (coverage[i] < 1.0f / 16.0f);
+            // VSM shadow maps can't share a layer (see below), reducing them would be pointless.
+            const uint16_t dim = (view.hasVsm() || cached) ? requested : std::max(
+                    std::min(requested, MIN_SPOT_SHADOW_MAP_SIZE), uint16_t(requested >> shift));
+            maxDimension = std::max(maxDimension, requested);
+            spotShadowMap.setCached(cached);
+            spotShadowMap.setLayout({
+                .layer = layer,
+                .size = dim,
+                .vsmSamples = getShadowMapVsmSamples(lightIndex)
+            });
+        }
+
+        if (view.hasVsm()) {
+            // VSM shadow maps each get their own layer, because each layer has its own sample
+            // count and its temporary depth buffer is cleared before each pass.
+            for (auto& spotShadowMap : mSpotShadowMaps) {
+                ShadowLayout layout = spotShadowMap.getLayout();
+                layout.layer = layer++;
+                spotShadowMap.setLayout(layout);
+            }
+        } else {
+            layer += packSpotShadowMaps(lightData, maxDimension, layer);
+        }
     }
 
     const uint8_t layersNeeded = layer;
@@ -587,6 +790,68 @@ void ShadowMapManager::calculateTextureRequirements(FEngine& engine, FView& view
     };
 }
 
+uint8_t ShadowMapManager::packSpotShadowMaps(FScene::LightSoa const& lightData,
+        uint32_t atlasDimension, uint8_t firstLayer) noexcept {
+    // The order of the spot lights changes with the camera, the shadow maps are identified by
+    // their light instead. Cached shadow maps are placed first, so that their placement doesn't
+    // depend on the uncached ones, then larger shadow maps are placed first.
+    ShadowLayout layouts[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+    uint64_t keys[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+    const size_t count = mSpotShadowMaps.size();
+    for (size_t i = 0; i < count; i++) {
+        auto const& entry = mSpotShadowMaps[i];
+        FLightManager::Instance light =
+                lightData.elementAt<FScene::LIGHT_INSTANCE>(entry.getLightIndex());
+        layouts[i] = entry.getLayout();
+        keys[i] = uint64_t(!entry.isCached()) << 63u |
+                  uint64_t(UINT16_MAX - layouts[i].size) << 32u | light.asValue();
+    }
+    const uint8_t layerCount = packShadowMaps(layouts, keys, count, atlasDimension, firstLayer);
+    for (size_t i = 0; i < count; i++) {
+        mSpotShadowMaps[i].setLayout(layouts[i]);
+    }
+    return layerCount;
+}
+
+uint8_t ShadowMapManager::packShadowMaps(ShadowLayout* layouts, uint64_t const* keys,
+        size_t count, uint32_t atlasDimension, uint8_t firstLayer) noexcept {
+    // Shadow maps are placed from left to right on shelves, which are stacked from the bottom to
+    // the top of a layer. A shelf is as high as its highest shadow map, when the shadow maps are
+    // sorted by decreasing size the first one placed on a shelf sets its height.
+    size_t order[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+    assert(count <= CONFIG_MAX_SHADOW_CASTING_SPOTS);
+    std::iota(order, order + count, 0);
+    std::sort(order, order + count, [keys](size_t lhs, size_t rhs) {
+        return keys[lhs] < keys[rhs];
+    });
+
+    uint8_t layer = firstLayer;
+    uint32_t x = 0;
+    uint32_t shelfY = 0;
+    uint32_t shelfHeight = 0;
+    for (size_t i = 0; i < count; i++) {
+        ShadowLayout& layout = layouts[order[i]];
+        const uint32_t dim = layout.size;
+        if (x + dim > atlasDimension) {
+            // start a new shelf
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+            x = 0;
+        }
+        if (shelfY + dim > atlasDimension) {
+            // start a new layer
+            layer++;
+            shelfY = 0;
+            shelfHeight = 0;
+            x = 0;
+        }
+        layout.layer = layer;
+        layout.offset = { x, shelfY };
+        x += dim;
+        shelfHeight = std::max(shelfHeight, dim);
+    }
+    return count ? uint8_t(layer - firstLayer + 1) : uint8_t(0);
+}
 
 ShadowMapManager::CascadeSplits::CascadeSplits(Params p) : mSplitCount(p.cascadeCount + 1) {
     for (size_t s = 0; s < mSplitCount; s++) {
@@ -613,22 +613,42 @@ void FTexture::generatePrefilterMipmap(FEngine& engine,
     // make the cubemap seamless
     levels[0].makeSeamless();
 
-    // Now generate all the mipmap levels
-    generateMipmaps(js, levels, images);
-
     // Finally generate each pre-filtered mipmap level
     const size_t baseExp = ctz(size);
     size_t numSamples = options->sampleCount;
     const size_t numLevels = baseExp + 1;
-    for (ssize_t i = baseExp; i >= 0; --i) {
-        const size_t dim = 1U << i;
-        const size_t level = baseExp - i;
-        const float lod = saturate(level / (numLevels - 1.0f));
-        const float linearRoughness = lod * lod;
-
-        Image image;
-        Cubemap dst = CubemapUtils::create(image, dim);
-        CubemapIBL::roughnessFilter(js, dst, levels, linearRoughness, numSamples, mirror, true);
+    std::vector<Image> filteredImages;
+    std::vector<Cubemap> filteredLevels;
+    filteredImages.reserve(numLevels);
+    filteredLevels.reserve(numLevels);
+
+    // Filtering is slow, it runs on the background threads so it doesn't compete with the
+    // frame's jobs. Only the uploads below need to happen on this thread.
+    auto filter = [&](JobSystem&, JobSystem::Job*) {
+        // Now generate all the mipmap levels
+        generateMipmaps(js, levels, images);
+
+        for (ssize_t i = baseExp; i >= 0; --i) {
+            const size_t dim = 1U << i;
+            const size_t level = baseExp - i;
+            const float lod = saturate(level / (numLevels - 1.0f));
+            const float linearRoughness = lod * lod;
+
+            Image image;
+            Cubemap dst = CubemapUtils::create(image, dim);
+            CubemapIBL::roughnessFilter(js, dst, levels, linearRoughness, numSamples, mirror, true);
+            filteredImages.push_back(std::move(image));
+            filteredLevels.push_back(std::move(dst));
+        }
+    };
+    JobSystem::Job* job = js.createJob(nullptr, std::ref(filter));
+    js.setJobName(job, "generatePrefilterMipmap");
+    job = js.runAndRetain(job, JobSystem::BACKGROUND);
+    js.waitAndRelease(job);
+
+    for (size_t level = 0; level < numLevels; level++) {
+        Image& image = filteredImages[level];
+        Cubemap const& dst = filteredLevels[level];
 
         Texture::PixelBufferDescriptor pbd(image.getData(), image.getSize(),
                 Texture::PixelBufferDescriptor::PixelDataFormat::RGB,
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UniformArena.h"
+
+#include <utils/Panic.h>
+#include <utils/Systrace.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace utils;
+
+namespace filament {
+
+using namespace backend;
+
+UniformArena::UniformArena() noexcept = default;
+
+UniformArena::~UniformArena() noexcept {
+    for (Page const& page : mPages) {
+        ::free(page.shadow);
+    }
+}
+
+void UniformArena::terminate(DriverApi& driver) {
+    for (Page& page : mPages) {
+        driver.destroyUniformBuffer(page.handle);
+        page.handle.clear();
+    }
+}
+
+uint32_t UniformArena::allocate(DriverApi& driver, uint32_t size) noexcept {
+    size = alignSize(size);
+    ASSERT_PRECONDITION(size <= PAGE_SIZE,
+            "uniform block too large for the uniform arena (%u bytes)", size);
+
+    auto pos = mFreeSlots.find(size);
+    if (pos != mFreeSlots.end() && !pos->second.empty()) {
+        const uint32_t offset = pos->second.back();
+        pos->second.pop_back();
+        return offset;
+    }
+
+    if (UTILS_UNLIKELY(mPages.empty() || mPages.back().size + size > PAGE_SIZE)) {
+        // The end of the last page is lost, it's at most the size of one slot. Existing pages
+        // (and their handles) are left untouched.
+        Page page;
+        page.shadow = static_cast<uint8_t*>(::malloc(PAGE_SIZE));
+        ASSERT_POSTCONDITION(page.shadow, "Out of memory allocating the uniform arena");
+        page.handle = driver.createUniformBuffer(PAGE_SIZE, BufferUsage::DYNAMIC);
+        mPages.push_back(page);
+    }
+
+    Page& page = mPages.back();
+    const uint32_t offset = uint32_t(mPages.size() - 1) * PAGE_SIZE + page.size;
+    page.size += size;
+    return offset;
+}
+
+void UniformArena::free(uint32_t offset, uint32_t size) noexcept {
+    mFreeSlots[alignSize(size)].push_back(offset);
+}
+
+void UniformArena::update(uint32_t offset, UniformBuffer const& uniforms) noexcept {
+    Page& page = mPages[offset / PAGE_SIZE];
+    const uint32_t bufferOffset = getBufferOffset(offset);
+    assert(bufferOffset + uniforms.getSize() <= page.size);
+    memcpy(page.shadow + bufferOffset, uniforms.getBuffer(), uniforms.getSize());
+    page.dirty = true;
+    uniforms.clean();
+}
+
+size_t UniformArena::commit(DriverApi& driver) noexcept {
+    SYSTRACE_CALL();
+
+    // Backends don't guarantee that the part of a uniform buffer that isn't uploaded is
+    // preserved (e.g. Metal acquires a new buffer for each upload), so a page is always
+    // uploaded as a whole. This is still a single copy per page, instead of one per updated slot.
+    size_t count = 0;
+    for (Page& page : mPages) {
+        if (!page.dirty) {
+            continue;
+        }
+        void* const data = ::malloc(page.size);
+        ASSERT_POSTCONDITION(data, "Out of memory committing the uniform arena");
+        memcpy(data, page.shadow, page.size);
+        driver.loadUniformBuffer(page.handle, BufferDescriptor(data, page.size,
+                [](void* buffer, size_t, void*) { ::free(buffer); }));
+        page.dirty = false;
+        count++;
+    }
+    return count;
+}
+
+} // namespace filament
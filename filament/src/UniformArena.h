@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_UNIFORMARENA_H
+#define TNT_FILAMENT_UNIFORMARENA_H
+
+#include "UniformBuffer.h"
+
+#include "private/backend/DriverApi.h"
+
+#include <backend/Handle.h>
+
+#include <utils/compiler.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * GPU uniform buffers shared by many small uniform blocks (typically those of the material
+ * instances), each living in its own slot. The arena is made of fixed-size pages, each backed by
+ * its own GPU buffer. Updated blocks are first copied into a CPU-side copy of their page, and
+ * commit() then uploads each page that has at least one updated slot, in a single transfer.
+ * Blocks are bound with bindUniformBufferRange().
+ */
+class UniformArena {
+public:
+    // Slots are aligned to the largest uniform buffer offset alignment found in practice.
+    static constexpr uint32_t ALIGNMENT = 256;
+
+    // Size of a page, which is also the largest slot. This is the minimum uniform block size
+    // guaranteed by OpenGL ES 3.0.
+    static constexpr uint32_t PAGE_SIZE = 16384;
+
+    UniformArena() noexcept;
+    ~UniformArena() noexcept;
+
+    UniformArena(UniformArena const& rhs) = delete;
+    UniformArena& operator=(UniformArena const& rhs) = delete;
+
+    void terminate(backend::DriverApi& driver);
+
+    // Allocates a slot of at least "size" bytes (at most PAGE_SIZE) and returns its offset. The
+    // slot never straddles two pages.
+    uint32_t allocate(backend::DriverApi& driver, uint32_t size) noexcept;
+
+    // Returns a slot to the arena, its content is discarded.
+    void free(uint32_t offset, uint32_t size) noexcept;
+
+    // Copies the content of "uniforms" into the slot at "offset" and cleans it. The GPU buffer
+    // is only updated at the next commit().
+    void update(uint32_t offset, UniformBuffer const& uniforms) noexcept;
+
+    // Uploads the pages updated since the last commit(), each in a single transfer. Returns the
+    // number of pages uploaded.
+    size_t commit(backend::DriverApi& driver) noexcept;
+
+    // The GPU buffer holding the slot at "offset", and the offset of the slot in that buffer.
+    backend::Handle<backend::HwUniformBuffer> getHandle(uint32_t offset) const noexcept {
+        return mPages[offset / PAGE_SIZE].handle;
+    }
+    static uint32_t getBufferOffset(uint32_t offset) noexcept {
+        return offset % PAGE_SIZE;
+    }
+
+private:
+    static uint32_t alignSize(uint32_t size) noexcept {
+        return (size + (ALIGNMENT - 1u)) & ~(ALIGNMENT - 1u);
+    }
+
+    struct Page {
+        backend::Handle<backend::HwUniformBuffer> handle;
+        uint32_t size = 0;              // end of the last allocated slot in this page
+        bool dirty = false;             // whether the GPU buffer is out of date
+        uint8_t* shadow = nullptr;      // CPU-side copy of the GPU buffer
+    };
+
+    std::vector<Page> mPages;
+
+    // free slots, indexed by their (aligned) size
+    std::unordered_map<uint32_t, std::vector<uint32_t>> mFreeSlots;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_UNIFORMARENA_H
@@ -97,8 +97,10 @@ void FView::terminate(FEngine& engine) {
     driver.destroyUniformBuffer(mShadowUbh);
     driver.destroySamplerGroup(mPerViewSbh);
     driver.destroyUniformBuffer(mRenderableUbh);
+    driver.destroyUniformBuffer(mBonesUbh);
     drainFrameHistory(engine);
     mFroxelizer.terminate(driver);
+    mShadowMapManager.terminate(engine);
 }
 
 void FView::setViewport(filament::Viewport const& viewport) noexcept {
@@ -413,9 +415,11 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
      */
 
     auto *prepareVisibleLightsJob = js.runAndRetain(js.createJob(nullptr,
-            [&frustum = mCullingFrustum, &engine, scene](JobSystem& js, JobSystem::Job*) {
-                FView::prepareVisibleLights(
-                        engine.getLightManager(), js, frustum, scene->getLightData());
+            [&frustum = mCullingFrustum, &camera = mViewingCameraInfo,
+             budget = mDynamicLightBudget, fades = &mLightFades, &engine, scene]
+             (JobSystem& js, JobSystem::Job*) {
+                FView::prepareVisibleLights(engine.getLightManager(), js, frustum, camera,
+                        budget, scene->getLightData(), fades);
             }));
 
     Range merged;
@@ -503,6 +507,26 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
             assert(mRenderableUbh);
             scene->updateUBOs(merged, mRenderableUbh);
         }
+
+        // update the bone palette, it holds the bones of all the visible skinned renderables.
+        // It is only packed and uploaded again when its layout or some of its bones changed.
+        const size_t bonesSize = scene->prepareBones(merged, &mBonesLayoutScratch);
+        if (bonesSize) {
+            const size_t size = bonesSize + FScene::BONES_BLOCK_SIZE;
+            if (mBonesUBOSize < size) {
+                // allocate 1/3 extra
+                mBonesUBOSize = uint32_t((4u * size + 2u) / 3u);
+                driver.destroyUniformBuffer(mBonesUbh);
+                mBonesUbh = driver.createUniformBuffer(mBonesUBOSize,
+                        backend::BufferUsage::DYNAMIC);
+                mBonesLayout.clear();
+            }
+            if (mBonesLayoutScratch != mBonesLayout) {
+                scene->updateBonesUBO(merged, bonesSize, mBonesUbh);
+                std::swap(mBonesLayout, mBonesLayoutScratch);
+            }
+            scene->setBonesUBO(mBonesUbh);
+        }
     }
 
     /*
@@ -546,10 +570,6 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
     u.setUniform(offsetof(PerViewUib, fogInscatteringSize),  fogOptions.inScatteringSize);
     u.setUniform(offsetof(PerViewUib, fogColorFromIbl),      fogOptions.fogColorFromIbl ? 1.0f : 0.0f);
 
-    // upload the renderables's dirty UBOs
-    engine.getRenderableManager().prepare(driver,
-            renderableData.data<FScene::RENDERABLE_INSTANCE>(), merged);
-
     // set uniforms and samplers
     bindPerViewUniformsAndSamplers(driver);
 }
@@ -755,7 +775,8 @@ void FView::cullRenderables(JobSystem& js,
 }
 
 void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
-        Frustum const& frustum, FScene::LightSoa& lightData) noexcept {
+        Frustum const& frustum, CameraInfo const& camera, uint32_t budget,
+        FScene::LightSoa& lightData, LightFades* fades) noexcept {
     SYSTRACE_CALL();
 
     auto const* UTILS_RESTRICT sphereArray     = lightData.data<FScene::POSITION_RADIUS>();
@@ -809,6 +830,145 @@ void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
     assert(visibleLightCount == size_t(last - lightData.begin()));
 
     lightData.resize(visibleLightCount);
+
+    applyLightBudget(lcm, camera, budget, lightData, fades);
+}
+
+void FView::applyLightBudget(FLightManager const& lcm, CameraInfo const& camera,
+        uint32_t budget, FScene::LightSoa& lightData, LightFades* fades) noexcept {
+    /*
+     * Enforce the light budget: only keep the lights with the largest contribution. A light
+     * entering or leaving the budget fades in or out over FADE_FRAMES frames, and the lights
+     * already shaded are favored by HYSTERESIS, so that lights with similar contributions don't
+     * swap every frame.
+     */
+
+    constexpr float FADE_FRAMES = 8.0f;
+    constexpr float FADE_STEP = 1.0f / FADE_FRAMES;
+    constexpr float HYSTERESIS = 0.25f;
+
+    float* const UTILS_RESTRICT fade = lightData.data<FScene::FADE>();
+    const size_t positionalLightCount = lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT;
+    if (positionalLightCount <= budget && fades->empty()) {
+        // nothing to fade and nothing to drop
+        std::fill_n(fade + FScene::DIRECTIONAL_LIGHTS_COUNT, positionalLightCount, 1.0f);
+        return;
+    }
+
+    // the fade of a light in the previous frame, or -1 if it wasn't visible
+    auto const previousFade = [fades](FLightManager::Instance li) {
+        auto const pos = fades->find(li.asValue());
+        return pos == fades->end() ? -1.0f : pos->second;
+    };
+
+    // the FADE column holds the scores until the selection is made
+    float* const UTILS_RESTRICT scores = fade + FScene::DIRECTIONAL_LIGHTS_COUNT;
+    auto const* UTILS_RESTRICT instances =
+            lightData.data<FScene::LIGHT_INSTANCE>() + FScene::DIRECTIONAL_LIGHTS_COUNT;
+    for (size_t i = 0; i < positionalLightCount; i++) {
+        scores[i] = lcm.getIntensity(instances[i]);
+    }
+    computeLightScores(scores, camera,
+            lightData.data<FScene::POSITION_RADIUS>() + FScene::DIRECTIONAL_LIGHTS_COUNT,
+            positionalLightCount);
+    for (size_t i = 0; i < positionalLightCount; i++) {
+        scores[i] *= previousFade(instances[i]) > 0.0f ? 1.0f + HYSTERESIS : 1.0f;
+    }
+
+    // partially sort the lights, so that the ones we want to keep come first
+    auto const first = lightData.begin() + FScene::DIRECTIONAL_LIGHTS_COUNT;
+    auto const byScore = [](auto const& lhs, auto const& rhs) {
+        return lhs.template get<FScene::FADE>() > rhs.template get<FScene::FADE>();
+    };
+    const size_t wantedCount = std::min(size_t(budget), positionalLightCount);
+    std::nth_element(first, first + wantedCount, lightData.end(), byScore);
+
+    // The wanted lights already shaded come first, followed by the ones to fade in. These only
+    // get the slots not used by the shaded lights, including the ones still fading out.
+    auto const newcomers = std::partition(first, first + wantedCount,
+            [&previousFade](auto const& it) {
+                return previousFade(it.template get<FScene::LIGHT_INSTANCE>()) > 0.0f;
+            });
+    const size_t shadedCount = size_t(newcomers - first);
+    size_t usedCount = shadedCount;
+    for (size_t i = wantedCount; i < positionalLightCount; i++) {
+        usedCount += previousFade(instances[i]) > FADE_STEP ? 1 : 0;
+    }
+    const size_t admittedCount = std::min(wantedCount - shadedCount,
+            budget > usedCount ? budget - usedCount : 0);
+    std::nth_element(newcomers, newcomers + admittedCount, first + wantedCount, byScore);
+
+    for (size_t i = 0; i < positionalLightCount; i++) {
+        const float previous = previousFade(instances[i]);
+        if (i < shadedCount) {
+            scores[i] = std::min(previous + FADE_STEP, 1.0f);
+        } else if (i < shadedCount + admittedCount) {
+            // a light that just became visible doesn't need to fade in
+            scores[i] = previous < 0.0f ? 1.0f : FADE_STEP;
+        } else if (i < wantedCount) {
+            scores[i] = 0.0f;
+        } else {
+            scores[i] = std::max(previous - FADE_STEP, 0.0f);
+        }
+    }
+
+    // The shaded lights come first. There can be more than the budget only if it was lowered,
+    // then the most faded ones are dropped (the FADE column now holds the fades).
+    auto const dropped = std::partition(first, lightData.end(), [](auto const& it) {
+        return it.template get<FScene::FADE>() > 0.0f;
+    });
+    size_t keptCount = size_t(dropped - first);
+    if (UTILS_UNLIKELY(keptCount > budget)) {
+        std::nth_element(first, first + budget, dropped, byScore);
+        std::fill(scores + budget, scores + keptCount, 0.0f);
+        keptCount = budget;
+    }
+
+    // Remember the fades, including the ones of the visible lights that are dropped, so they
+    // fade in when they're kept again. This isn't needed once all the lights are fully shaded.
+    fades->clear();
+    if (keptCount < positionalLightCount ||
+            std::any_of(scores, scores + keptCount, [](float f) { return f < 1.0f; })) {
+        for (size_t i = 0; i < positionalLightCount; i++) {
+            fades->insert({ instances[i].asValue(), scores[i] });
+        }
+    }
+
+    lightData.resize(FScene::DIRECTIONAL_LIGHTS_COUNT + keptCount);
+}
+
+// This method needs to exist so clang honors the __restrict__ keyword, which in turn
+// produces much better vectorization.
+UTILS_NOINLINE
+void FView::computeLightScores(float* const UTILS_RESTRICT scores,
+        CameraInfo const& UTILS_RESTRICT camera,
+        float4 const* const UTILS_RESTRICT spheres, size_t count) noexcept {
+    // The score of a light is its intensity (already in scores[]) times the fraction of the
+    // viewport covered by the screen-space bounding square of its sphere of influence. This
+    // loop is branch-less so it gets vectorized.
+    const mat4f& projection = camera.projection;
+    const float2 scale = { projection[0].x, projection[1].y };
+    for (size_t i = 0; i < count; i++) {
+        const float4 sphere = spheres[i];
+        const float3 center = (camera.view * float4{ sphere.xyz, 1.0f }).xyz;
+        const float distance = -center.z;   // camera points towards the -z axis
+
+        // the clip-space center and half-size of the light's bounding square
+        const float invDistance = 1.0f / std::max(distance, std::numeric_limits<float>::min());
+        const float2 c = center.xy * scale * invDistance;
+        const float2 r = sphere.w * scale * invDistance;
+
+        // intersect the square with the viewport, i.e. [-1, 1]^2
+        const float2 lo = max(c - r, float2(-1.0f));
+        const float2 hi = min(c + r, float2( 1.0f));
+        const float2 extent = max(hi - lo, float2(0.0f));
+        float coverage = std::min(extent.x * extent.y * 0.25f, 1.0f);
+
+        // the camera is inside or very close to the light's sphere, it covers everything
+        coverage = distance > sphere.w ? coverage : 1.0f;
+
+        scores[i] *= coverage;
+    }
 }
 
 void FView::updatePrimitivesLod(FEngine& engine, const CameraInfo&,
@@ -996,6 +1156,14 @@ void View::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept
     upcast(this)->setDynamicLightingOptions(zLightNear, zLightFar);
 }
 
+void View::setDynamicLightBudget(uint32_t count) noexcept {
+    upcast(this)->setDynamicLightBudget(count);
+}
+
+uint32_t View::getDynamicLightBudget() const noexcept {
+    return upcast(this)->getDynamicLightBudget();
+}
+
 void View::setShadowType(View::ShadowType shadow) noexcept {
     upcast(this)->setShadowType(shadow);
 }
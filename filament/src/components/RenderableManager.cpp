@@ -274,6 +274,7 @@ void FRenderableManager::create(
             rp[i].init(driver, entries[i]);
         }
         setPrimitives(ci, { rp, size_type(builder->mEntries.size()) });
+        manager[ci].primitivesVersion = nextPrimitivesVersion();
 
         setAxisAlignedBoundingBox(ci, builder->mAABB);
         setLayerMask(ci, builder->mLayerMask);
@@ -289,23 +290,13 @@ void FRenderableManager::create(
         const size_t count = builder->mSkinningBoneCount;
         if (UTILS_UNLIKELY(count > 0 || builder->mMorphingEnabled)) {
             std::unique_ptr<Bones>& bones = manager[ci].bones;
-            // Note that we are sizing the bones UBO according to CONFIG_MAX_BONE_COUNT rather than
-            // mSkinningBoneCount. According to the OpenGL ES 3.2 specification in 7.6.3 Uniform
-            // Buffer Object Bindings:
-            //
-            //     the uniform block must be populated with a buffer object with a size no smaller
-            //     than the minimum required size of the uniform block (the value of
-            //     UNIFORM_BLOCK_DATA_SIZE).
-            //
-            // This unfortunately means that we are using a large memory footprint for skinned
-            // renderables. In the future we could try addressing this by implementing a paging
-            // system such that multiple skinned renderables will share regions within a single
-            // large block of bones.
+            // The bones are only kept on the CPU side here. The bones of all the visible
+            // renderables are packed into a single buffer, the view's bone palette, see
+            // FScene::updateBonesUBO().
             bones = std::unique_ptr<Bones>(new Bones{
-                    driver.createUniformBuffer(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone),
-                            backend::BufferUsage::DYNAMIC),
                     UniformBuffer{ count * sizeof(PerRenderableUibBone) },
-                    count
+                    count,
+                    nextBonesVersion()
             });
             assert(bones);
             if (bones) {
@@ -354,16 +345,8 @@ void FRenderableManager::destroyComponent(Instance ci) noexcept {
     auto& manager = mManager;
     FEngine& engine = mEngine;
 
-    FEngine::DriverApi& driver = engine.getDriverApi();
-
     // See create(RenderableManager::Builder&, Entity)
     destroyComponentPrimitives(engine, manager[ci].primitives);
-
-    // destroy the bones structures if any
-    std::unique_ptr<Bones> const& bones = manager[ci].bones;
-    if (bones) {
-        driver.destroyUniformBuffer(bones->handle);
-    }
 }
 
 void FRenderableManager::destroyComponentPrimitives(
@@ -375,30 +358,13 @@ void FRenderableManager::destroyComponentPrimitives(
 }
 
 
-void FRenderableManager::prepare(
-        backend::DriverApi& UTILS_RESTRICT driver,
-        Instance const* UTILS_RESTRICT instances,
-        utils::Range<uint32_t> list) const noexcept {
-    const auto& manager = mManager;
-
-    std::unique_ptr<Bones>  const * const UTILS_RESTRICT bones = manager.raw_array<BONES>();
-    for (uint32_t index : list) {
-        size_t i = instances[index].asValue();
-        assert(i);  // we should never get the null instance here
-        if (UTILS_UNLIKELY(bones[i])) {
-            if (bones[i]->bones.isDirty()) {
-                driver.loadUniformBuffer(bones[i]->handle, bones[i]->bones.toBufferDescriptor(driver));
-            }
-        }
-    }
-}
-
 void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
         size_t primitiveIndex, FMaterialInstance const* mi) noexcept {
     if (instance) {
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setMaterialInstance(upcast(mi));
+            mManager[instance].primitivesVersion = nextPrimitivesVersion();
             AttributeBitset required = mi->getMaterial()->getRequiredAttributes();
             AttributeBitset declared = primitives[primitiveIndex].getEnabledAttributes();
             if (UTILS_UNLIKELY((declared & required) != required)) {
@@ -429,6 +395,7 @@ void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setBlendOrder(order);
+            mManager[instance].primitivesVersion = nextPrimitivesVersion();
         }
     }
 }
@@ -452,6 +419,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, vertices, indices, offset,
                     0, vertices->getVertexCount() - 1, count);
+            mManager[instance].primitivesVersion = nextPrimitivesVersion();
         }
     }
 }
@@ -462,6 +430,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, offset, 0, 0, count);
+            mManager[instance].primitivesVersion = nextPrimitivesVersion();
         }
     }
 }
@@ -476,6 +445,7 @@ void FRenderableManager::setBones(Instance ci,
             PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
                     offset * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
+            bones->version = nextBonesVersion();
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 out[i].q = transforms[i].unitQuaternion;
                 out[i].t.xyz = transforms[i].translation;
@@ -495,6 +465,7 @@ void FRenderableManager::setBones(Instance ci,
             PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
                     offset * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
+            bones->version = nextBonesVersion();
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 makeBone(&out[i], transforms[i]);
             }
@@ -640,4 +611,8 @@ void RenderableManager::setMorphWeights(Instance instance, float4 const& weights
     upcast(this)->setMorphWeights(instance, weights);
 }
 
+float4 RenderableManager::getMorphWeights(Instance instance) const noexcept {
+    return upcast(this)->getMorphWeights(instance);
+}
+
 } // namespace filament
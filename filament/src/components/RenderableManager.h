@@ -35,6 +35,8 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <atomic>
+
 // for gtest
 class FilamentTest_Bones_Test;
 
@@ -84,12 +86,6 @@ public:
 
     void destroy(utils::Entity e) noexcept;
 
-    // - instances is a list of Instance (typically the list from a given scene)
-    // - list is a list of index in 'instances' (typically the visible ones)
-    void prepare(backend::DriverApi& driver,
-            RenderableManager::Instance const* instances,
-            utils::Range<uint32_t> list) const noexcept;
-
     void gc(utils::EntityManager& em) noexcept {
         mManager.gc(em);
     }
@@ -127,8 +123,13 @@ public:
     inline uint8_t getPriority(Instance instance) const noexcept;
     inline filament::math::float4 getMorphWeights(Instance instance) const noexcept;
 
-    inline backend::Handle<backend::HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
+    inline bool hasBones(Instance instance) const noexcept;
     inline uint32_t getBoneCount(Instance instance) const noexcept;
+    inline PerRenderableUibBone const* getBones(Instance instance) const noexcept;
+    // Changes each time the bones of a renderable are set, it is unique across renderables.
+    inline uint32_t getBonesVersion(Instance instance) const noexcept;
+    // Changes each time the primitives of a renderable are set, it is unique across renderables.
+    inline uint32_t getPrimitivesVersion(Instance instance) const noexcept;
 
 
     inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
@@ -151,10 +152,11 @@ private:
     static void destroyComponentPrimitives(FEngine& engine,
             utils::Slice<FRenderPrimitive>& primitives) noexcept;
 
+    // The bones are copied into the view's bone palette when they, or the palette, changed
     struct Bones {
-        filament::backend::Handle<backend::HwUniformBuffer> handle;
         UniformBuffer bones;
         size_t count;
+        uint32_t version;
     };
 
     friend class ::FilamentTest_Bones_Test;
@@ -168,6 +170,7 @@ private:
         VISIBILITY,         // user data
         PRIMITIVES,         // user data
         BONES,              // filament data, UBO storing a pointer to the bones information
+        PRIMITIVES_VERSION, // filament data, changes with the primitives' materials and geometry
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -176,7 +179,8 @@ private:
             filament::math::float4,          // MORPH_WEIGHTS
             Visibility,                      // VISIBILITY
             utils::Slice<FRenderPrimitive>,  // PRIMITIVES
-            std::unique_ptr<Bones>           // BONES
+            std::unique_ptr<Bones>,          // BONES
+            uint32_t                         // PRIMITIVES_VERSION
     >;
 
     struct Sim : public Base {
@@ -197,6 +201,7 @@ private:
                 Field<VISIBILITY>   visibility;
                 Field<PRIMITIVES>   primitives;
                 Field<BONES>        bones;
+                Field<PRIMITIVES_VERSION> primitivesVersion;
             };
         };
 
@@ -210,6 +215,18 @@ private:
 
     Sim mManager;
     FEngine& mEngine;
+
+    // setBones() can be called concurrently for different renderables, only the uniqueness of the
+    // versions matters
+    uint32_t nextBonesVersion() noexcept {
+        return mBonesVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    std::atomic<uint32_t> mBonesVersion = { 0 };
+
+    uint32_t nextPrimitivesVersion() noexcept {
+        return mPrimitivesVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    std::atomic<uint32_t> mPrimitivesVersion = { 0 };
 };
 
 FILAMENT_UPCAST(RenderableManager)
@@ -323,9 +340,9 @@ Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
-backend::Handle<backend::HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
+bool FRenderableManager::hasBones(Instance instance) const noexcept {
     std::unique_ptr<Bones> const& bones = mManager[instance].bones;
-    return bones ? bones->handle : backend::Handle<backend::HwUniformBuffer>{};
+    return bool(bones);
 }
 
 inline uint32_t FRenderableManager::getBoneCount(Instance instance) const noexcept {
@@ -333,6 +350,20 @@ inline uint32_t FRenderableManager::getBoneCount(Instance instance) const noexce
     return bones ? bones->count : 0;
 }
 
+inline PerRenderableUibBone const* FRenderableManager::getBones(Instance instance) const noexcept {
+    std::unique_ptr<Bones> const& bones = mManager[instance].bones;
+    return bones ? static_cast<PerRenderableUibBone const*>(bones->bones.getBuffer()) : nullptr;
+}
+
+inline uint32_t FRenderableManager::getBonesVersion(Instance instance) const noexcept {
+    std::unique_ptr<Bones> const& bones = mManager[instance].bones;
+    return bones ? bones->version : 0;
+}
+
+inline uint32_t FRenderableManager::getPrimitivesVersion(Instance instance) const noexcept {
+    return mManager[instance].primitivesVersion;
+}
+
 utils::Slice<FRenderPrimitive> const& FRenderableManager::getRenderPrimitives(
         Instance instance, uint8_t level) const noexcept {
     return mManager[instance].primitives;
@@ -16,8 +16,16 @@
 
 #include "components/TransformManager.h"
 
+#include "details/Engine.h"
+
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
 #include <math/mat4.h>
 
+#include <functional>
+#include <limits>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -27,6 +35,10 @@ FTransformManager::FTransformManager() noexcept = default;
 
 FTransformManager::~FTransformManager() noexcept = default;
 
+void FTransformManager::init(FEngine& engine) noexcept {
+    mJobSystem = &engine.getJobSystem();
+}
+
 void FTransformManager::terminate() noexcept {
 }
 
@@ -51,6 +63,9 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
         manager[i].next = 0;
         manager[i].prev = 0;
         manager[i].firstChild = 0;
+        manager[i].dirty = false;
+        manager[i].local = mat4f{};
+        mLevelsValid = false;
         insertNode(i, parent);
         setTransform(i, localTransform);
     }
@@ -65,11 +80,12 @@ void FTransformManager::setParent(Instance i, Instance parent) noexcept {
             // TODO: on debug builds, ensure that the new parent isn't one of our descendant
             removeNode(i);
             insertNode(i, parent);
+            mLevelsValid = false;
             updateNodeTransform(i);
             // Note: setParent() doesn't reorder the child after the parent in the array,
             // but that's not a problem because TransformManager doesn't rely on that.
-            // Also note that commitLocalTransformTransaction() does reorder all children after
-            // their parent, as an optimization to calculate the world transform.
+            // Also note that commitLocalTransformTransaction() walks the nodes by level, through
+            // an index that must be recomputed.
         }
     }
 }
@@ -114,12 +130,20 @@ void FTransformManager::destroy(Entity e) noexcept {
         // 1) remove the entry from the linked lists
         removeNode(i);
 
-        // our children don't have parents anymore
+        // our children don't have parents anymore, their world transform is now their local
+        // transform, which the next transaction will pick-up. Outside of a transaction, their
+        // subtrees are updated now, so that no node is left dirty: setTransforms() relies on it.
         Instance child = manager[i].firstChild;
         while (child) {
             manager[child].parent = 0;
+            updateNodeTransform(child);
             child = manager[child].next;
         }
+        mLevelsValid = false;
+
+        if (UTILS_UNLIKELY(!static_cast<mat4f const&>(manager[i].local).isAffine())) {
+            mProjectiveCount--;
+        }
 
         // 2) remove the component
         Instance moved = manager.removeComponent(e);
@@ -134,15 +158,67 @@ void FTransformManager::destroy(Entity e) noexcept {
 void FTransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     validateNode(ci);
     if (ci) {
-        auto& manager = mManager;
-        // store our local transform
-        manager[ci].local = model;
+        setLocalTransform(ci, model);
         updateNodeTransform(ci);
     }
 }
 
+void FTransformManager::setTransforms(Instance const* instances, const mat4f* models,
+        size_t count, size_t stride) noexcept {
+    SYSTRACE_CALL();
+    auto& manager = mManager;
+
+    // The local transforms are all stored first and the world transforms computed afterwards,
+    // so that a subtree is only transformed once, even if several of its nodes are updated.
+    // Within a transaction, the nodes are just marked dirty.
+    const bool transactionOpen = mLocalTransformTransactionOpen;
+    const char* p = reinterpret_cast<const char*>(models);
+    for (size_t k = 0; k < count; k++, p += stride) {
+        const Instance ci = instances[k];
+        validateNode(ci);
+        if (ci) {
+            setLocalTransform(ci, *reinterpret_cast<const mat4f*>(p));
+            manager[ci].dirty = true;
+        }
+    }
+
+    if (!transactionOpen) {
+        // Outside of a transaction, only the nodes set above are dirty. The subtree of each of
+        // them is transformed, unless one of its ancestors is dirty too, in which case it will
+        // be transformed along with that ancestor's subtree. This costs the depth of each node,
+        // plus the size of the transformed subtrees.
+        for (size_t k = 0; k < count; k++) {
+            const Instance ci = instances[k];
+            if (ci && manager[ci].dirty && !hasDirtyAncestor(ci)) {
+                updateNodeTransform(ci);
+            }
+        }
+    }
+}
+
+bool FTransformManager::hasDirtyAncestor(Instance i) const noexcept {
+    auto const& manager = mManager;
+    for (Instance parent = manager[i].parent; parent; parent = manager[parent].parent) {
+        if (manager[parent].dirty) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FTransformManager::setLocalTransform(Instance ci, const mat4f& model) noexcept {
+    // store our local transform, keeping track of the ones that aren't affine
+    auto& manager = mManager;
+    const bool wasAffine = static_cast<mat4f const&>(manager[ci].local).isAffine();
+    const bool isAffine = model.isAffine();
+    mProjectiveCount += uint32_t(wasAffine) - uint32_t(isAffine);
+    manager[ci].local = model;
+}
+
 void FTransformManager::updateNodeTransform(Instance i) noexcept {
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
+        // the world transform of this node and of its children are computed at commit time
+        mManager[i].dirty = true;
         return;
     }
 
@@ -156,12 +232,14 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
     mat4f const& pt = manager.raw_array<WORLD>()[parent];
 
     // compute our world transform
-    manager[i].world = pt * static_cast<mat4f const&>(manager[i].local);
+    const bool affine = mProjectiveCount == 0;
+    manager[i].world = multiply(pt, manager[i].local, affine);
+    manager[i].dirty = false;
 
     // update our children's world transforms
     Instance child = manager[i].firstChild;
     if (UTILS_UNLIKELY(child)) { // assume we don't have a hierarchy in the common case
-        transformChildren(manager, child);
+        transformChildren(manager, child, affine);
     }
 }
 
@@ -171,24 +249,113 @@ void FTransformManager::openLocalTransformTransaction() noexcept {
 
 void FTransformManager::commitLocalTransformTransaction() noexcept {
     if (mLocalTransformTransactionOpen) {
+        SYSTRACE_CALL();
         mLocalTransformTransactionOpen = false;
         auto& manager = mManager;
 
-        // swapNode() below needs some temporary storage which we provide here
+        if (UTILS_UNLIKELY(!mLevelsValid)) {
+            computeLevels();
+        }
+
+        // The levels are processed in order, so that parents are always updated before their
+        // children. A node is updated if it, or its parent, is dirty, in which case it becomes
+        // dirty itself for the benefit of its own children. Within a level, nodes don't depend
+        // on each other, which allows large levels to be processed in parallel.
         auto& soa = manager.getSoA();
-        soa.ensureCapacity(soa.size() + 1);
+        mat4f* const world = soa.data<WORLD>();
+        mat4f const* const local = soa.data<LOCAL>();
+        Instance const* const parent = soa.data<PARENT>();
+        bool* const dirty = soa.data<DIRTY>();
+        uint32_t const* const nodes = mLevelOrder.data();
+        const bool affine = mProjectiveCount == 0;
+        for (size_t l = 0, c = mLevels.size() - 1; l < c; l++) {
+            const uint32_t first = mLevels[l];
+            const uint32_t count = mLevels[l + 1] - first;
+            if (!mJobSystem || count < PARALLEL_LEVEL_MIN_COUNT) {
+                transformLevel(world, local, parent, dirty, nodes, first, count, affine);
+            } else {
+                auto functor = [=](uint32_t start, uint32_t c) {
+                    transformLevel(world, local, parent, dirty, nodes, start, c, affine);
+                };
+                JobSystem& js = *mJobSystem;
+                auto* job = jobs::parallel_for(js, nullptr, first, count,
+                        std::cref(functor), jobs::CountSplitter<PARALLEL_LEVEL_MIN_COUNT / 4>());
+                js.runAndWait(job);
+            }
+        }
 
-        mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
-        for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
-            // Ensure that children are always sorted after their parent.
-            while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
-                swapNode(i, manager[i].parent);
+        std::fill(manager.begin<DIRTY>(), manager.end<DIRTY>(), false);
+    }
+}
+
+// This method needs to exist so clang honors the __restrict__ keyword, which in turn
+// produces much better vectorization.
+UTILS_NOINLINE
+void FTransformManager::transformLevel(mat4f* world, mat4f const* UTILS_RESTRICT local,
+        Instance const* UTILS_RESTRICT parent, bool* dirty, uint32_t const* UTILS_RESTRICT nodes,
+        size_t first, size_t count, bool affine) noexcept {
+    // note: parent is 0 for root nodes, whose world[0] is the identity and dirty[0] is false
+    for (size_t k = first, e = first + count; k < e; k++) {
+        const uint32_t i = nodes[k];
+        const Instance p = parent[i];
+        if (dirty[i] || dirty[p]) {
+            world[i] = multiply(world[p], local[i], affine);
+            dirty[i] = true;
+        }
+    }
+}
+
+// Computes the level of each node, i.e. 0 for roots, 1 for their children, 2 for their
+// grand-children, etc... and lists the nodes by level in mLevelOrder. The nodes themselves
+// don't move, so that their Instances stay valid.
+void FTransformManager::computeLevels() noexcept {
+    SYSTRACE_CALL();
+    auto const& manager = mManager;
+
+    const uint32_t begin = manager.begin();
+    const uint32_t end = manager.end();
+    Instance const* const parent = manager.raw_array<PARENT>();
+
+    // the level of each node, indexed by Instance. Parents can be stored after their children,
+    // so the levels of a node's unknown ancestors are computed along with its own.
+    constexpr uint32_t UNKNOWN = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> level(end, UNKNOWN);
+    std::vector<uint32_t> levelCount;
+    std::vector<uint32_t> ancestors;
+    for (uint32_t i = begin; i < end; i++) {
+        uint32_t n = i;
+        while (level[n] == UNKNOWN) {
+            ancestors.push_back(n);
+            const Instance p = parent[n];
+            if (!p) {
+                break;
+            }
+            n = p;
+        }
+        // either n's level is known, or n is a root that still needs one
+        uint32_t l = level[n] != UNKNOWN ? level[n] + 1 : 0;
+        for (; !ancestors.empty(); ancestors.pop_back(), l++) {
+            level[ancestors.back()] = l;
+            if (l >= levelCount.size()) {
+                levelCount.resize(l + 1, 0);
             }
-            Instance parent = manager[i].parent;
-            assert(parent < i);
-            manager[i].world = world[parent] * static_cast<mat4f const&>(manager[i].local);
+            levelCount[l]++;
         }
     }
+
+    // offsets of each level in mLevelOrder
+    mLevels.resize(levelCount.size() + 1);
+    mLevels[0] = 0;
+    for (size_t l = 0; l < levelCount.size(); l++) {
+        mLevels[l + 1] = mLevels[l] + levelCount[l];
+    }
+    mLevelOrder.resize(end - begin);
+    std::vector<uint32_t> next(mLevels.begin(), mLevels.end() - 1);
+    for (uint32_t i = begin; i < end; i++) {
+        mLevelOrder[next[level[i]]++] = i;
+    }
+
+    mLevelsValid = true;
 }
 
 // Inserts a parentless node in the hierarchy
@@ -216,44 +383,6 @@ void FTransformManager::insertNode(Instance i, Instance parent) noexcept {
     validateNode(parent);
 }
 
-void FTransformManager::swapNode(Instance i, Instance j) noexcept {
-    validateNode(i);
-    validateNode(j);
-
-    auto& manager = mManager;
-
-    // swap the content of the nodes directly
-    std::swap(manager.elementAt<LOCAL>(i), manager.elementAt<LOCAL>(j));
-    std::swap(manager.elementAt<WORLD>(i), manager.elementAt<WORLD>(j));
-    manager.swap(i, j); // this swaps the data relative to SingleInstanceComponentManager
-
-    // now swap the linked-list references, to do that correctly we must use a temporary
-    // node to fix-up the linked-list pointers
-    // Here we are guaranteed to have enough capacity for our temporary storage, so we
-    // can safely use the item just past the end of the array.
-    assert(manager.getSoA().capacity() >= manager.getSoA().size() + 1);
-
-    const Instance t = manager.end();
-
-    manager[t].parent       = manager[i].parent;
-    manager[t].firstChild   = manager[i].firstChild;
-    manager[t].next         = manager[i].next;
-    manager[t].prev         = manager[i].prev;
-    updateNode(t);
-
-    manager[i].parent       = manager[j].parent;
-    manager[i].firstChild   = manager[j].firstChild;
-    manager[i].next         = manager[j].next;
-    manager[i].prev         = manager[j].prev;
-    updateNode(i);
-
-    manager[j].parent       = manager[t].parent;
-    manager[j].firstChild   = manager[t].firstChild;
-    manager[j].next         = manager[t].next;
-    manager[j].prev         = manager[t].prev;
-    updateNode(j);
-}
-
 // removes an node from the graph, but doesn't removes it or its children from the array
 // (making everybody orphaned).
 void FTransformManager::removeNode(Instance i) noexcept {
@@ -311,18 +440,19 @@ void FTransformManager::updateNode(Instance i) noexcept {
     validateNode(next);
 }
 
-void FTransformManager::transformChildren(Sim& manager, Instance ci) noexcept {
+void FTransformManager::transformChildren(Sim& manager, Instance ci, bool affine) noexcept {
     while (ci) {
         // update child's world transform
         Instance parent = manager[ci].parent;
         mat4f const& pt = manager[parent].world;
         mat4f const& local = manager[ci].local;
-        manager[ci].world = pt * local;
+        manager[ci].world = multiply(pt, local, affine);
+        manager[ci].dirty = false;
 
         // assume we don't have a deep hierarchy
         Instance child = manager[ci].firstChild;
         if (UTILS_UNLIKELY(child)) {
-            transformChildren(manager, child);
+            transformChildren(manager, child, affine);
         }
 
         // process our next child
@@ -409,10 +539,28 @@ TransformManager::Instance TransformManager::getInstance(Entity e) const noexcep
     return upcast(this)->getInstance(e);
 }
 
+size_t TransformManager::getComponentCount() const noexcept {
+    return upcast(this)->getComponentCount();
+}
+
+utils::Entity const* TransformManager::getEntities() const noexcept {
+    return upcast(this)->getEntities();
+}
+
 void TransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     upcast(this)->setTransform(ci, model);
 }
 
+void TransformManager::setTransforms(Instance const* instances,
+        const mat4f* localTransforms, size_t count) noexcept {
+    upcast(this)->setTransforms(instances, localTransforms, count, sizeof(mat4f));
+}
+
+void TransformManager::setTransforms(Instance const* instances,
+        const mat4f* localTransforms, size_t count, size_t stride) noexcept {
+    upcast(this)->setTransforms(instances, localTransforms, count, stride);
+}
+
 const mat4f& TransformManager::getTransform(Instance ci) const noexcept {
     return upcast(this)->getTransform(ci);
 }
@@ -28,8 +28,16 @@
 
 #include <math/mat4.h>
 
+#include <vector>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
+class FEngine;
+
 class UTILS_PRIVATE FTransformManager : public TransformManager {
 public:
     using Instance = TransformManager::Instance;
@@ -37,6 +45,10 @@ public:
     FTransformManager() noexcept;
     ~FTransformManager() noexcept;
 
+    // Lets commitLocalTransformTransaction() use the engine's JobSystem. Without it, world
+    // transforms are always computed on the calling thread.
+    void init(FEngine& engine) noexcept;
+
     // free-up all resources
     void terminate() noexcept;
 
@@ -53,6 +65,14 @@ public:
         return Instance(mManager.getInstance(e));
     }
 
+    size_t getComponentCount() const noexcept {
+        return mManager.getComponentCount();
+    }
+
+    utils::Entity const* getEntities() const noexcept {
+        return mManager.getEntities();
+    }
+
     void create(utils::Entity entity);
 
     void create(utils::Entity entity, Instance parent, const math::mat4f& localTransform);
@@ -83,6 +103,9 @@ public:
 
     void setTransform(Instance ci, const math::mat4f& model) noexcept;
 
+    void setTransforms(Instance const* instances, const math::mat4f* models,
+            size_t count, size_t stride) noexcept;
+
     const math::mat4f& getTransform(Instance ci) const noexcept {
         return mManager[ci].local;
     }
@@ -94,13 +117,26 @@ public:
 private:
     struct Sim;
 
+    // Levels with fewer nodes than this are processed on the calling thread.
+    static constexpr uint32_t PARALLEL_LEVEL_MIN_COUNT = 1024;
+
     void validateNode(Instance i) noexcept;
     void removeNode(Instance i) noexcept;
     void updateNode(Instance i) noexcept;
     void updateNodeTransform(Instance i) noexcept;
+    bool hasDirtyAncestor(Instance i) const noexcept;
+    void setLocalTransform(Instance ci, const math::mat4f& model) noexcept;
     void insertNode(Instance i, Instance p) noexcept;
-    void swapNode(Instance i, Instance j) noexcept;
-    static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    void computeLevels() noexcept;
+    static void transformChildren(Sim& manager, Instance firstChild, bool affine) noexcept;
+    static void transformLevel(math::mat4f* world, math::mat4f const* local,
+            Instance const* parent, bool* dirty, uint32_t const* nodes, size_t first,
+            size_t count, bool affine) noexcept;
+
+    static math::mat4f multiply(math::mat4f const& parent, math::mat4f const& local,
+            bool affine) noexcept {
+        return affine ? math::mat4f::affineMultiply(parent, local) : parent * local;
+    }
 
     friend class TransformManager::children_iterator;
 
@@ -111,6 +147,7 @@ private:
         FIRST_CHILD,    // instance to our first child
         NEXT,           // instance to our next sibling
         PREV,           // instance to our previous sibling
+        DIRTY,          // the world transform must be updated, by a transaction or setTransforms()
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -119,7 +156,8 @@ private:
             Instance,
             Instance,
             Instance,
-            Instance
+            Instance,
+            bool
     >;
 
     struct Sim : public Base {
@@ -142,6 +180,7 @@ private:
                 Field<FIRST_CHILD>  firstChild;
                 Field<NEXT>         next;
                 Field<PREV>         prev;
+                Field<DIRTY>        dirty;
             };
         };
 
@@ -155,6 +194,18 @@ private:
 
     Sim mManager;
     bool mLocalTransformTransactionOpen = false;
+
+    // When valid, mLevelOrder lists the nodes by their depth in the hierarchy. The nodes of
+    // level k are in [mLevels[k], mLevels[k + 1]) of mLevelOrder.
+    std::vector<uint32_t> mLevels;
+    std::vector<uint32_t> mLevelOrder;
+    bool mLevelsValid = false;
+
+    // Number of local transforms that are not affine, when there are none all the world
+    // transforms are affine as well, which makes them cheaper to compute.
+    uint32_t mProjectiveCount = 0;
+
+    utils::JobSystem* mJobSystem = nullptr;
 };
 
 FILAMENT_UPCAST(TransformManager)
@@ -19,6 +19,7 @@
 
 #include "upcast.h"
 #include "PostProcessManager.h"
+#include "UniformArena.h"
 
 #include "components/CameraManager.h"
 #include "components/LightManager.h"
@@ -33,6 +34,7 @@
 #include "details/RenderTarget.h"
 #include "details/ResourceList.h"
 #include "details/ColorGrading.h"
+#include "details/MaterialLibrary.h"
 #include "details/Skybox.h"
 
 #include "private/backend/CommandStream.h"
@@ -69,11 +71,14 @@ class DebugServer;
 #include <utils/Allocator.h>
 #include <utils/JobSystem.h>
 #include <utils/CountDownLatch.h>
+#include <utils/Mutex.h>
 
 #include <chrono>
 #include <memory>
 #include <random>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace filament {
 
@@ -180,6 +185,15 @@ public:
         return mPostProcessManager;
     }
 
+    UniformArena& getMaterialInstanceUniforms() noexcept {
+        return mMaterialInstanceUniforms;
+    }
+
+    // number of material instances whose parameters were uploaded during the last prepare()
+    size_t getCommittedMaterialInstanceCount() const noexcept {
+        return mCommittedMaterialInstanceCount;
+    }
+
     FRenderableManager& getRenderableManager() noexcept {
         return mRenderableManager;
     }
@@ -230,6 +244,7 @@ public:
     FTexture* createTexture(const Texture::Builder& builder) noexcept;
     FSkybox* createSkybox(const Skybox::Builder& builder) noexcept;
     FColorGrading* createColorGrading(const ColorGrading::Builder& builder) noexcept;
+    FMaterialLibrary* createMaterialLibrary(const MaterialLibrary::Builder& builder) noexcept;
     FStream* createStream(const Stream::Builder& builder) noexcept;
     FRenderTarget* createRenderTarget(const RenderTarget::Builder& builder) noexcept;
 
@@ -260,6 +275,7 @@ public:
     bool destroy(const FScene* p);
     bool destroy(const FSkybox* p);
     bool destroy(const FColorGrading* p);
+    bool destroy(const FMaterialLibrary* p);
     bool destroy(const FStream* p);
     bool destroy(const FTexture* p);
     bool destroy(const FRenderTarget* p);
@@ -284,6 +300,11 @@ public:
     void prepare();
     void gc();
 
+    // Material::compile() support: pending programs are created a few at a time in prepare(),
+    // and callbacks are invoked from prepare() once the driver has processed the programs.
+    void scheduleMaterialCompilation(FMaterial* material) noexcept;
+    void scheduleCompilationCallback(Material::CompilationCallback callback, void* user) noexcept;
+
     filaflat::ShaderBuilder& getVertexShaderBuilder() const noexcept {
         return mVertexShaderBuilder;
     }
@@ -314,6 +335,9 @@ private:
     int loop();
     void flushCommandBuffer(backend::CommandBufferQueue& commandBufferQueue);
 
+    void compilePendingMaterials() noexcept;
+    void dispatchCompilationCallbacks() noexcept;
+
     template<typename T, typename L>
     bool terminateAndDestroy(const T* p, ResourceList<T, L>& list);
 
@@ -353,6 +377,7 @@ private:
     ResourceList<FTexture> mTextures{ "Texture" };
     ResourceList<FSkybox> mSkyboxes{ "Skybox" };
     ResourceList<FColorGrading> mColorGradings{ "ColorGrading" };
+    ResourceList<FMaterialLibrary> mMaterialLibraries{ "MaterialLibrary" };
     ResourceList<FRenderTarget> mRenderTargets{ "RenderTarget" };
 
     mutable uint32_t mMaterialId = 0;
@@ -360,6 +385,17 @@ private:
     // FMaterialInstance are handled directly by FMaterial
     std::unordered_map<const FMaterial*, ResourceList<FMaterialInstance>> mMaterialInstances;
 
+    // uniforms of all the FMaterialInstance above, uploaded together in prepare()
+    UniformArena mMaterialInstanceUniforms;
+    size_t mCommittedMaterialInstanceCount = 0;
+
+    // number of programs created per frame on behalf of Material::compile()
+    static constexpr size_t MAX_PENDING_PROGRAMS_PER_FRAME = 2;
+    std::vector<FMaterial*> mPendingCompilations;
+    // written by the driver thread, read by the user thread
+    utils::Mutex mCompletedCompilationsLock;
+    std::vector<std::pair<Material::CompilationCallback, void*>> mCompletedCompilations;
+
     std::unique_ptr<DFG> mDFG;
 
     std::thread mDriverThread;
@@ -369,6 +405,7 @@ private:
     LinearAllocatorArena mPerRenderPassAllocator;
     HeapAllocatorArena mHeapAllocator;
 
+    // has one background thread, for jobs run with JobSystem::BACKGROUND (e.g. texture decoding)
     utils::JobSystem mJobSystem;
 
     std::default_random_engine mRandomEngine;
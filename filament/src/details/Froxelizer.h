@@ -123,6 +123,8 @@ public:
     size_t getFroxelCount() const noexcept { return mFroxelCount; }
 
     // update Records and Froxels texture with lights data. this is thread-safe.
+    // This is skipped, as well as the next commit(), if neither the camera nor the lights
+    // changed since the last call.
     void froxelizeLights(FEngine& engine, CameraInfo const& camera,
             const FScene::LightSoa& lightData) noexcept;
 
@@ -137,6 +139,9 @@ public:
     // send froxel data to GPU
     void commit(backend::DriverApi& driverApi);
 
+    // whether the last froxelizeLights() reused the previous froxelization
+    bool isFroxelizationReused() const noexcept { return mFroxelizationReused; }
+
 
     /*
      * Only for testing/debugging...
@@ -201,6 +206,11 @@ private:
 
     void froxelizeAssignRecordsCompress() noexcept;
 
+    // Records the state the froxelization depends on, and returns whether it's the same as the
+    // one recorded by the previous call.
+    bool updateFroxelizationState(FEngine& engine, CameraInfo const& camera,
+            const FScene::LightSoa& lightData) noexcept;
+
     void froxelizePointAndSpotLight(FroxelThreadData& froxelThread, size_t bit,
             math::mat4f const& projection, const LightParams& light) const noexcept;
 
@@ -258,6 +268,41 @@ private:
     float mZLightFar = FEngine::CONFIG_Z_LIGHT_FAR;
     float mZLightNear = FEngine::CONFIG_Z_LIGHT_NEAR;  // light near (first slice)
 
+    // Everything the froxel and record buffers depend on, besides the lights. It only has 32-bit
+    // fields, so that it can be hashed and compared as a whole.
+    struct FroxelizationLayout {
+        math::mat4f view;
+        math::mat4f projection;
+        int32_t viewport[4];
+        math::uint2 froxelDimension;
+        math::float4 paramsZ;
+        math::uint3 paramsF;
+        float clipToFroxelX;
+        float clipToFroxelY;
+        float zLightNear;
+        float zLightFar;
+        uint32_t froxelCount[4];
+        uint32_t lightCount;
+    };
+
+    // The parameters of a light the froxelization depends on. The light records store indices
+    // into the lights UBO, so the order of the lights matters too.
+    struct FroxelizationLight {
+        math::float4 sphere;
+        math::float3 direction;
+        float cosSqr;
+        float invSin;
+    };
+
+    // State of the last froxelization, and its hash which is used to quickly detect a change.
+    // The GPU buffers are already up-to-date when the froxelization is reused.
+    FroxelizationLayout mFroxelizationLayout = {};
+    std::vector<FroxelizationLight> mFroxelizationLights;
+    std::vector<FroxelizationLight> mPendingFroxelizationLights;
+    uint32_t mFroxelizationKey = 0;
+    bool mHasFroxelization = false;
+    bool mFroxelizationReused = false;
+
     // track if we need to update our internal state before froxelizing
     uint8_t mDirtyFlags = 0;
     enum {
@@ -30,15 +30,19 @@
 
 #include <filaflat/ShaderBuilder.h>
 
+#include <utils/bitset.h>
 #include <utils/compiler.h>
 
 #include <atomic>
+#include <utility>
+#include <vector>
 
 namespace filament {
 
 class MaterialParser;
 
 class  FEngine;
+class FMaterialLibrary;
 
 class FMaterial : public Material {
 public:
@@ -83,14 +87,26 @@ public:
             const_cast<FMaterial*>(this)->applyPendingEdits();
         }
 #endif
-        backend::Handle<backend::HwProgram> const entry = mCachedPrograms[variantKey];
-        return UTILS_LIKELY(entry) ? entry : getProgramSlow(variantKey);
+        // record the variants actually used for rendering, see getUsedVariants()
+        mUsedVariants.set(variantKey);
+        return getOrCreateProgram(variantKey);
     }
     backend::Program getProgramBuilderWithVariants(uint8_t variantKey, uint8_t vertexVariantKey,
             uint8_t fragmentVariantKey) const noexcept;
     backend::Handle<backend::HwProgram> createAndCacheProgram(backend::Program&& p,
             uint8_t variantKey) const noexcept;
 
+    void compile(CompilerPriorityQueue priority, UserVariantFilterMask variants,
+            CompilationCallback callback, void* user) noexcept;
+
+    // creates at most maxCount of the programs requested with CompilerPriorityQueue::LOW,
+    // returns the number of programs created.
+    size_t compilePendingPrograms(size_t maxCount) noexcept;
+
+    bool hasPendingPrograms() const noexcept { return mPendingPrograms.any(); }
+
+    size_t getUsedVariants(uint8_t* variants, size_t count) const noexcept;
+
     bool isVariantLit() const noexcept { return mIsVariantLit; }
 
     const utils::CString& getName() const noexcept { return mName; }
@@ -156,13 +172,32 @@ public:
     /** @}*/
 
 private:
+    // same as getProgram(), without recording the variant as used
+    backend::Handle<backend::HwProgram> getOrCreateProgram(uint8_t variantKey) const noexcept {
+        backend::Handle<backend::HwProgram> const entry = mCachedPrograms[variantKey];
+        return UTILS_LIKELY(entry) ? entry : getProgramSlow(variantKey);
+    }
+
     backend::Handle<backend::HwProgram> getProgramSlow(uint8_t variantKey) const noexcept;
     backend::Handle<backend::HwProgram> getSurfaceProgramSlow(uint8_t variantKey) const noexcept;
     backend::Handle<backend::HwProgram> getPostProcessProgramSlow(uint8_t variantKey) const noexcept;
 
+    // whether variantKey can be used with this material, and is present in its package
+    bool isVariantAvailable(uint8_t variantKey) const noexcept;
+
+    void scheduleCompilationCallbacks() noexcept;
+
     // try to order by frequency of use
     mutable std::array<backend::Handle<backend::HwProgram>, VARIANT_COUNT> mCachedPrograms;
 
+    // programs requested with CompilerPriorityQueue::LOW, not created yet
+    static_assert(VARIANT_COUNT <= 128, "mPendingPrograms is too small");
+    utils::bitset<uint64_t, 2> mPendingPrograms;
+
+    // variants requested by getProgram(), i.e. used for rendering
+    mutable utils::bitset<uint64_t, 2> mUsedVariants;
+    std::vector<std::pair<CompilationCallback, void*>> mPendingCompilationCallbacks;
+
     backend::RasterState mRasterState;
     BlendingMode mRenderBlendingMode = BlendingMode::OPAQUE;
     TransparencyMode mTransparencyMode = TransparencyMode::DEFAULT;
@@ -202,6 +237,9 @@ private:
     mutable uint32_t mMaterialInstanceId = 0;
     MaterialParser* mMaterialParser = nullptr;
     std::atomic<MaterialParser*> mPendingEdits = {};
+
+    // The library the shaders are read from, if any. Edited packages are parsed with it too.
+    FMaterialLibrary const* mLibrary = nullptr;
 };
 
 
@@ -45,14 +45,22 @@ public:
 
     void terminate(FEngine& engine);
 
-    void commit(FEngine::DriverApi& driver) const {
+    // Returns whether anything was committed. When "deferred" is set, uniforms stored in the
+    // engine's UniformArena are only copied there, and the caller must commit the arena.
+    bool commit(FEngine::DriverApi& driver, bool deferred = false) const {
         if (UTILS_UNLIKELY(mUniforms.isDirty() || mSamplers.isDirty())) {
-            commitSlow(driver);
+            commitSlow(driver, deferred);
+            return true;
         }
+        return false;
     }
 
     void use(FEngine::DriverApi& driver) const {
-        if (mUbHandle) {
+        if (mArena) {
+            driver.bindUniformBufferRange(BindingPoints::PER_MATERIAL_INSTANCE,
+                    mArena->getHandle(mUbOffset), UniformArena::getBufferOffset(mUbOffset),
+                    mUniforms.getSize());
+        } else if (mUbHandle) {
             driver.bindUniformBuffer(BindingPoints::PER_MATERIAL_INSTANCE, mUbHandle);
         }
         if (mSbHandle) {
@@ -79,11 +87,16 @@ public:
     UniformBuffer const& getUniformBuffer() const noexcept { return mUniforms; }
     backend::SamplerGroup const& getSamplerGroup() const noexcept { return mSamplers; }
 
+    // Changes each time a parameter or a render state of the instance is set, it is unique
+    // across instances.
+    uint32_t getVersion() const noexcept { return mVersion; }
+
     void setScissor(int32_t left, int32_t bottom, uint32_t width, uint32_t height) noexcept {
         mScissorRect = { left, bottom,
                 std::min(width, (uint32_t)std::numeric_limits<int32_t>::max()),
                 std::min(height, (uint32_t)std::numeric_limits<int32_t>::max())
         };
+        mVersion = nextVersion();
     }
 
     void unsetScissor() noexcept {
@@ -91,6 +104,7 @@ public:
                 (uint32_t)std::numeric_limits<int32_t>::max(),
                 (uint32_t)std::numeric_limits<int32_t>::max()
         };
+        mVersion = nextVersion();
     }
 
     backend::Viewport const& getScissor() const noexcept { return mScissorRect; }
@@ -106,6 +120,7 @@ public:
     void setPolygonOffset(float scale, float constant) noexcept {
         // handle reversed Z
         mPolygonOffset = { -scale, -constant };
+        mVersion = nextVersion();
     }
 
     backend::PolygonOffset getPolygonOffset() const noexcept { return mPolygonOffset; }
@@ -142,10 +157,14 @@ private:
     void initDefaultInstance(FEngine& engine, FMaterial const* material);
     void initialize(FMaterial const* material);
 
-    void commitSlow(FEngine::DriverApi& driver) const;
+    void commitSlow(FEngine::DriverApi& driver, bool deferred) const;
+
+    static uint32_t nextVersion() noexcept;
 
     // keep these grouped, they're accessed together in the render-loop
     FMaterial const* mMaterial = nullptr;
+    UniformArena* mArena = nullptr;     // set when the uniforms live in the engine's arena
+    uint32_t mUbOffset = 0;             // offset of the uniforms in mArena
     backend::Handle<backend::HwUniformBuffer> mUbHandle;
     backend::Handle<backend::HwSamplerGroup> mSbHandle;
 
@@ -158,6 +177,7 @@ private:
     backend::RasterState::DepthFunc mDepthFunc;
 
     uint64_t mMaterialSortingKey = 0;
+    uint32_t mVersion = 0;
 
     // Scissor rectangle is specified as: Left Bottom Width Height.
     backend::Viewport mScissorRect = { 0, 0,
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_MATERIALLIBRARY_H
+#define TNT_FILAMENT_DETAILS_MATERIALLIBRARY_H
+
+#include "upcast.h"
+
+#include <filament/MaterialLibrary.h>
+
+#include <filaflat/BlobDictionary.h>
+
+#include <stdint.h>
+
+namespace filament {
+
+class FEngine;
+
+class FMaterialLibrary : public MaterialLibrary {
+public:
+    FMaterialLibrary(FEngine& engine, const Builder& builder);
+    FMaterialLibrary(const FMaterialLibrary& rhs) = delete;
+    FMaterialLibrary& operator=(const FMaterialLibrary& rhs) = delete;
+
+    ~FMaterialLibrary() noexcept;
+
+    void terminate(FEngine& engine);
+
+    uint64_t getId() const noexcept { return mId; }
+
+    // The dictionary decodes SPIR-V shaders on demand, hence it's mutable.
+    filaflat::BlobDictionary& getDictionary() const noexcept { return mDictionary; }
+
+private:
+    void* mPayload = nullptr;
+    uint64_t mId = 0;
+    mutable filaflat::BlobDictionary mDictionary;
+};
+
+FILAMENT_UPCAST(MaterialLibrary)
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_MATERIALLIBRARY_H
@@ -35,7 +35,12 @@
 #include <utils/StructureOfArrays.h>
 #include <utils/Range.h>
 
+#include <private/filament/EngineEnums.h>
+#include <private/filament/UibGenerator.h>
+
 #include <cstddef>
+#include <limits>
+#include <vector>
 #include <tsl/robin_set.h>
 
 namespace filament {
@@ -91,6 +96,36 @@ public:
         return mRenderableViewUbh;
     }
 
+    filament::backend::Handle<backend::HwUniformBuffer> getBonesUBO() const noexcept {
+        return mBonesViewUbh;
+    }
+
+    // BONES_OFFSET of the renderables without bones
+    static constexpr uint32_t NO_BONES = std::numeric_limits<uint32_t>::max();
+
+    // Alignment of the bones of each renderable in the bone palette, this is the largest uniform
+    // buffer offset alignment allowed by the backends.
+    static constexpr size_t BONES_ALIGNMENT = 256;
+
+    // The size of the bones uniform block. The bone palette is padded so that the bones of its
+    // last renderable can still be bound as a full block, as WebGL requires. Metal ignores the
+    // size of the bound range, and assumes the full block too.
+    static constexpr size_t BONES_BLOCK_SIZE = CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone);
+
+    // BONES_OFFSET holds the offset of the bones of a renderable in the bone palette, which is a
+    // multiple of BONES_ALIGNMENT, and in its low bits the number of BONES_ALIGNMENT blocks they
+    // span, minus one. Each draw only binds the range of the palette holding its bones.
+    static constexpr uint32_t getBonesOffset(uint32_t bones) noexcept {
+        return bones & ~uint32_t(BONES_ALIGNMENT - 1);
+    }
+
+    static constexpr uint32_t getBonesSize(uint32_t bones) noexcept {
+        return ((bones & uint32_t(BONES_ALIGNMENT - 1)) + 1) * uint32_t(BONES_ALIGNMENT);
+    }
+
+    static_assert(BONES_BLOCK_SIZE <= BONES_ALIGNMENT * BONES_ALIGNMENT,
+            "The size of the bones of a renderable must fit in the low bits of BONES_OFFSET");
+
     /*
      * Storage for per-frame renderable data
      */
@@ -102,7 +137,7 @@ public:
         WORLD_TRANSFORM,        // 16 | instance of the Transform component
         REVERSED_WINDING_ORDER, //  1 | det(WORLD_TRANSFORM)<0
         VISIBILITY_STATE,       //  1 | visibility data of the component
-        BONES_UBH,              //  4 | bones uniform buffer handle
+        BONES_OFFSET,           //  4 | range of the bones in the bone palette, or NO_BONES
         WORLD_AABB_CENTER,      // 12 | world-space bounding box center of the renderable
         VISIBLE_MASK,           //  1 | each bit represents a visibility in a pass
         MORPH_WEIGHTS,          //  4 | floats for morphing
@@ -121,7 +156,7 @@ public:
             math::mat4f,                                // WORLD_TRANSFORM
             bool,                                       // REVERSED_WINDING_ORDER
             FRenderableManager::Visibility,             // VISIBILITY_STATE
-            backend::Handle<backend::HwUniformBuffer>,  // BONES_UBH
+            uint32_t,                                   // BONES_OFFSET
             math::float3,                               // WORLD_AABB_CENTER
             VisibleMaskType,                            // VISIBLE_MASK
             math::float4,                               // MORPH_WEIGHTS
@@ -181,7 +216,8 @@ public:
         LIGHT_INSTANCE,
         VISIBILITY,
         SCREEN_SPACE_Z_RANGE,
-        SHADOW_INFO
+        SHADOW_INFO,
+        FADE                    // intensity scale of lights close to the view's light budget cut
     };
 
     using LightSoa = utils::StructureOfArrays<
@@ -190,7 +226,8 @@ public:
             FLightManager::Instance,
             Culler::result_type,
             math::float2,
-            ShadowInfo
+            ShadowInfo,
+            float
     >;
 
     LightSoa const& getLightData() const noexcept { return mLightData; }
@@ -198,6 +235,22 @@ public:
 
     void updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept;
 
+    // Assigns the offsets of the visible renderables' bones in the bone palette, and returns its
+    // size in bytes, or 0 if there are no bones. The content of the palette is described by
+    // layout, which holds the instance and the bones version of each renderable with bones: the
+    // palette only needs to be packed again when its layout changes.
+    size_t prepareBones(utils::Range<uint32_t> visibleRenderables,
+            std::vector<uint64_t>* layout) noexcept;
+
+    // Packs the bones of the visible renderables into the bone palette, this must be called after
+    // prepareBones() with the same renderables.
+    void updateBonesUBO(utils::Range<uint32_t> visibleRenderables, size_t size,
+            backend::Handle<backend::HwUniformBuffer> bonesUbh) noexcept;
+
+    void setBonesUBO(backend::Handle<backend::HwUniformBuffer> bonesUbh) noexcept {
+        mBonesViewUbh = bonesUbh;
+    }
+
     bool hasContactShadows() const noexcept;
 
 private:
@@ -228,6 +281,7 @@ private:
     RenderableSoa mRenderableData;
     LightSoa mLightData;
     backend::Handle<backend::HwUniformBuffer> mRenderableViewUbh; // This is actually owned by the view.
+    backend::Handle<backend::HwUniformBuffer> mBonesViewUbh; // This is actually owned by the view.
     bool mHasContactShadows = false;
 };
 
@@ -58,6 +58,9 @@ public:
     explicit ShadowMapManager(FEngine& engine);
     ~ShadowMapManager();
 
+    // Frees the shadow texture kept from the previous frame.
+    void terminate(FEngine& engine) noexcept;
+
     // Reset shadow map layout.
     void reset() noexcept;
 
@@ -81,14 +84,35 @@ public:
         return mCascadeShadowMapCache[c].get();
     }
 
-private:
-
     struct ShadowLayout {
         uint8_t layer = 0;
         uint32_t size = 0;
         uint8_t vsmSamples = 1;
+        math::uint2 offset = {};    // position of the shadow map within its layer, in texels
     };
 
+    // Appends the state a shadow map depends on to state. Returns false if the shadow map
+    // can't be cached, e.g. because some of its casters are skinned.
+    // Public for testing.
+    static bool appendShadowMapState(ShadowMap const& shadowMap, ShadowLayout const& layout,
+            FRenderableManager const& rcm, FScene::RenderableSoa const& renderableData,
+            utils::Range<uint32_t> range, uint8_t visibilityMask,
+            std::vector<uint8_t>* state) noexcept;
+
+    // Packs count shadow maps into the layers of the shadow texture starting at firstLayer.
+    // The maps are placed by increasing key, so that their placement doesn't depend on their
+    // order, keys must be unique. Returns the number of layers used.
+    // Public for testing.
+    static uint8_t packShadowMaps(ShadowLayout* layouts, uint64_t const* keys, size_t count,
+            uint32_t atlasDimension, uint8_t firstLayer) noexcept;
+
+private:
+    static constexpr size_t MAX_SHADOW_LAYERS =
+            CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
+
+    // The smallest a spot light shadow map gets when it's reduced, border included.
+    static constexpr uint16_t MIN_SPOT_SHADOW_MAP_SIZE = 16;
+
     struct TextureRequirements {
         uint16_t size = 0;
         uint8_t layers = 0;
@@ -104,6 +128,16 @@ private:
 
     void calculateTextureRequirements(FEngine& engine, FView& view, FScene::LightSoa& lightData) noexcept;
 
+    // Returns the mask of the layers of the shadow texture that must be rendered this frame,
+    // i.e. all of them unless the cached shadow texture can be reused.
+    uint32_t updateCache(FEngine& engine, FView const& view,
+            FrameGraphTexture::Descriptor const& desc) noexcept;
+
+    // Packs the spot light shadow maps into the layers of the shadow texture starting at
+    // firstLayer, see packShadowMaps(). Returns the number of layers used.
+    uint8_t packSpotShadowMaps(FScene::LightSoa const& lightData, uint32_t atlasDimension,
+            uint8_t firstLayer) noexcept;
+
     class ShadowMapEntry {
     public:
         ShadowMapEntry() = default;
@@ -118,8 +152,10 @@ private:
         size_t getLightIndex() const { return mLightIndex; }
         const ShadowLayout& getLayout() const { return mLayout; }
         bool hasVisibleShadows() const { return mHasVisibleShadows; }
+        bool isCached() const { return mCached; }
 
         void setHasVisibleShadows(bool hasVisibleShadows) { mHasVisibleShadows = hasVisibleShadows; }
+        void setCached(bool cached) { mCached = cached; }
         void setLayout(const ShadowLayout& layout) { mLayout = layout; }
 
     private:
@@ -127,6 +163,7 @@ private:
         size_t mLightIndex = 0;
         ShadowLayout mLayout = {};
         bool mHasVisibleShadows = false;
+        bool mCached = false;
     };
 
     class CascadeSplits {
@@ -180,6 +217,13 @@ private:
 
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASCADES> mCascadeShadowMapCache;
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASTING_SPOTS> mSpotShadowMapCache;
+
+    // The shadow texture kept from the previous frame, and the state of its layers.
+    // mLayerStates is only kept to reuse its allocations.
+    FrameGraphTexture mCachedTexture;
+    FrameGraphTexture::Descriptor mCachedTextureDesc;
+    std::array<std::vector<uint8_t>, MAX_SHADOW_LAYERS> mCachedLayerStates;
+    std::array<std::vector<uint8_t>, MAX_SHADOW_LAYERS> mLayerStates;
 };
 
 } // namespace filament
@@ -48,6 +48,10 @@
 
 #include <math/scalar.h>
 
+#include <tsl/robin_map.h>
+
+#include <vector>
+
 namespace utils {
 class JobSystem;
 } // namespace utils;
@@ -278,6 +282,14 @@ public:
 
     void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
 
+    void setDynamicLightBudget(uint32_t count) noexcept {
+        mDynamicLightBudget = std::min(count, uint32_t(CONFIG_MAX_LIGHT_COUNT));
+    }
+
+    uint32_t getDynamicLightBudget() const noexcept {
+        return mDynamicLightBudget;
+    }
+
     void setPostProcessingEnabled(bool enabled) noexcept {
         mHasPostProcessPass = enabled;
     }
@@ -424,13 +436,27 @@ public:
     // (e.g.: after the FrameFraph execution).
     void commitFrameHistory(FEngine& engine) noexcept;
 
+    // The fade of the point and spot lights visible in the previous frame, by light instance.
+    using LightFades = tsl::robin_map<uint32_t, float>;
+
+    // Keeps at most "budget" point and spot lights of lightData, favoring the ones that
+    // contribute the most to the image, and sets their FADE. "fades" carries the fades from one
+    // frame to the next, so that lights entering or leaving the budget fade progressively.
+    static void applyLightBudget(FLightManager const& lcm, CameraInfo const& camera,
+            uint32_t budget, FScene::LightSoa& lightData, LightFades* fades) noexcept;
+
+    // Multiplies each score by the fraction of the viewport covered by the given light spheres.
+    static void computeLightScores(float* scores, CameraInfo const& camera,
+            math::float4 const* spheres, size_t count) noexcept;
+
 private:
     void prepareVisibleRenderables(utils::JobSystem& js,
             Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
 
     static void prepareVisibleLights(
             FLightManager const& lcm, utils::JobSystem& js, Frustum const& frustum,
-            FScene::LightSoa& lightData) noexcept;
+            CameraInfo const& camera, uint32_t budget, FScene::LightSoa& lightData,
+            LightFades* fades) noexcept;
 
     static void computeVisibilityMasks(
             uint8_t visibleLayers, uint8_t const* layers,
@@ -461,6 +487,7 @@ private:
     backend::Handle<backend::HwUniformBuffer> mLightUbh;
     backend::Handle<backend::HwUniformBuffer> mShadowUbh;
     backend::Handle<backend::HwUniformBuffer> mRenderableUbh;
+    backend::Handle<backend::HwUniformBuffer> mBonesUbh;
 
     FScene* mScene = nullptr;
     FCamera* mCullingCamera = nullptr;
@@ -517,8 +544,13 @@ private:
     Range mVisibleDirectionalShadowCasters;
     Range mSpotLightShadowCasters;
     uint32_t mRenderableUBOSize = 0;
+    uint32_t mBonesUBOSize = 0;
+    std::vector<uint64_t> mBonesLayout;         // see FScene::prepareBones()
+    std::vector<uint64_t> mBonesLayoutScratch;
     mutable bool mHasDirectionalLight = false;
     mutable bool mHasDynamicLighting = false;
+    uint32_t mDynamicLightBudget = CONFIG_MAX_LIGHT_COUNT;
+    LightFades mLightFades;             // see applyLightBudget()
     mutable bool mHasShadowing = false;
     mutable bool mNeedsShadowMap = false;
 
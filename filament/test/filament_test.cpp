@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <random>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -41,8 +44,15 @@
 #include "details/Camera.h"
 #include "details/Froxelizer.h"
 #include "details/Engine.h"
+#include "details/MaterialInstance.h"
+#include "details/RenderPrimitive.h"
+#include "details/Scene.h"
+#include "details/ShadowMap.h"
+#include "details/ShadowMapManager.h"
+#include "details/View.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
+#include "UniformArena.h"
 #include "UniformBuffer.h"
 
 using namespace filament;
@@ -277,6 +287,151 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(c, tcm.getChildCount(newParent));
 }
 
+TEST(FilamentTest, TransformManagerHierarchy) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 6> entities;
+    em.create(entities.size(), entities.data());
+
+    // a chain e[5] -> e[4] -> ... -> e[1] -> e[0], created with the children first, and a
+    // root e[5]
+    for (Entity e : entities) {
+        tcm.create(e);
+    }
+    auto instance = [&](size_t i) { return tcm.getInstance(entities[i]); };
+    for (size_t i = 0; i < entities.size() - 1; i++) {
+        tcm.setParent(instance(i), instance(i + 1));
+    }
+
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < entities.size(); i++) {
+        tcm.setTransform(instance(i), mat4f::translation(float3{ 1, 0, 0 }));
+    }
+    tcm.commitLocalTransformTransaction();
+
+    // each level adds a translation
+    for (size_t i = 0; i < entities.size(); i++) {
+        EXPECT_EQ(tcm.getWorldTransform(instance(i)),
+                mat4f::translation(float3{ float(entities.size() - i), 0, 0 }));
+    }
+
+    // only the subtree of the modified node changes
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(instance(2), mat4f::translation(float3{ 0, 1, 0 }));
+    tcm.commitLocalTransformTransaction();
+
+    EXPECT_EQ(tcm.getWorldTransform(instance(5)), mat4f::translation(float3{ 1, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instance(3)), mat4f::translation(float3{ 3, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instance(2)), mat4f::translation(float3{ 3, 1, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instance(0)), mat4f::translation(float3{ 5, 1, 0 }));
+
+    // destroying a node turns its children into roots
+    tcm.openLocalTransformTransaction();
+    tcm.destroy(entities[3]);
+    tcm.commitLocalTransformTransaction();
+
+    EXPECT_EQ(tcm.getWorldTransform(instance(2)), mat4f::translation(float3{ 0, 1, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instance(0)), mat4f::translation(float3{ 2, 1, 0 }));
+
+    em.destroy(entities.size(), entities.data());
+}
+
+TEST(FilamentTest, TransformManagerSetTransforms) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 4> entities;
+    em.create(entities.size(), entities.data());
+
+    // e[1] -> e[0], e[2] and e[3] are roots
+    for (Entity e : entities) {
+        tcm.create(e);
+    }
+    std::array<FTransformManager::Instance, 4> instances;
+    for (size_t i = 0; i < entities.size(); i++) {
+        instances[i] = tcm.getInstance(entities[i]);
+    }
+    tcm.setParent(instances[1], instances[0]);
+
+    // the local transforms are read from an array of structures
+    struct Node {
+        mat4f transform;
+        uint32_t id;
+    };
+    std::array<Node, 4> nodes;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i] = { mat4f::translation(float3{ 0, float(i + 1), 0 }), uint32_t(i) };
+    }
+    tcm.setTransforms(instances.data(), &nodes[0].transform, nodes.size(), sizeof(Node));
+
+    EXPECT_EQ(tcm.getWorldTransform(instances[0]), mat4f::translation(float3{ 0, 1, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[1]), mat4f::translation(float3{ 0, 3, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[2]), mat4f::translation(float3{ 0, 3, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[3]), mat4f::translation(float3{ 0, 4, 0 }));
+
+    // a transaction doesn't move the nodes, and only the parent is updated here
+    tcm.openLocalTransformTransaction();
+    tcm.commitLocalTransformTransaction();
+    for (size_t i = 0; i < entities.size(); i++) {
+        EXPECT_EQ(tcm.getInstance(entities[i]), instances[i]);
+    }
+    const mat4f transform = mat4f::translation(float3{ 2, 0, 0 });
+    tcm.setTransforms(&instances[0], &transform, 1, sizeof(mat4f));
+
+    EXPECT_EQ(tcm.getTransform(instances[1]), mat4f::translation(float3{ 0, 2, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[1]), mat4f::translation(float3{ 2, 2, 0 }));
+
+    // a child and its parent are updated, the child first
+    const FTransformManager::Instance childFirst[2] = { instances[1], instances[0] };
+    const mat4f transforms[2] = {
+            mat4f::translation(float3{ 0, 0, 3 }), mat4f::translation(float3{ 4, 0, 0 }) };
+    tcm.setTransforms(childFirst, transforms, 2, sizeof(mat4f));
+
+    EXPECT_EQ(tcm.getWorldTransform(instances[0]), mat4f::translation(float3{ 4, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[1]), mat4f::translation(float3{ 4, 0, 3 }));
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(entities[2])),
+            mat4f::translation(float3{ 0, 3, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(entities[3])),
+            mat4f::translation(float3{ 0, 4, 0 }));
+
+    // the nodes are clean, setTransform() still works as before
+    tcm.setTransform(instances[0], mat4f{});
+    EXPECT_EQ(tcm.getWorldTransform(instances[1]), mat4f::translation(float3{ 0, 0, 3 }));
+
+    em.destroy(entities.size(), entities.data());
+}
+
+TEST(FilamentTest, TransformManagerDestroyThenSetTransforms) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 3> entities;
+    em.create(entities.size(), entities.data());
+
+    // e[2] -> e[1] -> e[0]
+    for (Entity e : entities) {
+        tcm.create(e);
+    }
+    auto instance = [&](size_t i) { return tcm.getInstance(entities[i]); };
+    tcm.setParent(instance(1), instance(0));
+    tcm.setParent(instance(2), instance(1));
+    for (size_t i = 0; i < entities.size(); i++) {
+        tcm.setTransform(instance(i), mat4f::translation(float3{ 1, 0, 0 }));
+    }
+    EXPECT_EQ(tcm.getWorldTransform(instance(2)), mat4f::translation(float3{ 3, 0, 0 }));
+
+    // outside of a transaction, destroying the root updates its subtree right away
+    tcm.destroy(entities[0]);
+    EXPECT_EQ(tcm.getWorldTransform(instance(1)), mat4f::translation(float3{ 1, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instance(2)), mat4f::translation(float3{ 2, 0, 0 }));
+
+    // so setting the grandchild alone updates it
+    const FTransformManager::Instance grandchild = instance(2);
+    const mat4f transform = mat4f::translation(float3{ 0, 1, 0 });
+    tcm.setTransforms(&grandchild, &transform, 1, sizeof(mat4f));
+    EXPECT_EQ(tcm.getWorldTransform(grandchild), mat4f::translation(float3{ 1, 1, 0 }));
+
+    em.destroy(entities.size(), entities.data());
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -501,6 +656,57 @@ TEST(FilamentTest, UniformBufferSize2) {
     buffer.invalidate();
 }
 
+TEST(FilamentTest, UniformArena) {
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FEngine::DriverApi& driver = engine->getDriverApi();
+
+    UniformArena arena;
+    const uint32_t a = arena.allocate(driver, 16);
+    const uint32_t b = arena.allocate(driver, UniformArena::ALIGNMENT + 4);
+    const uint32_t c = arena.allocate(driver, 4);
+
+    // slots are aligned, and packed in allocation order
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, UniformArena::ALIGNMENT);
+    EXPECT_EQ(c, 3 * UniformArena::ALIGNMENT);
+    EXPECT_EQ(arena.getHandle(a), arena.getHandle(c));
+    EXPECT_EQ(UniformArena::getBufferOffset(c), c);
+
+    // a freed slot is reused by the next allocation of the same size
+    arena.free(a, 16);
+    EXPECT_EQ(arena.allocate(driver, 32), a);
+
+    // slots never straddle two pages
+    uint32_t last = c;
+    while (last < UniformArena::PAGE_SIZE) {
+        last = arena.allocate(driver, 2 * UniformArena::ALIGNMENT);
+        EXPECT_LE(UniformArena::getBufferOffset(last) + 2 * UniformArena::ALIGNMENT,
+                UniformArena::PAGE_SIZE);
+    }
+    EXPECT_EQ(last, UniformArena::PAGE_SIZE);
+    EXPECT_EQ(UniformArena::getBufferOffset(last), 0u);
+    EXPECT_NE(arena.getHandle(last), arena.getHandle(a));
+
+    // updates of the same page are coalesced into a single upload
+    UniformBuffer uniforms(16);
+    arena.update(a, uniforms);
+    arena.update(b, uniforms);
+    arena.update(c, uniforms);
+    EXPECT_FALSE(uniforms.isDirty());
+    EXPECT_EQ(arena.commit(driver), 1u);
+    EXPECT_EQ(arena.commit(driver), 0u);
+
+    // only the pages that were updated are uploaded
+    arena.update(last, uniforms);
+    EXPECT_EQ(arena.commit(driver), 1u);
+    arena.update(a, uniforms);
+    arena.update(last, uniforms);
+    EXPECT_EQ(arena.commit(driver), 2u);
+
+    arena.terminate(driver);
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, BoxCulling) {
     Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
 
@@ -688,8 +894,8 @@ TEST(FilamentTest, FroxelData) {
     LightManager::Instance instance = engine->getLightManager().getInstance(e);
 
     FScene::LightSoa lights;
-    lights.push_back({}, {}, {}, {}, {}, {});   // first one is always skipped
-    lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {});
+    lights.push_back({}, {}, {}, {}, {}, {}, {});   // first one is always skipped
+    lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {}, 1.0f);
 
     {
         froxelData.froxelizeLights(*engine, {}, lights);
@@ -727,6 +933,392 @@ TEST(FilamentTest, FroxelData) {
     Engine::destroy((Engine **)&engine);
 }
 
+TEST(FilamentTest, FroxelDataReuse) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+    utils::ArenaScope<LinearAllocatorArena> scope(arena);
+
+    Entity e = engine->getEntityManager().create();
+    LightManager::Builder(LightManager::Type::POINT).build(*engine, e);
+    LightManager::Instance instance = engine->getLightManager().getInstance(e);
+
+    FScene::LightSoa lights;
+    lights.push_back({}, {}, {}, {}, {}, {}, {});   // first one is always skipped
+    lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {}, 1.0f);
+
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+    Froxelizer froxelData(*engine);
+    froxelData.setOptions(5, 100);
+
+    auto froxelize = [&](Viewport const& vp) {
+        froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+        froxelData.froxelizeLights(*engine, {}, lights);
+        return froxelData.isFroxelizationReused();
+    };
+
+    // nothing changed, the previous froxelization is reused
+    EXPECT_FALSE(froxelize({ 0, 0, 1280, 640 }));
+    EXPECT_TRUE(froxelize({ 0, 0, 1280, 640 }));
+
+    // the viewport is resized with the same projection, the froxels must be recomputed
+    EXPECT_FALSE(froxelize({ 0, 0, 1290, 640 }));
+    EXPECT_TRUE(froxelize({ 0, 0, 1290, 640 }));
+
+    // a light moved
+    lights.elementAt<FScene::POSITION_RADIUS>(1) = float4{ 0, 0, -3, 1 };
+    EXPECT_FALSE(froxelize({ 0, 0, 1290, 640 }));
+
+    froxelData.terminate(engine->getDriverApi());
+
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, LightBudget) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    auto& lcm = engine->getLightManager();
+
+    CameraInfo camera;
+    camera.projection = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    constexpr size_t LIGHT_COUNT = 64;
+    constexpr uint32_t BUDGET = 32;
+    std::vector<Entity> entities(LIGHT_COUNT);
+    engine->getEntityManager().create(LIGHT_COUNT, entities.data());
+    for (size_t i = 0; i < LIGHT_COUNT; i++) {
+        LightManager::Builder(LightManager::Type::POINT)
+                .intensity(1000.0f * float(i + 1))
+                .build(*engine, entities[i]);
+    }
+
+    auto makeLights = [&](bool sameIntensity) {
+        FScene::LightSoa lights;
+        lights.push_back({}, {}, {}, {}, {}, {}, {});   // directional light
+        for (size_t i = 0; i < LIGHT_COUNT; i++) {
+            auto instance = lcm.getInstance(entities[sameIntensity ? 0 : i]);
+            lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {}, 0.0f);
+        }
+        return lights;
+    };
+
+    // runs a frame and returns the fade of each light, 0 if it's not kept
+    auto applyBudget = [&](FView::LightFades* fades) {
+        FScene::LightSoa lights = makeLights(false);
+        FView::applyLightBudget(lcm, camera, BUDGET, lights, fades);
+        EXPECT_LE(lights.size(), FScene::DIRECTIONAL_LIGHTS_COUNT + BUDGET);
+        std::vector<float> result(LIGHT_COUNT, 0.0f);
+        for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < lights.size(); i++) {
+            auto instance = lights.elementAt<FScene::LIGHT_INSTANCE>(i);
+            auto k = std::find_if(entities.begin(), entities.end(),
+                    [&](Entity e) { return lcm.getInstance(e) == instance; }) - entities.begin();
+            EXPECT_GT(lights.elementAt<FScene::FADE>(i), 0.0f);
+            result[k] = lights.elementAt<FScene::FADE>(i);
+        }
+        return result;
+    };
+
+    {
+        // lights with the same score: the budget is filled, with lights that just became
+        // visible, so they don't fade in
+        FView::LightFades fades;
+        FScene::LightSoa lights = makeLights(true);
+        FView::applyLightBudget(lcm, camera, BUDGET, lights, &fades);
+        ASSERT_EQ(lights.size(), FScene::DIRECTIONAL_LIGHTS_COUNT + BUDGET);
+        for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < lights.size(); i++) {
+            EXPECT_EQ(lights.elementAt<FScene::FADE>(i), 1.0f);
+        }
+    }
+
+    {
+        // lights with different scores: the brightest lights are kept
+        FView::LightFades fades;
+        std::vector<float> fade = applyBudget(&fades);
+        for (size_t i = 0; i < LIGHT_COUNT; i++) {
+            EXPECT_EQ(fade[i], i < LIGHT_COUNT - BUDGET ? 0.0f : 1.0f);
+        }
+
+        // a dropped light slightly brighter than the lowest kept one doesn't replace it
+        const size_t cut = LIGHT_COUNT - BUDGET;
+        auto dropped = lcm.getInstance(entities[cut - 1]);
+        lcm.setIntensity(dropped, 1000.0f * float(cut + 1) * 1.1f,
+                FLightManager::IntensityUnit::LUMEN_LUX);
+        EXPECT_EQ(applyBudget(&fades), fade);
+
+        // a much brighter one does, the lowest kept light fades out before it fades in, and
+        // no light's fade changes by more than 1/8 per frame
+        lcm.setIntensity(dropped, 1000.0f * float(LIGHT_COUNT + 1),
+                FLightManager::IntensityUnit::LUMEN_LUX);
+        for (size_t frame = 0; frame < 16; frame++) {
+            std::vector<float> next = applyBudget(&fades);
+            for (size_t i = 0; i < LIGHT_COUNT; i++) {
+                EXPECT_LE(std::abs(next[i] - fade[i]), 0.125f);
+            }
+            EXPECT_TRUE(next[cut] == 0.0f || next[cut - 1] == 0.0f);
+            fade = next;
+        }
+        for (size_t i = 0; i < LIGHT_COUNT; i++) {
+            EXPECT_EQ(fade[i], i < cut - 1 || i == cut ? 0.0f : 1.0f);
+        }
+        lcm.setIntensity(dropped, 1000.0f * float(cut), FLightManager::IntensityUnit::LUMEN_LUX);
+    }
+
+    for (Entity e : entities) {
+        lcm.destroy(e);
+    }
+    engine->getEntityManager().destroy(LIGHT_COUNT, entities.data());
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ShadowMapCacheState) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FScene* scene = engine->createScene();
+    auto& rcm = engine->getRenderableManager();
+    FMaterial const* material = engine->getDefaultMaterial();
+    FMaterialInstance* mi0 = material->createInstance("mi0");
+    FMaterialInstance* mi1 = material->createInstance("mi1");
+
+    ShadowMap shadowMap(*engine);
+    ShadowMapManager::ShadowLayout layout{ .layer = 1, .size = 512, .offset = { 0, 512 } };
+
+    std::array<Entity, 2> entities;
+    engine->getEntityManager().create(2, entities.data());
+    for (Entity entity : entities) {
+        RenderableManager::Builder(1)
+                .material(0, mi0)
+                .culling(false).castShadows(true).receiveShadows(false)
+                .build(*engine, entity);
+        scene->addEntity(entity);
+    }
+    scene->prepare(mat4f{});
+    auto& renderables = scene->getRenderableData();
+    ASSERT_EQ(renderables.size(), 2);
+    renderables.elementAt<FScene::VISIBLE_MASK>(0) = VISIBLE_DIR_SHADOW_RENDERABLE;
+    renderables.elementAt<FScene::VISIBLE_MASK>(1) = 0;
+    auto instance = renderables.elementAt<FScene::RENDERABLE_INSTANCE>(0);
+
+    auto getState = [&](std::vector<uint8_t>* state) {
+        state->clear();
+        return ShadowMapManager::appendShadowMapState(shadowMap, layout, rcm, renderables,
+                { 0, uint32_t(renderables.size()) }, VISIBLE_DIR_SHADOW_RENDERABLE, state);
+    };
+
+    std::vector<uint8_t> cached;
+    std::vector<uint8_t> state;
+    EXPECT_TRUE(getState(&cached));
+    EXPECT_TRUE(getState(&state));
+    EXPECT_EQ(state, cached);
+
+    // casters that aren't visible from the light don't matter
+    renderables.elementAt<FScene::WORLD_TRANSFORM>(1) = mat4f::translation(float3{ 1, 0, 0 });
+    EXPECT_TRUE(getState(&state));
+    EXPECT_EQ(state, cached);
+
+    // a caster moved
+    renderables.elementAt<FScene::WORLD_TRANSFORM>(0) = mat4f::translation(float3{ 1, 0, 0 });
+    EXPECT_TRUE(getState(&state));
+    EXPECT_NE(state, cached);
+    getState(&cached);
+
+    // the material instance of a caster is swapped
+    rcm.setMaterialInstanceAt(instance, 0, 0, mi1);
+    EXPECT_TRUE(getState(&state));
+    EXPECT_NE(state, cached);
+    getState(&cached);
+
+    // the material instance of a caster changes
+    mi1->setCullingMode(backend::CullingMode::NONE);
+    EXPECT_TRUE(getState(&state));
+    EXPECT_NE(state, cached);
+    getState(&cached);
+
+    mi1->setDepthWrite(false);
+    EXPECT_TRUE(getState(&state));
+    EXPECT_NE(state, cached);
+    getState(&cached);
+
+    // changes to other instances don't matter
+    mi0->setCullingMode(backend::CullingMode::NONE);
+    EXPECT_TRUE(getState(&state));
+    EXPECT_EQ(state, cached);
+
+    // the shadow map moved in the atlas
+    layout.offset = { 512, 512 };
+    EXPECT_TRUE(getState(&state));
+    EXPECT_NE(state, cached);
+
+    // skinned casters can't be cached
+    renderables.elementAt<FScene::BONES_OFFSET>(0) = 0;
+    EXPECT_FALSE(getState(&state));
+
+    for (Entity entity : entities) {
+        rcm.destroy(entity);
+    }
+    engine->destroy(mi0);
+    engine->destroy(mi1);
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ShadowMapPacking) {
+    using namespace filament;
+    using ShadowLayout = ShadowMapManager::ShadowLayout;
+
+    constexpr uint32_t ATLAS_SIZE = 1024;
+    constexpr size_t COUNT = 6;
+    const uint32_t sizes[COUNT] = { 256, 1024, 512, 256, 512, 256 };
+    uint64_t keys[COUNT];
+    for (size_t i = 0; i < COUNT; i++) {
+        keys[i] = uint64_t(UINT16_MAX - sizes[i]) << 32u | i;
+    }
+
+    auto pack = [&](size_t const* order, ShadowLayout* layouts) {
+        ShadowLayout permuted[COUNT];
+        uint64_t permutedKeys[COUNT];
+        for (size_t i = 0; i < COUNT; i++) {
+            permuted[i].size = sizes[order[i]];
+            permutedKeys[i] = keys[order[i]];
+        }
+        const uint8_t layers = ShadowMapManager::packShadowMaps(permuted, permutedKeys, COUNT,
+                ATLAS_SIZE, 1);
+        for (size_t i = 0; i < COUNT; i++) {
+            layouts[order[i]] = permuted[i];
+        }
+        return layers;
+    };
+
+    size_t order[COUNT] = { 0, 1, 2, 3, 4, 5 };
+    ShadowLayout expected[COUNT];
+    EXPECT_EQ(pack(order, expected), 2);
+
+    for (size_t i = 0; i < COUNT; i++) {
+        ShadowLayout const& a = expected[i];
+        EXPECT_GE(a.layer, 1);
+        EXPECT_LE(a.offset.x + a.size, ATLAS_SIZE);
+        EXPECT_LE(a.offset.y + a.size, ATLAS_SIZE);
+        for (size_t j = 0; j < i; j++) {
+            // the shadow maps don't overlap
+            ShadowLayout const& b = expected[j];
+            const bool overlap = a.layer == b.layer &&
+                    a.offset.x < b.offset.x + b.size && b.offset.x < a.offset.x + a.size &&
+                    a.offset.y < b.offset.y + b.size && b.offset.y < a.offset.y + a.size;
+            EXPECT_FALSE(overlap);
+        }
+    }
+
+    // the placement doesn't depend on the order of the shadow maps
+    std::mt19937 generator(1234);
+    for (size_t n = 0; n < 8; n++) {
+        std::shuffle(order, order + COUNT, generator);
+        ShadowLayout layouts[COUNT];
+        EXPECT_EQ(pack(order, layouts), 2);
+        for (size_t i = 0; i < COUNT; i++) {
+            EXPECT_EQ(layouts[i].layer, expected[i].layer);
+            EXPECT_EQ(layouts[i].offset, expected[i].offset);
+        }
+    }
+}
+
+TEST(FilamentTest, BonePalette) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FScene* scene = engine->createScene();
+    auto& rcm = engine->getRenderableManager();
+
+    // a renderable without bones, skinned renderables, and a morphed renderable without bones
+    constexpr size_t COUNT = 5;
+    const size_t boneCounts[COUNT] = { 0, 3, 5, 0, 4 };
+    const bool morphing[COUNT] = { false, false, false, true, true };
+    std::array<Entity, COUNT> entities;
+    engine->getEntityManager().create(COUNT, entities.data());
+    for (size_t i = 0; i < COUNT; i++) {
+        RenderableManager::Builder builder(1);
+        builder.culling(false).castShadows(false).receiveShadows(false)
+                .morphing(morphing[i]);
+        if (boneCounts[i]) {
+            builder.skinning(boneCounts[i]);
+        }
+        builder.build(*engine, entities[i]);
+        scene->addEntity(entities[i]);
+    }
+
+    auto const& renderables = scene->getRenderableData();
+    auto prepareBones = [&](std::vector<uint64_t>* layout) {
+        scene->prepare(mat4f{});
+        return scene->prepareBones({ 0, uint32_t(renderables.size()) }, layout);
+    };
+
+    std::vector<uint64_t> layout;
+    const size_t size = prepareBones(&layout);
+    ASSERT_EQ(renderables.size(), COUNT);
+
+    // each renderable with bones gets an aligned range of the palette, large enough for its
+    // bones, or for one bone if it's only morphed
+    size_t expectedSize = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    for (size_t i = 0; i < COUNT; i++) {
+        auto ri = renderables.elementAt<FScene::RENDERABLE_INSTANCE>(i);
+        size_t k = std::find_if(entities.begin(), entities.end(),
+                [&](Entity e) { return rcm.getInstance(e) == ri; }) - entities.begin();
+        ASSERT_LT(k, COUNT);
+        const uint32_t bones = renderables.elementAt<FScene::BONES_OFFSET>(i);
+        if (boneCounts[k] == 0 && !morphing[k]) {
+            EXPECT_EQ(bones, FScene::NO_BONES);
+            continue;
+        }
+        // the range bound for the renderable is just large enough for its bones
+        const uint32_t offset = FScene::getBonesOffset(bones);
+        const size_t count = std::max(boneCounts[k], size_t(1));
+        const size_t alignedSize = (count * sizeof(PerRenderableUibBone) +
+                FScene::BONES_ALIGNMENT - 1) & ~(FScene::BONES_ALIGNMENT - 1);
+        EXPECT_EQ(offset % FScene::BONES_ALIGNMENT, 0);
+        EXPECT_EQ(FScene::getBonesSize(bones), alignedSize);
+        ranges.emplace_back(offset, uint32_t(offset + count * sizeof(PerRenderableUibBone)));
+        expectedSize += alignedSize;
+    }
+    EXPECT_EQ(size, expectedSize);
+    EXPECT_EQ(layout.size(), 4);
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        EXPECT_LE(ranges[i].second, size);
+        if (i > 0) {
+            EXPECT_LE(ranges[i - 1].second, ranges[i].first);
+        }
+    }
+
+    // the layout only changes when some bones change
+    std::vector<uint64_t> next;
+    EXPECT_EQ(prepareBones(&next), size);
+    EXPECT_EQ(next, layout);
+
+    const mat4f bone = mat4f::translation(float3{ 1, 2, 3 });
+    rcm.setBones(rcm.getInstance(entities[2]), &bone, 1);
+    EXPECT_EQ(prepareBones(&next), size);
+    EXPECT_NE(next, layout);
+    layout = next;
+
+    EXPECT_EQ(prepareBones(&next), size);
+    EXPECT_EQ(next, layout);
+
+    // or when the visible renderables change
+    scene->remove(entities[1]);
+    EXPECT_LT(prepareBones(&next), size);
+    EXPECT_NE(next, layout);
+
+    for (Entity e : entities) {
+        rcm.destroy(e);
+    }
+    engine->getEntityManager().destroy(COUNT, entities.data());
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, Bones) {
 
     struct Shader {
@@ -80,6 +80,7 @@ enum UTILS_PUBLIC ChunkType : uint64_t {
 
     DictionaryText = charTo64bitNum("DIC_TEXT"),
     DictionarySpirv = charTo64bitNum("DIC_SPIR"),
+    DictionaryLibrary = charTo64bitNum("DIC_LIBR"),
 };
 
 } // namespace filamat
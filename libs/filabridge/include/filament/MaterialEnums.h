@@ -211,6 +211,23 @@ enum class Property : uint8_t {
     // when adding new Properties, make sure to update MATERIAL_PROPERTIES_COUNT
 };
 
+/**
+ * Variant bits that can be selected when precompiling a material with Material::compile().
+ * Depth variants are always included, as they're required by every material that casts shadows.
+ */
+enum class UserVariantFilterBit : uint8_t {
+    DIRECTIONAL_LIGHTING    = 0x01,     //!< directional lighting
+    DYNAMIC_LIGHTING        = 0x02,     //!< point, spot or area lights
+    SHADOW_RECEIVER         = 0x04,     //!< receives shadows
+    SKINNING                = 0x08,     //!< GPU skinning and/or morphing
+    FOG                     = 0x20,     //!< fog
+    VSM                     = 0x40,     //!< variance shadow maps
+    ALL                     = 0x6F,     //!< all of the above
+};
+
+//! A combination of UserVariantFilterBit values
+using UserVariantFilterMask = uint8_t;
+
 } // namespace filament
 
 #endif
@@ -45,8 +45,12 @@ static_assert(BindingPoints::PER_MATERIAL_INSTANCE == BindingPoints::COUNT - 1,
         "Dynamically sized sampler buffer must be the last binding point.");
 
 // This value is limited by UBO size, ES3.0 only guarantees 16 KiB.
-// Values <= 256, use less CPU and GPU resources.
-constexpr size_t CONFIG_MAX_LIGHT_COUNT = 256;
+// Values <= 256, use less CPU and GPU resources. Larger values, set with FILAMENT_MAX_LIGHT_COUNT,
+// are only supported by the NOOP backend, they exist to benchmark the froxelizer.
+#ifndef FILAMENT_MAX_LIGHT_COUNT
+#    define FILAMENT_MAX_LIGHT_COUNT 256
+#endif
+constexpr size_t CONFIG_MAX_LIGHT_COUNT = FILAMENT_MAX_LIGHT_COUNT;
 constexpr size_t CONFIG_MAX_LIGHT_INDEX = CONFIG_MAX_LIGHT_COUNT - 1;
 
 // The maximum number of spot lights in a scene that can cast shadows.
@@ -59,8 +63,12 @@ constexpr size_t CONFIG_MAX_SHADOW_CASTING_SPOTS = 2;
 constexpr size_t CONFIG_MAX_SHADOW_CASCADES = 4;
 
 // This value is also limited by UBO size, ES3.0 only guarantees 16 KiB.
-// We store 64 bytes per bone.
-constexpr size_t CONFIG_MAX_BONE_COUNT = 256;
+// We store 64 bytes per bone. Larger values, up to 1024, can be set with FILAMENT_MAX_BONE_COUNT
+// for devices with larger uniform blocks, the engine checks that the backend supports them.
+#ifndef FILAMENT_MAX_BONE_COUNT
+#    define FILAMENT_MAX_BONE_COUNT 256
+#endif
+constexpr size_t CONFIG_MAX_BONE_COUNT = FILAMENT_MAX_BONE_COUNT;
 
 } // namespace filament
 
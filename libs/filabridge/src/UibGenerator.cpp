@@ -28,8 +28,8 @@ using namespace backend;
 static_assert(sizeof(PerRenderableUib) % 256 == 0,
         "sizeof(Transform) should be a multiple of 256");
 
-static_assert(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone) <= 16384,
-        "Bones exceed max UBO size");
+static_assert(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone) <= 65536,
+        "Bones exceed the max UBO size of all backends");
 
 static_assert(CONFIG_MAX_SHADOW_CASCADES == 4,
         "Changing CONFIG_MAX_SHADOW_CASCADES affects PerView size and breaks materials.");
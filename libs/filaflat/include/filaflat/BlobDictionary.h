@@ -20,11 +20,16 @@
 #include <cstdint>
 #include <vector>
 
+#include <assert.h>
 #include <stddef.h>
 
 namespace filaflat {
 
 // Flat list of blobs that can be referenced by index.
+//
+// Blobs can be added in compressed form (SMOL-V), in which case they're only decoded the first
+// time getBlob() is called, and the decoded data is cached. Decoded blobs can be released with
+// trim() to keep memory usage under a given limit, they are decoded again if needed.
 class BlobDictionary {
 public:
     BlobDictionary() = default;
@@ -33,11 +38,16 @@ public:
     using Blob = std::vector<uint8_t>;
 
     inline void addBlob(const char* blob, size_t len) noexcept {
-        mBlobs.emplace_back(blob, blob + len);
+        mBlobs.push_back({ Blob(blob, blob + len) });
     }
 
     inline void addBlob(Blob&& blob) noexcept {
-        mBlobs.push_back(std::move(blob));
+        mBlobs.push_back({ std::move(blob) });
+    }
+
+    // Adds a SMOL-V compressed blob. The compressed data must outlive the dictionary.
+    inline void addCompressedBlob(const char* compressed, size_t compressedSize) noexcept {
+        mBlobs.push_back({ {}, compressed, compressedSize });
     }
 
     inline bool isEmpty() const noexcept {
@@ -48,21 +58,48 @@ public:
         mBlobs.reserve(size);
     }
 
-    inline const char* getBlob(size_t index, size_t* size) const noexcept {
-        *size = mBlobs[index].size();
-        return (const char*) mBlobs[index].data();
-    }
+    // Returns the blob at the given index, decoding it first if needed. Returns nullptr if the
+    // blob couldn't be decoded.
+    const char* getBlob(size_t index, size_t* size) noexcept;
 
     inline const char* getString(size_t index) const noexcept {
-        return (const char*) mBlobs[index].data();
+        assert(!mBlobs[index].compressed);
+        return (const char*) mBlobs[index].blob.data();
     }
 
     inline size_t size() const noexcept {
         return mBlobs.size();
     }
 
+    // Sets the maximum size in bytes of the decoded compressed blobs kept by trim(), 0 means
+    // there is no limit.
+    inline void setDecodedSizeLimit(size_t limit) noexcept {
+        mDecodedSizeLimit = limit;
+    }
+
+    // Returns the size in bytes of the compressed blobs currently decoded.
+    inline size_t getDecodedSize() const noexcept {
+        return mDecodedSize;
+    }
+
+    // Releases the least recently used decoded blobs until getDecodedSize() is at most the limit
+    // set with setDecodedSizeLimit().
+    void trim() noexcept;
+
 private:
-    std::vector<Blob> mBlobs;
+    struct Entry {
+        Blob blob;
+        const char* compressed = nullptr;
+        size_t compressedSize = 0;
+        uint32_t lastUse = 0;
+    };
+
+    bool decode(Entry& entry) noexcept;
+
+    std::vector<Entry> mBlobs;
+    size_t mDecodedSize = 0;
+    size_t mDecodedSizeLimit = 0;
+    uint32_t mUseCount = 0;
 };
 
 } // namespace filaflat
@@ -24,9 +24,11 @@ namespace filaflat {
 class BlobDictionary;
 
 struct DictionaryReader {
+    // When lazy is true, SPIR-V blobs are added to the dictionary in their compressed form and
+    // are decoded on demand. The container's data must then outlive the dictionary.
     static bool unflatten(ChunkContainer const& container,
             ChunkContainer::Type dictionaryTag,
-            BlobDictionary& dictionary);
+            BlobDictionary& dictionary, bool lazy = false);
 };
 
 } // namespace filaflat
@@ -39,9 +39,12 @@ public:
 
     // call this as many times as needed
     bool getShader(ShaderBuilder& shaderBuilder,
-            BlobDictionary const& dictionary,
+            BlobDictionary& dictionary,
             uint8_t shaderModel, uint8_t variant, uint8_t stage);
 
+    // returns whether the given shader is present, without decoding it
+    bool hasShader(uint8_t shaderModel, uint8_t variant, uint8_t stage) const noexcept;
+
 private:
     ChunkContainer const& mContainer;
     filamat::ChunkType mMaterialTag = filamat::ChunkType::Unknown;
@@ -54,7 +57,7 @@ private:
             uint8_t shaderModel, uint8_t variant, uint8_t stage);
 
     bool getSpirvShader(
-            BlobDictionary const& dictionary, ShaderBuilder& shaderBuilder,
+            BlobDictionary& dictionary, ShaderBuilder& shaderBuilder,
             uint8_t shaderModel, uint8_t variant, uint8_t stage);
 };
 
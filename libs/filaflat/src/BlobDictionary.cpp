@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filaflat/BlobDictionary.h>
+
+#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
+#include <smolv.h>
+#endif
+
+#include <algorithm>
+
+namespace filaflat {
+
+const char* BlobDictionary::getBlob(size_t index, size_t* size) noexcept {
+    Entry& entry = mBlobs[index];
+    if (entry.compressed) {
+        if (entry.blob.empty() && !decode(entry)) {
+            *size = 0;
+            return nullptr;
+        }
+        entry.lastUse = ++mUseCount;
+    }
+    *size = entry.blob.size();
+    return (const char*) entry.blob.data();
+}
+
+bool BlobDictionary::decode(Entry& entry) noexcept {
+#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
+    size_t spirvSize = smolv::GetDecodedBufferSize(entry.compressed, entry.compressedSize);
+    if (spirvSize == 0) {
+        return false;
+    }
+    Blob spirv(spirvSize);
+    if (!smolv::Decode(entry.compressed, entry.compressedSize, spirv.data(), spirvSize)) {
+        return false;
+    }
+    entry.blob = std::move(spirv);
+    mDecodedSize += spirvSize;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BlobDictionary::trim() noexcept {
+    if (mDecodedSizeLimit == 0 || mDecodedSize <= mDecodedSizeLimit) {
+        return;
+    }
+
+    std::vector<Entry*> decoded;
+    for (Entry& entry : mBlobs) {
+        if (entry.compressed && !entry.blob.empty()) {
+            decoded.push_back(&entry);
+        }
+    }
+
+    std::sort(decoded.begin(), decoded.end(), [](Entry const* lhs, Entry const* rhs) {
+        return lhs->lastUse < rhs->lastUse;
+    });
+
+    for (Entry* entry : decoded) {
+        if (mDecodedSize <= mDecodedSizeLimit) {
+            break;
+        }
+        mDecodedSize -= entry->blob.size();
+        Blob().swap(entry->blob);
+    }
+}
+
+} // namespace filaflat
@@ -32,7 +32,7 @@ namespace filaflat {
 
 bool DictionaryReader::unflatten(ChunkContainer const& container,
         ChunkContainer::Type dictionaryTag,
-        BlobDictionary& dictionary) {
+        BlobDictionary& dictionary, bool lazy) {
 
     Unflattener unflattener(
             container.getChunkStart(dictionaryTag),
@@ -60,6 +60,11 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
                 return false;
             }
 
+            if (lazy) {
+                dictionary.addCompressedBlob(compressed, compressedSize);
+                continue;
+            }
+
 #if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
             size_t spirvSize = smolv::GetDecodedBufferSize(compressed, compressedSize);
             if (spirvSize == 0) {
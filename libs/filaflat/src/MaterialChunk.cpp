@@ -136,7 +136,7 @@ bool MaterialChunk::getTextShader(Unflattener unflattener, BlobDictionary const&
 }
 
 
-bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
+bool MaterialChunk::getSpirvShader(BlobDictionary& dictionary,
         ShaderBuilder& shaderBuilder, uint8_t shaderModel, uint8_t variant, uint8_t stage) {
 
     if (mBase == nullptr) {
@@ -152,6 +152,9 @@ bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
     size_t index = pos->second;
     size_t shaderSize;
     const char* shaderContent = dictionary.getBlob(index, &shaderSize);
+    if (shaderContent == nullptr) {
+        return false;
+    }
 
     shaderBuilder.reset();
     shaderBuilder.announce(shaderSize);
@@ -159,8 +162,15 @@ bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
     return true;
 }
 
+bool MaterialChunk::hasShader(uint8_t shaderModel, uint8_t variant, uint8_t stage) const noexcept {
+    if (mBase == nullptr) {
+        return false;
+    }
+    return mOffsets.find(makeKey(shaderModel, variant, stage)) != mOffsets.end();
+}
+
 bool MaterialChunk::getShader(ShaderBuilder& shaderBuilder,
-        BlobDictionary const& dictionary, uint8_t shaderModel, uint8_t variant, uint8_t stage) {
+        BlobDictionary& dictionary, uint8_t shaderModel, uint8_t variant, uint8_t stage) {
     switch (mMaterialTag) {
         case filamat::ChunkType::MaterialGlsl:
         case filamat::ChunkType::MaterialMetal:
@@ -46,6 +46,7 @@ namespace filamat {
 
 struct MaterialInfo;
 class ChunkContainer;
+class MaterialLibrary;
 struct Variant;
 
 class UTILS_PUBLIC MaterialBuilderBase {
@@ -119,6 +120,7 @@ protected:
         .targetLanguage = TargetLanguage::SPIRV
     };
     uint8_t mVariantFilter = 0;
+    utils::bitset<uint64_t, 2> mVariantKeys;
 
     // Keeps track of how many times MaterialBuilder::init() has been called without a call to
     // MaterialBuilder::shutdown(). Internally, glslang does something similar. We keep track for
@@ -476,6 +478,20 @@ public:
     //! Specifies a list of variants that should be filtered out during code generation.
     MaterialBuilder& variantFilter(uint8_t variantFilter) noexcept;
 
+    /**
+     * Restricts code generation to the given variant keys, as returned at runtime by
+     * Material::getUsedVariants(). This is combined with variantFilter() and only applies to
+     * materials in the SURFACE domain. Can be called repeatedly.
+     */
+    MaterialBuilder& variants(const uint8_t* variantKeys, size_t count) noexcept;
+
+    /**
+     * Stores the shaders of this material in the dictionaries of the given library, rather than
+     * in the material itself. The material must then be loaded with the library at runtime.
+     * The library must outlive this builder.
+     */
+    MaterialBuilder& library(MaterialLibrary* library) noexcept;
+
     //! Adds a new preprocessor macro definition to the shader code. Can be called repeatedly.
     MaterialBuilder& shaderDefine(const char* name, const char* value) noexcept;
 
@@ -588,6 +604,8 @@ public:
 
     uint8_t getVariantFilter() const { return mVariantFilter; }
 
+    const utils::CString& getMaterialName() const noexcept { return mMaterialName; }
+
     /// @endcond
 
 private:
@@ -694,6 +712,8 @@ private:
     bool mEnableFramebufferFetch = false;
 
     PreprocessorDefineList mDefines;
+
+    MaterialLibrary* mLibrary = nullptr;
 };
 
 } // namespace filamat
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! \file
+
+#ifndef TNT_FILAMAT_MATERIAL_LIBRARY_H
+#define TNT_FILAMAT_MATERIAL_LIBRARY_H
+
+#include <filamat/Package.h>
+
+#include <utils/compiler.h>
+
+#include <stdint.h>
+
+namespace filamat {
+
+class BlobDictionary;
+class LineDictionary;
+
+/**
+ * A MaterialLibrary holds the shader dictionaries shared by a set of materials. Materials built
+ * with MaterialBuilder::library() don't embed their own dictionaries, which are otherwise mostly
+ * identical from one material to the next, they reference the library's instead.
+ *
+ * A MaterialLibrary must outlive the builders using it, and build() must be called after all
+ * these materials are built. At runtime, the library package must be loaded with
+ * filament::MaterialLibrary and passed to filament::Material::Builder::library().
+ *
+ * MaterialBuilder::build() can be called concurrently on materials sharing a library.
+ */
+class UTILS_PUBLIC MaterialLibrary {
+public:
+    //! Creates a library with a random identifier.
+    MaterialLibrary();
+
+    /**
+     * Creates a library with the given identifier. For reproducible builds, the identifier can
+     * be derived from the library's name and the sources of its materials, it must change when
+     * they do.
+     */
+    explicit MaterialLibrary(uint64_t id);
+
+    ~MaterialLibrary();
+
+    MaterialLibrary(MaterialLibrary const& rhs) = delete;
+    MaterialLibrary& operator=(MaterialLibrary const& rhs) = delete;
+
+    /**
+     * Returns the unique identifier of this library. Materials record it, so that a material
+     * can't be loaded with a different library than the one it was built with.
+     */
+    uint64_t getId() const noexcept;
+
+    /**
+     * Builds the library package, which contains the shared dictionaries.
+     *
+     * @param stripDebugInfo Whether debug information is removed from the SPIR-V shaders.
+     */
+    Package build(bool stripDebugInfo = true) noexcept;
+
+private:
+    friend class MaterialBuilder;
+    struct Impl;
+    Impl* mImpl;
+};
+
+} // namespace filamat
+
+#endif // TNT_FILAMAT_MATERIAL_LIBRARY_H
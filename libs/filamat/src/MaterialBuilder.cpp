@@ -25,6 +25,7 @@
 #include <utils/Panic.h>
 
 #include <private/filament/UniformInterfaceBlock.h>
+#include <private/filament/EngineEnums.h>
 #include <private/filament/SamplerInterfaceBlock.h>
 
 #include <private/filament/SibGenerator.h>
@@ -45,6 +46,7 @@
 #include "eiff/DictionarySpirvChunk.h"
 
 #include "Includes.h"
+#include "MaterialLibraryImpl.h"
 
 #ifndef FILAMAT_LITE
 #include "GLSLPostProcessor.h"
@@ -386,6 +388,20 @@ MaterialBuilder& MaterialBuilder::variantFilter(uint8_t variantFilter) noexcept
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::variants(const uint8_t* variantKeys, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        if (variantKeys[i] < filament::VARIANT_COUNT) {
+            mVariantKeys.set(variantKeys[i]);
+        }
+    }
+    return *this;
+}
+
+MaterialBuilder& MaterialBuilder::library(MaterialLibrary* library) noexcept {
+    mLibrary = library;
+    return *this;
+}
+
 MaterialBuilder& MaterialBuilder::shaderDefine(const char* name, const char* value) noexcept {
     mDefines.emplace_back(name, value);
     return *this;
@@ -607,12 +623,21 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
     std::vector<TextEntry> glslEntries;
     std::vector<SpirvEntry> spirvEntries;
     std::vector<TextEntry> metalEntries;
-    LineDictionary textDictionary;
+    LineDictionary materialTextDictionary;
 #ifndef FILAMAT_LITE
-    BlobDictionary spirvDictionary;
+    BlobDictionary materialSpirvDictionary;
 #endif
     // End: must be protected by lock
 
+    // Materials built with a library use its dictionaries instead of their own, these are also
+    // protected by the library's lock.
+    LineDictionary& textDictionary = mLibrary ?
+            mLibrary->mImpl->textDictionary : materialTextDictionary;
+#ifndef FILAMAT_LITE
+    BlobDictionary& spirvDictionary = mLibrary ?
+            mLibrary->mImpl->spirvDictionary : materialSpirvDictionary;
+#endif
+
     ShaderGenerator sg(
             mProperties, mVariables, mOutputs, mDefines, mMaterialCode.getResolved(),
             mMaterialCode.getLineOffset(), mMaterialVertexCode.getResolved(),
@@ -730,6 +755,10 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
                 // NOTE: Everything below touches shared structures protected by a lock
                 // NOTE: do not execute expensive work from here on!
                 std::unique_lock<utils::Mutex> lock(entriesLock);
+                std::unique_lock<utils::Mutex> libraryLock;
+                if (mLibrary) {
+                    libraryLock = std::unique_lock<utils::Mutex>(mLibrary->mImpl->lock);
+                }
 
                 if (targetApi == TargetApi::OPENGL) {
                     glslEntry.stage = v.stage;
@@ -778,28 +807,44 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
         return false;
     }
 
-    // Emit dictionary chunk (TextDictionaryReader and DictionaryTextChunk)
-    const auto& dictionaryChunk = container.addChild<filamat::DictionaryTextChunk>(
-            std::move(textDictionary), ChunkType::DictionaryText);
+    // Emit dictionary chunk (TextDictionaryReader and DictionaryTextChunk), or a reference to
+    // the library holding the dictionaries.
+    const LineDictionary* dictionary = &textDictionary;
+    if (mLibrary) {
+        std::unique_lock<utils::Mutex> libraryLock(mLibrary->mImpl->lock);
+        if (textDictionary.getLineCount() > UINT16_MAX) {
+            slog.e << "The material library has more than " << UINT16_MAX << " lines."
+                    << io::endl;
+            return false;
+        }
+        container.addSimpleChild<uint64_t>(ChunkType::DictionaryLibrary, mLibrary->getId());
+    } else {
+        const auto& dictionaryChunk = container.addChild<filamat::DictionaryTextChunk>(
+                std::move(textDictionary), ChunkType::DictionaryText);
+        dictionary = &dictionaryChunk.getDictionary();
+    }
 
     // Emit GLSL chunk (MaterialTextChunk).
     if (!glslEntries.empty()) {
         container.addChild<MaterialTextChunk>(std::move(glslEntries),
-                dictionaryChunk.getDictionary(), ChunkType::MaterialGlsl);
+                *dictionary, ChunkType::MaterialGlsl);
     }
 
     // Emit SPIRV chunks (SpirvDictionaryReader and MaterialSpirvChunk).
 #ifndef FILAMAT_LITE
     if (!spirvEntries.empty()) {
-        const bool stripInfo = !mGenerateDebugInfo;
-        container.addChild<filamat::DictionarySpirvChunk>(std::move(spirvDictionary), stripInfo);
+        if (!mLibrary) {
+            const bool stripInfo = !mGenerateDebugInfo;
+            container.addChild<filamat::DictionarySpirvChunk>(std::move(spirvDictionary),
+                    stripInfo);
+        }
         container.addChild<MaterialSpirvChunk>(std::move(spirvEntries));
     }
 
     // Emit Metal chunk (MaterialTextChunk).
     if (!metalEntries.empty()) {
         container.addChild<MaterialTextChunk>(std::move(metalEntries),
-                dictionaryChunk.getDictionary(), ChunkType::MaterialMetal);
+                *dictionary, ChunkType::MaterialMetal);
     }
 #endif
 
@@ -899,7 +944,7 @@ Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
 
     // Generate all shaders and write the shader chunks.
     const auto variants = mMaterialDomain == MaterialDomain::SURFACE ?
-        determineSurfaceVariants(mVariantFilter, isLit(), mShadowMultiplier) :
+        determineSurfaceVariants(mVariantFilter, isLit(), mShadowMultiplier, mVariantKeys) :
         determinePostProcessVariants();
     bool success = generateShaders(jobSystem, variants, container, info);
 
@@ -908,7 +953,12 @@ Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
         return Package::invalidPackage();
     }
 
-    // Flatten all chunks in the container into a Package.
+    // Flatten all chunks in the container into a Package. With a library, the text chunks are
+    // compressed against its dictionary, which other materials may be adding to concurrently.
+    std::unique_lock<utils::Mutex> libraryLock;
+    if (mLibrary) {
+        libraryLock = std::unique_lock<utils::Mutex>(mLibrary->mImpl->lock);
+    }
     Package package(container.getSize());
     Flattener f(package);
     container.flatten(f);
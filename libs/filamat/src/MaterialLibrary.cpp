@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MaterialLibraryImpl.h"
+
+#include <filament/MaterialChunkType.h>
+#include <filament/MaterialEnums.h>
+
+#include "eiff/ChunkContainer.h"
+#include "eiff/DictionaryTextChunk.h"
+#include "eiff/Flattener.h"
+#include "eiff/SimpleFieldChunk.h"
+
+#ifndef FILAMAT_LITE
+#include "eiff/DictionarySpirvChunk.h"
+#endif
+
+#include <mutex>
+#include <random>
+
+namespace filamat {
+
+MaterialLibrary::MaterialLibrary() : mImpl(new Impl) {
+    // The id only needs to be unique, materials built against another library must be rejected.
+    std::random_device rd;
+    mImpl->id = (uint64_t(rd()) << 32u) | rd();
+}
+
+MaterialLibrary::MaterialLibrary(uint64_t id) : mImpl(new Impl) {
+    mImpl->id = id;
+}
+
+MaterialLibrary::~MaterialLibrary() {
+    delete mImpl;
+}
+
+uint64_t MaterialLibrary::getId() const noexcept {
+    return mImpl->id;
+}
+
+Package MaterialLibrary::build(bool stripDebugInfo) noexcept {
+    std::unique_lock<utils::Mutex> lock(mImpl->lock);
+
+    ChunkContainer container;
+    container.addSimpleChild<uint32_t>(ChunkType::MaterialVersion, filament::MATERIAL_VERSION);
+    container.addSimpleChild<uint64_t>(ChunkType::DictionaryLibrary, mImpl->id);
+
+    // The chunks keep a copy of the dictionaries, so that build() can be called again after
+    // more materials are added.
+    LineDictionary textDictionary(mImpl->textDictionary);
+    container.addChild<DictionaryTextChunk>(std::move(textDictionary), ChunkType::DictionaryText);
+
+#ifndef FILAMAT_LITE
+    if (!mImpl->spirvDictionary.isEmpty()) {
+        BlobDictionary spirvDictionary(mImpl->spirvDictionary);
+        container.addChild<DictionarySpirvChunk>(std::move(spirvDictionary), stripDebugInfo);
+    }
+#endif
+
+    Package package(container.getSize());
+    Flattener f(package);
+    container.flatten(f);
+    return package;
+}
+
+} // namespace filamat
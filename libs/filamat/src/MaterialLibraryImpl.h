@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMAT_MATERIAL_LIBRARY_IMPL_H
+#define TNT_FILAMAT_MATERIAL_LIBRARY_IMPL_H
+
+#include <filamat/MaterialLibrary.h>
+
+#include <utils/Mutex.h>
+
+#include "eiff/BlobDictionary.h"
+#include "eiff/LineDictionary.h"
+
+namespace filamat {
+
+struct MaterialLibrary::Impl {
+    // Protects the dictionaries, which are shared by all the materials being built.
+    utils::Mutex lock;
+    LineDictionary textDictionary;
+    BlobDictionary spirvDictionary;
+    uint64_t id = 0;
+};
+
+} // namespace filamat
+
+#endif // TNT_FILAMAT_MATERIAL_LIBRARY_IMPL_H
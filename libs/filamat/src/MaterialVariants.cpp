@@ -21,9 +21,19 @@
 namespace filamat {
 
 std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, bool isLit,
-        bool shadowMultiplier) {
+        bool shadowMultiplier, utils::bitset<uint64_t, 2> const& variantKeys) {
     std::vector<Variant> variants;
     uint8_t variantMask = ~variantFilter;
+
+    // Vertex and fragment shaders are shared between variants, so find the ones the requested
+    // variants need.
+    utils::bitset<uint64_t, 2> vertexKeys;
+    utils::bitset<uint64_t, 2> fragmentKeys;
+    variantKeys.forEachSetBit([&](size_t k) {
+        vertexKeys.set(filament::Variant::filterVariantVertex(uint8_t(k)));
+        fragmentKeys.set(filament::Variant::filterVariantFragment(uint8_t(k)));
+    });
+    const bool allVariants = variantKeys.none();
     for (uint8_t k = 0; k < filament::VARIANT_COUNT; k++) {
         if (filament::Variant::isReserved(k)) {
             continue;
@@ -33,11 +43,11 @@ std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, bool isLit,
         uint8_t v = filament::Variant::filterVariant(
                 k & variantMask, isLit || shadowMultiplier);
 
-        if (filament::Variant::filterVariantVertex(v) == k) {
+        if (filament::Variant::filterVariantVertex(v) == k && (allVariants || vertexKeys[k])) {
             variants.emplace_back(k, filament::backend::ShaderType::VERTEX);
         }
 
-        if (filament::Variant::filterVariantFragment(v) == k) {
+        if (filament::Variant::filterVariantFragment(v) == k && (allVariants || fragmentKeys[k])) {
             variants.emplace_back(k, filament::backend::ShaderType::FRAGMENT);
         }
     }
@@ -21,6 +21,8 @@
 
 #include <backend/DriverEnums.h>
 
+#include <utils/bitset.h>
+
 #include <vector>
 
 namespace filamat {
@@ -34,8 +36,9 @@ struct Variant {
     Stage stage;
 };
 
+// If variantKeys is not empty, only the shaders needed by these variants are kept.
 std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, bool isLit,
-        bool shadowMultiplier);
+        bool shadowMultiplier, utils::bitset<uint64_t, 2> const& variantKeys = {});
 
 std::vector<Variant> determinePostProcessVariants();
 
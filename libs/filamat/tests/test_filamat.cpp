@@ -19,9 +19,19 @@
 #include "sca/ASTHelpers.h"
 #include "shaders/ShaderGenerator.h"
 
+#include "MaterialVariants.h"
+
 #include "MockIncluder.h"
 
 #include <filamat/Enums.h>
+#include <filamat/MaterialLibrary.h>
+
+#include <filaflat/BlobDictionary.h>
+#include <filaflat/ChunkContainer.h>
+#include <filaflat/DictionaryReader.h>
+#include <filaflat/MaterialChunk.h>
+#include <filaflat/ShaderBuilder.h>
+#include <filaflat/Unflattener.h>
 
 #include <utils/JobSystem.h>
 
@@ -729,6 +739,130 @@ TEST_F(MaterialCompiler, Arrays) {
     EXPECT_TRUE(result.isValid());
 }
 
+TEST_F(MaterialCompiler, MaterialLibrary) {
+    filamat::MaterialBuilder standalone;
+    standalone.name("standalone");
+    filamat::Package standalonePackage = standalone.build(*jobSystem);
+    ASSERT_TRUE(standalonePackage.isValid());
+
+    // Materials built with a library don't embed the shared dictionary.
+    filamat::MaterialLibrary library;
+    filamat::MaterialBuilder first;
+    first.name("first").library(&library);
+    filamat::Package firstPackage = first.build(*jobSystem);
+    ASSERT_TRUE(firstPackage.isValid());
+
+    filamat::MaterialBuilder second;
+    second.name("second").shading(filament::Shading::UNLIT).library(&library);
+    filamat::Package secondPackage = second.build(*jobSystem);
+    ASSERT_TRUE(secondPackage.isValid());
+
+    filamat::Package libraryPackage = library.build();
+    ASSERT_TRUE(libraryPackage.isValid());
+
+    EXPECT_LT(firstPackage.getSize(), standalonePackage.getSize());
+}
+
+// Decodes the fragment shader of variant 0 from a material package, using the text dictionary of
+// the given package, which is either the material itself or its library.
+static std::string decodeFragmentShader(filamat::Package const& material,
+        filamat::Package const& dictionaryPackage) {
+    filaflat::ChunkContainer container(material.getData(), material.getSize());
+    filaflat::ChunkContainer dictionaryContainer(
+            dictionaryPackage.getData(), dictionaryPackage.getSize());
+    if (!container.parse() || !dictionaryContainer.parse()) {
+        return {};
+    }
+    filaflat::BlobDictionary dictionary;
+    if (!filaflat::DictionaryReader::unflatten(dictionaryContainer,
+            ChunkType::DictionaryText, dictionary)) {
+        return {};
+    }
+    filaflat::MaterialChunk chunk(container);
+    filaflat::ShaderBuilder shader;
+    if (!chunk.readIndex(ChunkType::MaterialGlsl) || !chunk.getShader(shader, dictionary,
+            uint8_t(ShaderModel::GL_ES_30), 0, ShaderType::FRAGMENT)) {
+        return {};
+    }
+    return std::string((const char*) shader.data());
+}
+
+static uint64_t readLibraryId(filamat::Package const& package) {
+    filaflat::ChunkContainer container(package.getData(), package.getSize());
+    uint64_t id = 0;
+    if (container.parse() && container.hasChunk(ChunkType::DictionaryLibrary)) {
+        filaflat::Unflattener unflattener(
+                container.getChunkStart(ChunkType::DictionaryLibrary),
+                container.getChunkEnd(ChunkType::DictionaryLibrary));
+        unflattener.read(&id);
+    }
+    return id;
+}
+
+TEST_F(MaterialCompiler, MaterialLibraryRoundTrip) {
+    filamat::MaterialBuilder standalone;
+    standalone.name("material").platform(MaterialBuilder::Platform::MOBILE);
+    filamat::Package standalonePackage = standalone.build(*jobSystem);
+    ASSERT_TRUE(standalonePackage.isValid());
+
+    filamat::MaterialLibrary library;
+    filamat::MaterialBuilder shared;
+    shared.name("material").platform(MaterialBuilder::Platform::MOBILE).library(&library);
+    filamat::Package sharedPackage = shared.build(*jobSystem);
+    ASSERT_TRUE(sharedPackage.isValid());
+
+    filamat::Package libraryPackage = library.build();
+    ASSERT_TRUE(libraryPackage.isValid());
+
+    // The material refers to its library, and doesn't embed a dictionary.
+    EXPECT_EQ(readLibraryId(sharedPackage), library.getId());
+    EXPECT_EQ(readLibraryId(libraryPackage), library.getId());
+    filaflat::ChunkContainer container(sharedPackage.getData(), sharedPackage.getSize());
+    ASSERT_TRUE(container.parse());
+    EXPECT_FALSE(container.hasChunk(ChunkType::DictionaryText));
+
+    // The shader decoded with the library is the one the material would embed on its own.
+    const std::string expected = decodeFragmentShader(standalonePackage, standalonePackage);
+    const std::string actual = decodeFragmentShader(sharedPackage, libraryPackage);
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST_F(MaterialCompiler, MaterialLibraryId) {
+    // A library's id is only random if none is given, so that builds can be reproducible.
+    filamat::MaterialLibrary library(0x0123456789abcdefllu);
+    EXPECT_EQ(library.getId(), 0x0123456789abcdefllu);
+
+    filamat::MaterialBuilder builder;
+    builder.name("material").platform(MaterialBuilder::Platform::MOBILE).library(&library);
+    filamat::Package package = builder.build(*jobSystem);
+    ASSERT_TRUE(package.isValid());
+    EXPECT_EQ(readLibraryId(package), 0x0123456789abcdefllu);
+    EXPECT_EQ(readLibraryId(library.build()), 0x0123456789abcdefllu);
+}
+
+TEST(MaterialVariants, VariantKeys) {
+    using filament::Variant;
+    const uint8_t usedKey = Variant::DIRECTIONAL_LIGHTING | Variant::SHADOW_RECEIVER;
+
+    const auto all = filamat::determineSurfaceVariants(0, true, false);
+
+    utils::bitset<uint64_t, 2> keys;
+    keys.set(usedKey);
+    const auto used = filamat::determineSurfaceVariants(0, true, false, keys);
+
+    // only the vertex and fragment shaders of the requested variant are kept
+    EXPECT_LT(used.size(), all.size());
+    ASSERT_EQ(used.size(), 2u);
+    for (const auto& variant : used) {
+        if (variant.stage == ShaderType::VERTEX) {
+            EXPECT_EQ(variant.variant, Variant::filterVariantVertex(usedKey));
+        } else {
+            EXPECT_EQ(variant.variant, Variant::filterVariantFragment(usedKey));
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -42,16 +42,43 @@ public:
      * Applies rotation, translation, and scale to entities that have been targeted by the given
      * animation definition. Uses filament::TransformManager.
      *
+     * The keyframes found for each sampler are remembered to speed up the next lookup, so this
+     * must not be called concurrently on the same Animator.
+     *
      * @param animationIndex Zero-based index for the \c animation of interest.
      * @param time Elapsed time of interest in seconds.
      */
-    void applyAnimation(size_t animationIndex, float time) const;
+    void applyAnimation(size_t animationIndex, float time);
+
+    /**
+     * Blends the nodes targeted by a previous animation, at the given time, with their current
+     * local transforms. This is typically used to cross-fade from one animation to another.
+     *
+     * The translation, rotation and scale of each node are blended separately, before being
+     * composed into its local transform, which is set through filament::TransformManager. The
+     * morph weights of the targeted renderables are blended too, and set through
+     * filament::RenderableManager. The nodes are processed in parallel with the engine's
+     * utils::JobSystem, so this must be called from a thread adopted by it, such as the one that
+     * created the engine.
+     *
+     * To cross-fade skinned models, call applyAnimation() with the current animation, then
+     * applyCrossFade() with the previous one, and finally updateBoneMatrices().
+     *
+     * @param previousAnimIndex Zero-based index of the previous \c animation.
+     * @param previousAnimTime Elapsed time of interest of the previous animation, in seconds.
+     * @param alpha Weight of the current animation, 0 gives the previous animation and 1 the
+     *              current one.
+     */
+    void applyCrossFade(size_t previousAnimIndex, float previousAnimTime, float alpha);
 
     /**
      * Computes root-to-node transforms for all bone nodes, then passes
      * the results into filament::RenderableManager::setBones.
      * Uses filament::TransformManager and filament::RenderableManager.
      *
+     * The skins are processed in parallel with the engine's utils::JobSystem, so this must be
+     * called from a thread adopted by it, such as the one that created the engine.
+     *
      * NOTE: this operation is independent of \c animation.
      */
     void updateBoneMatrices();
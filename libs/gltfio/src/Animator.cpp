@@ -25,6 +25,7 @@
 #include <filament/RenderableManager.h>
 #include <filament/TransformManager.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 
 #include <math/mat4.h>
@@ -33,7 +34,7 @@
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <map>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -44,14 +45,22 @@ using namespace utils;
 
 namespace gltfio {
 
-using TimeValues = std::map<float, size_t>;
+using TimeValues = std::vector<float>;
 using SourceValues = std::vector<float>;
 using BoneVector = std::vector<filament::math::mat4f>;
 
 struct Sampler {
-    TimeValues times;
+    TimeValues times;       // sorted in increasing order, as required by glTF
     SourceValues values;
     enum { LINEAR, STEP, CUBIC } interpolation;
+    size_t cursor = 0;      // keyframe found by the previous lookup, playback is usually monotonic
+};
+
+// The pair of keyframes surrounding a given time, and the interpolant between them.
+struct Keyframe {
+    size_t prevIndex;
+    size_t nextIndex;
+    float t;
 };
 
 struct Channel {
@@ -64,12 +73,36 @@ struct Animation {
     float duration;
     std::string name;
     vector<Sampler> samplers;
-    vector<Channel> channels;
+    vector<Channel> channels;   // sorted by target, so that each node is updated only once
+};
+
+// The joint transforms of a skin, which are shared by all its targets.
+struct SkinBones {
+    const Skin* skin;
+    size_t offset;          // first bone of this skin in AnimatorImpl::skinBones and jointInstances
+};
+
+// A renderable skinned by one of the skins.
+struct SkinTarget {
+    utils::Entity entity;
+    uint32_t skinIndex;     // index in AnimatorImpl::skins
+    size_t offset;          // first bone of this target in AnimatorImpl::targetBones
 };
 
 struct AnimatorImpl {
     vector<Animation> animations;
-    BoneVector boneMatrices;
+    vector<Keyframe> keyframes;
+    vector<TransformManager::Instance> nodes;
+    vector<mat4f> transforms;
+    vector<utils::Entity> crossFadeEntities;
+    vector<mat4f> crossFadeTransforms;
+    vector<utils::Entity> crossFadeMorphEntities;
+    vector<float4> crossFadeMorphWeights;
+    vector<SkinBones> skins;
+    vector<SkinTarget> targets;
+    BoneVector skinBones;
+    BoneVector targetBones;
+    vector<TransformManager::Instance> jointInstances;
     FFilamentAsset* asset = nullptr;
     FFilamentInstance* instance = nullptr;
     RenderableManager* renderableManager;
@@ -77,14 +110,12 @@ struct AnimatorImpl {
 };
 
 static void createSampler(const cgltf_animation_sampler& src, Sampler& dst) {
-    // Copy the time values into a red-black tree.
+    // Copy the time values.
     const cgltf_accessor* timelineAccessor = src.input;
     const uint8_t* timelineBlob = (const uint8_t*) timelineAccessor->buffer_view->buffer->data;
     const float* timelineFloats = (const float*) (timelineBlob + timelineAccessor->offset +
             timelineAccessor->buffer_view->offset);
-    for (size_t i = 0, len = timelineAccessor->count; i < len; ++i) {
-        dst.times[timelineFloats[i]] = i;
-    }
+    dst.times.assign(timelineFloats, timelineFloats + timelineAccessor->count);
 
     // Convert source data to float.
     const cgltf_accessor* valuesAccessor = src.output;
@@ -164,6 +195,20 @@ static bool validateAnimation(const cgltf_animation& anim) {
     return true;
 }
 
+// The bone buffers are allocated up front, so that updateBoneMatrices() never allocates.
+static void addSkins(const SkinVector& srcSkins, AnimatorImpl& dst) {
+    for (const Skin& skin : srcSkins) {
+        const uint32_t skinIndex = uint32_t(dst.skins.size());
+        dst.skins.push_back({ &skin, dst.skinBones.size() });
+        dst.skinBones.resize(dst.skinBones.size() + skin.joints.size());
+        dst.jointInstances.resize(dst.skinBones.size());
+        for (utils::Entity entity : skin.targets) {
+            dst.targets.push_back({ entity, skinIndex, dst.targetBones.size() });
+            dst.targetBones.resize(dst.targetBones.size() + skin.joints.size());
+        }
+    }
+}
+
 static void addChannels(const NodeMap& nodeMap, const cgltf_animation& srcAnim, Animation& dst) {
     cgltf_animation_channel* srcChannels = srcAnim.channels;
     cgltf_animation_sampler* srcSamplers = srcAnim.samplers;
@@ -190,6 +235,10 @@ static void addChannels(const NodeMap& nodeMap, const cgltf_animation& srcAnim,
         setTransformType(srcChannel, dstChannel);
         dst.channels.push_back(dstChannel);
     }
+    std::stable_sort(dst.channels.begin(), dst.channels.end(),
+            [](const Channel& lhs, const Channel& rhs) {
+        return lhs.targetEntity.getId() < rhs.targetEntity.getId();
+    });
 }
 
 Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
@@ -200,6 +249,16 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
     mImpl->renderableManager = &asset->mEngine->getRenderableManager();
     mImpl->transformManager = &asset->mEngine->getTransformManager();
 
+    if (instance) {
+        addSkins(instance->skins, *mImpl);
+    } else if (!asset->isInstanced()) {
+        addSkins(asset->mSkins, *mImpl);
+    } else {
+        for (FFilamentInstance* instance : asset->mInstances) {
+            addSkins(instance->skins, *mImpl);
+        }
+    }
+
     const cgltf_data* srcAsset = asset->mSourceAsset->hierarchy;
     const cgltf_animation* srcAnims = srcAsset->animations;
     for (cgltf_size i = 0, len = srcAsset->animations_count; i < len; ++i) {
@@ -228,7 +287,7 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
             Sampler& dstSampler = dstAnim.samplers[j];
             createSampler(srcSampler, dstSampler);
             if (dstSampler.times.size() > 1) {
-                float maxtime = (--dstSampler.times.end())->first;
+                float maxtime = dstSampler.times.back();
                 dstAnim.duration = std::max(dstAnim.duration, maxtime);
             }
         }
@@ -247,6 +306,7 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
 }
 
 void Animator::addInstance(FFilamentInstance* instance) {
+    addSkins(instance->skins, *mImpl);
     const cgltf_data* srcAsset = mImpl->asset->mSourceAsset->hierarchy;
     const cgltf_animation* srcAnims = srcAsset->animations;
     for (cgltf_size i = 0, len = srcAsset->animations_count; i < len; ++i) {
@@ -264,185 +324,322 @@ size_t Animator::getAnimationCount() const {
     return mImpl->animations.size();
 }
 
-void Animator::applyAnimation(size_t animationIndex, float time) const {
-    const Animation& anim = mImpl->animations[animationIndex];
-    TransformManager* transformManager = mImpl->transformManager;
-    RenderableManager* renderableManager = mImpl->renderableManager;
-    time = fmod(time, anim.duration);
-    for (const auto& channel : anim.channels) {
-        const Sampler* sampler = channel.sourceData;
-        if (sampler->times.size() < 2) {
-            continue;
+// Finds the keyframes surrounding the given time. Playback is usually monotonic, so the keyframes
+// found by the previous lookup, or the ones right after them, are tried before searching.
+static Keyframe findKeyframe(Sampler& sampler, float time) {
+    const TimeValues& times = sampler.times;
+    const size_t last = times.size() - 1;
+    if (time <= times.front()) {
+        return { 0, 0, 0.0f };
+    }
+    if (time >= times.back()) {
+        return { last, last, 0.0f };
+    }
+    size_t i = sampler.cursor;
+    if (i >= last || time < times[i]) {
+        i = std::upper_bound(times.begin(), times.end(), time) - times.begin() - 1;
+    } else {
+        while (time >= times[i + 1]) {
+            if (++i - sampler.cursor > 2) {
+                i = std::upper_bound(times.begin() + i, times.end(), time) - times.begin() - 1;
+                break;
+            }
         }
+    }
+    sampler.cursor = i;
+    const float deltaTime = times[i + 1] - times[i];
+    assert(deltaTime >= 0);
+    const float t = deltaTime > 0 ? (time - times[i]) / deltaTime : 0.0f;
+    return { i, i + 1, sampler.interpolation == Sampler::STEP ? 0.0f : t };
+}
 
-        TransformManager::Instance node = transformManager->getInstance(channel.targetEntity);
-        const TimeValues& times = sampler->times;
-
-        // Find the first keyframe after the given time, or the keyframe that matches it exactly.
-        TimeValues::const_iterator iter = times.lower_bound(time);
-
-        // Compute the interpolant (between 0 and 1) and determine the keyframe pair.
-        float t = 0.0f;
-        size_t nextIndex;
-        size_t prevIndex;
-        if (iter == times.end()) {
-            nextIndex = times.size() - 1;
-            prevIndex = nextIndex;
-        } else if (iter == times.begin()) {
-            nextIndex = 0;
-            prevIndex = 0;
-        } else {
-            TimeValues::const_iterator prev = iter; --prev;
-            nextIndex = iter->second;
-            prevIndex = prev->second;
-            const float nextTime = iter->first;
-            const float prevTime = prev->first;
-            float deltaTime = nextTime - prevTime;
-            assert(deltaTime >= 0);
-            if (deltaTime > 0) {
-                t = (time - prevTime) / deltaTime;
+static void applyChannel(const Channel& channel, const Keyframe& keyframe,
+        RenderableManager* renderableManager,
+        float3& translation, quatf& rotation, float3& scale) {
+    const Sampler* sampler = channel.sourceData;
+    const size_t prevIndex = keyframe.prevIndex;
+    const size_t nextIndex = keyframe.nextIndex;
+    const float t = keyframe.t;
+
+    switch (channel.transformType) {
+
+        case Channel::SCALE: {
+            const float3* srcVec3 = (const float3*) sampler->values.data();
+            if (sampler->interpolation == Sampler::CUBIC) {
+                float3 vert0 = srcVec3[prevIndex * 3 + 1];
+                float3 tang0 = srcVec3[prevIndex * 3 + 2];
+                float3 tang1 = srcVec3[nextIndex * 3];
+                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                scale = cubicSpline(vert0, tang0, vert1, tang1, t);
+            } else {
+                scale = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
             }
+            break;
         }
 
-        // Perform the interpolation. This is a simple but inefficient implementation; Filament
-        // stores transforms as mat4's but glTF animation is based on TRS (translation rotation
-        // scale).
-        mat4f xform = transformManager->getTransform(node);
-        float3 scale;
-        quatf rotation;
-        float3 translation;
-        decomposeMatrix(xform, &translation, &rotation, &scale);
-
-        if (sampler->interpolation == Sampler::STEP) {
-            t = 0.0f;
+        case Channel::TRANSLATION: {
+            const float3* srcVec3 = (const float3*) sampler->values.data();
+            if (sampler->interpolation == Sampler::CUBIC) {
+                float3 vert0 = srcVec3[prevIndex * 3 + 1];
+                float3 tang0 = srcVec3[prevIndex * 3 + 2];
+                float3 tang1 = srcVec3[nextIndex * 3];
+                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                translation = cubicSpline(vert0, tang0, vert1, tang1, t);
+            } else {
+                translation = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+            }
+            break;
         }
 
-        switch (channel.transformType) {
-
-            case Channel::SCALE: {
-                const float3* srcVec3 = (const float3*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                    float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                    float3 tang1 = srcVec3[nextIndex * 3];
-                    float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    scale = cubicSpline(vert0, tang0, vert1, tang1, t);
-                } else {
-                    scale = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
-                }
-                break;
+        case Channel::ROTATION: {
+            const quatf* srcQuat = (const quatf*) sampler->values.data();
+            if (sampler->interpolation == Sampler::CUBIC) {
+                quatf vert0 = srcQuat[prevIndex * 3 + 1];
+                quatf tang0 = srcQuat[prevIndex * 3 + 2];
+                quatf tang1 = srcQuat[nextIndex * 3];
+                quatf vert1 = srcQuat[nextIndex * 3 + 1];
+                rotation = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
+            } else {
+                rotation = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
             }
+            break;
+        }
 
-            case Channel::TRANSLATION: {
-                const float3* srcVec3 = (const float3*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                    float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                    float3 tang1 = srcVec3[nextIndex * 3];
-                    float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    translation = cubicSpline(vert0, tang0, vert1, tang1, t);
-                } else {
-                    translation = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+        case Channel::WEIGHTS: {
+            float4 weights(0, 0, 0, 0);
+            const float* const samplerValues = sampler->values.data();
+            assert(sampler->values.size() % sampler->times.size() == 0);
+            const int valuesPerKeyframe = sampler->values.size() / sampler->times.size();
+
+            if (sampler->interpolation == Sampler::CUBIC) {
+                assert(valuesPerKeyframe % 3 == 0);
+                const int numMorphTargets = valuesPerKeyframe / 3;
+                const float* const inTangents = samplerValues;
+                const float* const splineVerts = samplerValues + numMorphTargets;
+                const float* const outTangents = samplerValues + numMorphTargets * 2;
+
+                const int numComponents = std::min((int) MAX_MORPH_TARGETS, numMorphTargets);
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    float vert0 = splineVerts[comp + prevIndex * valuesPerKeyframe];
+                    float tang0 = outTangents[comp + prevIndex * valuesPerKeyframe];
+                    float tang1 = inTangents[comp + nextIndex * valuesPerKeyframe];
+                    float vert1 = splineVerts[comp + nextIndex * valuesPerKeyframe];
+                    weights[comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
                 }
-                break;
-            }
-
-            case Channel::ROTATION: {
-                const quatf* srcQuat = (const quatf*) sampler->values.data();
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    quatf vert0 = srcQuat[prevIndex * 3 + 1];
-                    quatf tang0 = srcQuat[prevIndex * 3 + 2];
-                    quatf tang1 = srcQuat[nextIndex * 3];
-                    quatf vert1 = srcQuat[nextIndex * 3 + 1];
-                    rotation = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
-                } else {
-                    rotation = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
+            } else {
+                const int numComponents = std::min((int) MAX_MORPH_TARGETS, valuesPerKeyframe);
+                for (int comp = 0; comp < numComponents; ++comp) {
+                    float previous = samplerValues[comp + prevIndex * valuesPerKeyframe];
+                    float current = samplerValues[comp + nextIndex * valuesPerKeyframe];
+                    weights[comp] = (1 - t) * previous + t * current;
                 }
-                break;
             }
 
-            case Channel::WEIGHTS: {
-                float4 weights(0, 0, 0, 0);
-                const float* const samplerValues = sampler->values.data();
-                assert(sampler->values.size() % times.size() == 0);
-                const int valuesPerKeyframe = sampler->values.size() / times.size();
-
-                if (sampler->interpolation == Sampler::CUBIC) {
-                    assert(valuesPerKeyframe % 3 == 0);
-                    const int numMorphTargets = valuesPerKeyframe / 3;
-                    const float* const inTangents = samplerValues;
-                    const float* const splineVerts = samplerValues + numMorphTargets;
-                    const float* const outTangents = samplerValues + numMorphTargets * 2;
-
-                    const int numComponents = std::min((int) MAX_MORPH_TARGETS, numMorphTargets);
-                    for (int comp = 0; comp < numComponents; ++comp) {
-                        float vert0 = splineVerts[comp + prevIndex * valuesPerKeyframe];
-                        float tang0 = outTangents[comp + prevIndex * valuesPerKeyframe];
-                        float tang1 = inTangents[comp + nextIndex * valuesPerKeyframe];
-                        float vert1 = splineVerts[comp + nextIndex * valuesPerKeyframe];
-                        weights[comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
-                    }
-                } else {
-                    const int numComponents = std::min((int) MAX_MORPH_TARGETS, valuesPerKeyframe);
-                    for (int comp = 0; comp < numComponents; ++comp) {
-                        float previous = samplerValues[comp + prevIndex * valuesPerKeyframe];
-                        float current = samplerValues[comp + nextIndex * valuesPerKeyframe];
-                        weights[comp] = (1 - t) * previous + t * current;
-                    }
-                }
+            auto renderable = renderableManager->getInstance(channel.targetEntity);
+            renderableManager->setMorphWeights(renderable, weights);
+            break;
+        }
+    }
+}
 
-                auto renderable = renderableManager->getInstance(channel.targetEntity);
-                renderableManager->setMorphWeights(renderable, weights);
+void Animator::applyAnimation(size_t animationIndex, float time) {
+    Animation& anim = mImpl->animations[animationIndex];
+    TransformManager* transformManager = mImpl->transformManager;
+    RenderableManager* renderableManager = mImpl->renderableManager;
+    time = fmod(time, anim.duration);
+
+    // The keyframes only depend on the sampler, which is shared by the channels of all the
+    // instances, so they're looked up once.
+    auto& keyframes = mImpl->keyframes;
+    keyframes.resize(anim.samplers.size());
+    for (size_t i = 0, c = anim.samplers.size(); i < c; ++i) {
+        Sampler& sampler = anim.samplers[i];
+        if (sampler.times.size() >= 2) {
+            keyframes[i] = findKeyframe(sampler, time);
+        }
+    }
+
+    // The channels are sorted by target, so each node's transform is decomposed and composed
+    // once, whatever the number of channels targeting it. This is a simple but inefficient
+    // implementation; Filament stores transforms as mat4's but glTF animation is based on TRS
+    // (translation rotation scale).
+    auto& nodes = mImpl->nodes;
+    auto& transforms = mImpl->transforms;
+    nodes.clear();
+    transforms.clear();
+    const Sampler* samplers = anim.samplers.data();
+    for (size_t i = 0, c = anim.channels.size(); i < c;) {
+        const utils::Entity targetEntity = anim.channels[i].targetEntity;
+        TransformManager::Instance node = transformManager->getInstance(targetEntity);
+        float3 scale;
+        quatf rotation;
+        float3 translation;
+        if (node) {
+            decomposeMatrix(transformManager->getTransform(node), &translation, &rotation, &scale);
+        }
+        bool transformed = false;
+        for (; i < c && anim.channels[i].targetEntity == targetEntity; ++i) {
+            const Channel& channel = anim.channels[i];
+            if (channel.sourceData->times.size() < 2) {
                 continue;
             }
+            applyChannel(channel, keyframes[channel.sourceData - samplers], renderableManager,
+                    translation, rotation, scale);
+            transformed |= channel.transformType != Channel::WEIGHTS;
+        }
+        if (node && transformed) {
+            nodes.push_back(node);
+            transforms.push_back(composeMatrix(translation, rotation, scale));
         }
+    }
+    transformManager->setTransforms(nodes.data(), transforms.data(), nodes.size());
+}
 
-        xform = composeMatrix(translation, rotation, scale);
-        transformManager->setTransform(node, xform);
+void Animator::applyCrossFade(size_t previousAnimIndex, float previousAnimTime, float alpha) {
+    const Animation& previous = mImpl->animations[previousAnimIndex];
+    TransformManager* transformManager = mImpl->transformManager;
+    RenderableManager* renderableManager = mImpl->renderableManager;
+
+    // Stash the current local transforms and morph weights of the nodes targeted by the previous
+    // animation. Its channels are sorted by target, so each target is visited once.
+    auto& entities = mImpl->crossFadeEntities;
+    auto& stash = mImpl->crossFadeTransforms;
+    auto& morphEntities = mImpl->crossFadeMorphEntities;
+    auto& morphStash = mImpl->crossFadeMorphWeights;
+    entities.clear();
+    stash.clear();
+    morphEntities.clear();
+    morphStash.clear();
+    for (size_t i = 0, c = previous.channels.size(); i < c;) {
+        const utils::Entity targetEntity = previous.channels[i].targetEntity;
+        bool transformed = false;
+        bool morphed = false;
+        for (; i < c && previous.channels[i].targetEntity == targetEntity; ++i) {
+            const bool weights = previous.channels[i].transformType == Channel::WEIGHTS;
+            transformed |= !weights;
+            morphed |= weights;
+        }
+        TransformManager::Instance node = transformManager->getInstance(targetEntity);
+        if (node && transformed) {
+            entities.push_back(targetEntity);
+            stash.push_back(transformManager->getTransform(node));
+        }
+        RenderableManager::Instance renderable = renderableManager->getInstance(targetEntity);
+        if (renderable && morphed) {
+            morphEntities.push_back(targetEntity);
+            morphStash.push_back(renderableManager->getMorphWeights(renderable));
+        }
+    }
+
+    applyAnimation(previousAnimIndex, previousAnimTime);
+
+    // Blend the stashed transforms with the ones of the previous animation, in TRS space. This
+    // runs in parallel since the decompositions dominate for large assets, e.g. crowds.
+    auto& nodes = mImpl->nodes;
+    auto& transforms = mImpl->transforms;
+    nodes.resize(entities.size());
+    transforms.resize(entities.size());
+    auto blend = [&, transformManager, alpha](uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i < e; ++i) {
+            nodes[i] = transformManager->getInstance(entities[i]);
+            float3 currentTranslation, previousTranslation;
+            quatf currentRotation, previousRotation;
+            float3 currentScale, previousScale;
+            decomposeMatrix(stash[i], &currentTranslation, &currentRotation, &currentScale);
+            decomposeMatrix(transformManager->getTransform(nodes[i]),
+                    &previousTranslation, &previousRotation, &previousScale);
+            transforms[i] = composeMatrix(
+                    mix(previousTranslation, currentTranslation, alpha),
+                    slerp(previousRotation, currentRotation, alpha),
+                    mix(previousScale, currentScale, alpha));
+        }
+    };
+    JobSystem& js = mImpl->asset->mEngine->getJobSystem();
+    auto* job = jobs::parallel_for(js, nullptr, 0, uint32_t(entities.size()),
+            std::cref(blend), jobs::CountSplitter<64>());
+    js.runAndWait(job);
+
+    transformManager->setTransforms(nodes.data(), transforms.data(), nodes.size());
+
+    // Blend the stashed morph weights, there are usually few of them.
+    for (size_t i = 0, c = morphEntities.size(); i < c; ++i) {
+        auto renderable = renderableManager->getInstance(morphEntities[i]);
+        const float4 previousWeights = renderableManager->getMorphWeights(renderable);
+        renderableManager->setMorphWeights(renderable, mix(previousWeights, morphStash[i], alpha));
     }
 }
 
 void Animator::updateBoneMatrices() {
-    auto renderableManager = mImpl->renderableManager;
-    auto transformManager = mImpl->transformManager;
-
-    auto update = [=](const SkinVector& skins, BoneVector& boneVector) {
-        for (const auto& skin : skins) {
-            size_t njoints = skin.joints.size();
-            boneVector.resize(njoints);
-            for (const auto& entity : skin.targets) {
-                auto renderable = renderableManager->getInstance(entity);
-                if (!renderable) {
-                    continue;
-                }
-                mat4f inverseGlobalTransform;
-                auto xformable = transformManager->getInstance(entity);
-                if (xformable) {
-                    inverseGlobalTransform = inverse(transformManager->getWorldTransform(xformable));
+    AnimatorImpl& impl = *mImpl;
+    RenderableManager* renderableManager = impl.renderableManager;
+    TransformManager* transformManager = impl.transformManager;
+    JobSystem& js = impl.asset->mEngine->getJobSystem();
+
+    // First compute the transforms of the joints of each skin. They don't depend on the targets,
+    // so they're shared by all of them. The joint instances are cached, and only looked up again
+    // when their component moved, which happens when other components are destroyed.
+    Entity const* const entities = transformManager->getEntities();
+    const size_t componentCount = transformManager->getComponentCount();
+    auto computeSkinBones = [&impl, transformManager, entities, componentCount](
+            uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i < e; ++i) {
+            const SkinBones& skin = impl.skins[i];
+            const auto& joints = skin.skin->joints;
+            const auto& inverseBindMatrices = skin.skin->inverseBindMatrices;
+            mat4f* UTILS_RESTRICT out = impl.skinBones.data() + skin.offset;
+            TransformManager::Instance* UTILS_RESTRICT instances =
+                    impl.jointInstances.data() + skin.offset;
+            for (size_t boneIndex = 0, c = joints.size(); boneIndex < c; ++boneIndex) {
+                TransformManager::Instance& joint = instances[boneIndex];
+                const size_t index = joint.asValue();
+                if (UTILS_UNLIKELY(!index || index > componentCount ||
+                        entities[index - 1] != joints[boneIndex])) {
+                    joint = transformManager->getInstance(joints[boneIndex]);
                 }
+                out[boneIndex] = transformManager->getWorldTransform(joint) *
+                        inverseBindMatrices[boneIndex];
+            }
+        }
+    };
+
+    // Then bring them in the space of each target, and write them directly in the bone
+    // uniforms of its renderable.
+    auto computeTargetBones = [&impl, renderableManager, transformManager](
+            uint32_t first, uint32_t count) {
+        for (uint32_t i = first, e = first + count; i < e; ++i) {
+            const SkinTarget& target = impl.targets[i];
+            auto renderable = renderableManager->getInstance(target.entity);
+            if (!renderable) {
+                continue;
+            }
+            const SkinBones& skin = impl.skins[target.skinIndex];
+            const size_t njoints = skin.skin->joints.size();
+            mat4f const* UTILS_RESTRICT in = impl.skinBones.data() + skin.offset;
+            mat4f* UTILS_RESTRICT out = impl.targetBones.data() + target.offset;
+            auto xformable = transformManager->getInstance(target.entity);
+            if (xformable) {
+                const mat4f& world = transformManager->getWorldTransform(xformable);
+                const mat4f inverseGlobalTransform =
+                        world.isAffine() ? mat4f::affineInverse(world) : inverse(world);
                 for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
-                    const auto& joint = skin.joints[boneIndex];
-                    TransformManager::Instance jointInstance = transformManager->getInstance(joint);
-                    mat4f globalJointTransform = transformManager->getWorldTransform(jointInstance);
-                    boneVector[boneIndex] =
-                            inverseGlobalTransform *
-                            globalJointTransform *
-                            skin.inverseBindMatrices[boneIndex];
+                    out[boneIndex] = inverseGlobalTransform * in[boneIndex];
                 }
-                renderableManager->setBones(renderable, boneVector.data(), boneVector.size());
+            } else {
+                std::copy_n(in, njoints, out);
             }
+            // RenderableManager::setBones() only writes to this renderable's bone uniforms,
+            // so it's safe to call it concurrently for different renderables.
+            renderableManager->setBones(renderable, out, njoints);
         }
     };
 
-    if (mImpl->instance) {
-        update(mImpl->instance->skins, mImpl->boneMatrices);
-    } else if (!mImpl->asset->isInstanced()) {
-        update(mImpl->asset->mSkins, mImpl->boneMatrices);
-    } else {
-        for (FFilamentInstance* instance : mImpl->asset->mInstances) {
-            update(instance->skins, mImpl->boneMatrices);
-        }
-    }
+    auto* skinJob = jobs::parallel_for(js, nullptr, 0, uint32_t(impl.skins.size()),
+            std::cref(computeSkinBones), jobs::CountSplitter<4>());
+    js.runAndWait(skinJob);
+
+    auto* targetJob = jobs::parallel_for(js, nullptr, 0, uint32_t(impl.targets.size()),
+            std::cref(computeTargetBones), jobs::CountSplitter<8>());
+    js.runAndWait(targetJob);
 }
 
 float Animator::getAnimationDuration(size_t animationIndex) const {
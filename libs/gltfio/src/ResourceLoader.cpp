@@ -687,6 +687,10 @@ bool ResourceLoader::Impl::createTextures(bool async) {
 
     JobSystem::Job* parent = js->createJob();
 
+    // Asynchronous decoding goes to the background threads, so it doesn't delay the frames
+    // rendered in the meantime.
+    const uint32_t decodeFlags = async ? JobSystem::BACKGROUND : 0;
+
     // Create a copy of the shared_ptr to the source data to prevent it from being freed during
     // the texture decoding process.
     FFilamentAsset::SourceHandle retainSourceAsset = asset->mSourceAsset;
@@ -700,7 +704,7 @@ bool ResourceLoader::Impl::createTextures(bool async) {
             entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize,
                     &width, &height, &comp, 4);
         });
-        js->run(decode);
+        js->run(decode, decodeFlags);
     }
 
     // Kick off jobs that decode texels from URI strings.
@@ -717,7 +721,7 @@ bool ResourceLoader::Impl::createTextures(bool async) {
                 entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &width,
                         &height, &comp, 4);
             });
-            js->run(decode);
+            js->run(decode, decodeFlags);
             continue;
         }
 
@@ -731,7 +735,7 @@ bool ResourceLoader::Impl::createTextures(bool async) {
                 int width, height, comp;
                 entry->texels = stbi_load(fullpath.c_str(), &width, &height, &comp, 4);
             });
-            js->run(decode);
+            js->run(decode, decodeFlags);
         #endif
     }
 
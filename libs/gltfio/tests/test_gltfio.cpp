@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filament/Engine.h>
+#include <filament/RenderableManager.h>
+#include <filament/TransformManager.h>
+
+#include <gltfio/Animator.h>
+#include <gltfio/AssetLoader.h>
+#include <gltfio/FilamentAsset.h>
+#include <gltfio/MaterialProvider.h>
+#include <gltfio/ResourceLoader.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+using namespace filament;
+using namespace filament::math;
+using namespace gltfio;
+
+// The content of "animation.bin": a triangle with one morph target, and two animations of its
+// node. "A" translates it and sets its morph weight to 1, "B" translates, rotates and scales it
+// and sets its morph weight to 0. Both animations are constant.
+static const struct AnimationData {
+    float positions[9] = { 0, 0, 0,  1, 0, 0,  0, 1, 0 };
+    float morphPositions[9] = { 0, 0, 1,  0, 0, 1,  0, 0, 1 };
+    float times[2] = { 0, 1 };
+    float translationA[6] = { 1, 0, 0,  1, 0, 0 };
+    float weightsA[2] = { 1, 1 };
+    float translationB[6] = { 0, 2, 0,  0, 2, 0 };
+    float rotationB[8] = { 0, 0, float(M_SQRT1_2), float(M_SQRT1_2),
+                           0, 0, float(M_SQRT1_2), float(M_SQRT1_2) };
+    float scaleB[6] = { 2, 2, 2,  2, 2, 2 };
+    float weightsB[2] = { 0, 0 };
+} gAnimationData;
+
+static_assert(offsetof(AnimationData, morphPositions) == 36, "see the accessors below");
+static_assert(offsetof(AnimationData, times) == 72, "see the accessors below");
+static_assert(offsetof(AnimationData, translationA) == 80, "see the accessors below");
+static_assert(offsetof(AnimationData, weightsA) == 104, "see the accessors below");
+static_assert(offsetof(AnimationData, translationB) == 112, "see the accessors below");
+static_assert(offsetof(AnimationData, rotationB) == 136, "see the accessors below");
+static_assert(offsetof(AnimationData, scaleB) == 168, "see the accessors below");
+static_assert(offsetof(AnimationData, weightsB) == 192, "see the accessors below");
+static_assert(sizeof(AnimationData) == 200, "see the buffer below");
+
+static const char* const ANIMATION_GLTF = R"({
+    "asset": { "version": "2.0" },
+    "scene": 0,
+    "scenes": [ { "nodes": [ 0 ] } ],
+    "nodes": [ { "mesh": 0 } ],
+    "meshes": [ {
+        "primitives": [ {
+            "attributes": { "POSITION": 0 },
+            "targets": [ { "POSITION": 1 } ]
+        } ],
+        "weights": [ 0 ]
+    } ],
+    "animations": [ {
+        "name": "A",
+        "samplers": [ { "input": 2, "output": 3 }, { "input": 2, "output": 4 } ],
+        "channels": [
+            { "sampler": 0, "target": { "node": 0, "path": "translation" } },
+            { "sampler": 1, "target": { "node": 0, "path": "weights" } }
+        ]
+    }, {
+        "name": "B",
+        "samplers": [
+            { "input": 2, "output": 5 }, { "input": 2, "output": 6 },
+            { "input": 2, "output": 7 }, { "input": 2, "output": 8 }
+        ],
+        "channels": [
+            { "sampler": 0, "target": { "node": 0, "path": "translation" } },
+            { "sampler": 1, "target": { "node": 0, "path": "rotation" } },
+            { "sampler": 2, "target": { "node": 0, "path": "scale" } },
+            { "sampler": 3, "target": { "node": 0, "path": "weights" } }
+        ]
+    } ],
+    "buffers": [ { "byteLength": 200, "uri": "animation.bin" } ],
+    "bufferViews": [ { "buffer": 0, "byteLength": 200 } ],
+    "accessors": [
+        { "bufferView": 0, "byteOffset": 0, "componentType": 5126, "count": 3, "type": "VEC3",
+          "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] },
+        { "bufferView": 0, "byteOffset": 36, "componentType": 5126, "count": 3, "type": "VEC3",
+          "min": [ 0, 0, 1 ], "max": [ 0, 0, 1 ] },
+        { "bufferView": 0, "byteOffset": 72, "componentType": 5126, "count": 2, "type": "SCALAR",
+          "min": [ 0 ], "max": [ 1 ] },
+        { "bufferView": 0, "byteOffset": 80, "componentType": 5126, "count": 2, "type": "VEC3" },
+        { "bufferView": 0, "byteOffset": 104, "componentType": 5126, "count": 2,
+          "type": "SCALAR" },
+        { "bufferView": 0, "byteOffset": 112, "componentType": 5126, "count": 2, "type": "VEC3" },
+        { "bufferView": 0, "byteOffset": 136, "componentType": 5126, "count": 2, "type": "VEC4" },
+        { "bufferView": 0, "byteOffset": 168, "componentType": 5126, "count": 2, "type": "VEC3" },
+        { "bufferView": 0, "byteOffset": 192, "componentType": 5126, "count": 2,
+          "type": "SCALAR" }
+    ]
+})";
+
+class GltfioTest : public testing::Test {
+protected:
+    void SetUp() override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        materials = createUbershaderLoader(engine);
+        loader = AssetLoader::create({ engine, materials });
+    }
+
+    void TearDown() override {
+        AssetLoader::destroy(&loader);
+        materials->destroyMaterials();
+        delete materials;
+        Engine::destroy(&engine);
+    }
+
+    Engine* engine = nullptr;
+    MaterialProvider* materials = nullptr;
+    AssetLoader* loader = nullptr;
+};
+
+static void expectNear(mat4f const& expected, mat4f const& actual) {
+    for (size_t j = 0; j < 4; j++) {
+        for (size_t i = 0; i < 4; i++) {
+            EXPECT_NEAR(expected[j][i], actual[j][i], 1e-4f) << "column " << j << " row " << i;
+        }
+    }
+}
+
+TEST_F(GltfioTest, CrossFade) {
+    FilamentAsset* asset = loader->createAssetFromJson((uint8_t const*) ANIMATION_GLTF,
+            (uint32_t) strlen(ANIMATION_GLTF));
+    ASSERT_NE(asset, nullptr);
+
+    ResourceLoader resourceLoader({ engine, ".", false, false });
+    resourceLoader.addResourceData("animation.bin",
+            { &gAnimationData, sizeof(gAnimationData), nullptr });
+    ASSERT_TRUE(resourceLoader.loadResources(asset));
+
+    Animator* animator = asset->getAnimator();
+    ASSERT_NE(animator, nullptr);
+    ASSERT_EQ(animator->getAnimationCount(), 2);
+
+    TransformManager& tcm = engine->getTransformManager();
+    RenderableManager& rcm = engine->getRenderableManager();
+    ASSERT_EQ(asset->getEntityCount(), 1);
+    auto node = tcm.getInstance(asset->getEntities()[0]);
+    auto renderable = rcm.getInstance(asset->getEntities()[0]);
+    ASSERT_TRUE(node);
+    ASSERT_TRUE(renderable);
+
+    // alpha is the weight of the current animation, A, the previous one is B. The node is reset
+    // first, so that the rotation and scale of A are the identity.
+    auto crossFade = [&](float alpha) {
+        tcm.setTransform(node, mat4f{});
+        animator->applyAnimation(0, 0.5f);
+        animator->applyCrossFade(1, 0.5f, alpha);
+    };
+
+    crossFade(0.0f);
+    expectNear(mat4f::translation(float3{ 0, 2, 0 }) *
+            mat4f::rotation(float(M_PI_2), float3{ 0, 0, 1 }) *
+            mat4f::scaling(float3{ 2 }), tcm.getTransform(node));
+    EXPECT_EQ(rcm.getMorphWeights(renderable), float4(0, 0, 0, 0));
+
+    crossFade(0.5f);
+    expectNear(mat4f::translation(float3{ 0.5f, 1, 0 }) *
+            mat4f::rotation(float(M_PI_4), float3{ 0, 0, 1 }) *
+            mat4f::scaling(float3{ 1.5f }), tcm.getTransform(node));
+    EXPECT_EQ(rcm.getMorphWeights(renderable), float4(0.5f, 0, 0, 0));
+
+    crossFade(1.0f);
+    expectNear(mat4f::translation(float3{ 1, 0, 0 }), tcm.getTransform(node));
+    EXPECT_EQ(rcm.getMorphWeights(renderable), float4(1, 0, 0, 0));
+
+    loader->destroyAsset(asset);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -80,8 +80,9 @@ bool ShaderExtractor::getShader(ShaderModel shaderModel,
         return false;
     }
 
+    // Only the requested shader needs to be decoded.
     BlobDictionary blobDictionary;
-    if (!DictionaryReader::unflatten(cc, mDictionaryTag, blobDictionary)) {
+    if (!DictionaryReader::unflatten(cc, mDictionaryTag, blobDictionary, true)) {
         return false;
     }
 
@@ -341,6 +341,37 @@ public:
     static constexpr TMat44 scaling(A s) noexcept {
         return TMat44{ TVec4<T>{ s, s, s, 1 }};
     }
+
+    /**
+     * Returns whether this matrix is an affine transform, i.e. whether its last row is
+     * (0, 0, 0, 1).
+     */
+    inline constexpr bool isAffine() const noexcept {
+        return m_value[0][3] == T(0) && m_value[1][3] == T(0) && m_value[2][3] == T(0) &&
+               m_value[3][3] == T(1);
+    }
+
+    /**
+     * Multiplies two affine transforms. This is equivalent to lhs * rhs, but skips the
+     * multiplies by the last row of rhs, i.e. a quarter of them.
+     */
+    static constexpr TMat44 affineMultiply(const TMat44& lhs, const TMat44& rhs) noexcept {
+        TMat44 r;
+        for (size_t col = 0; col < 3; ++col) {
+            r[col] = lhs[0] * rhs[col][0] + lhs[1] * rhs[col][1] + lhs[2] * rhs[col][2];
+        }
+        r[3] = lhs[0] * rhs[3][0] + lhs[1] * rhs[3][1] + lhs[2] * rhs[3][2] + lhs[3];
+        return r;
+    }
+
+    /**
+     * Inverts an affine transform. This is equivalent to, but much cheaper than, inverse(m).
+     */
+    static constexpr TMat44 affineInverse(const TMat44& m) noexcept {
+        const TMat33<T> a = inverse(m.upperLeft());
+        const TVec3<T> t = { m[3][0], m[3][1], m[3][2] };
+        return TMat44(a, -(a * t));
+    }
 };
 
 // ----------------------------------------------------------------------------------------
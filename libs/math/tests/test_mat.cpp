@@ -223,6 +223,30 @@ TEST_F(MatTest, MiscOps) {
     }
 }
 
+TEST_F(MatTest, AffineOps) {
+    const mat4 a = mat4::translation(double3{ 1, 2, 3 }) *
+            mat4::rotation(0.5, double3{ 0, 1, 0 }) * mat4::scaling(double3{ 2, 3, 4 });
+    const mat4 b = mat4::translation(double3{ -4, 5, 6 }) *
+            mat4::rotation(1.5, double3{ 1, 0, 0 });
+    const mat4 p = mat4::perspective(60, 1, 0.1, 100);
+
+    EXPECT_TRUE(a.isAffine());
+    EXPECT_TRUE(b.isAffine());
+    EXPECT_FALSE(p.isAffine());
+
+    const mat4 ab = mat4::affineMultiply(a, b);
+    const mat4 ai = mat4::affineInverse(a);
+    const mat4 aai = mat4::affineMultiply(a, ai);
+    const mat4 identity;
+    for (size_t c = 0; c < 4; c++) {
+        for (size_t r = 0; r < 4; r++) {
+            EXPECT_NEAR((a * b)[c][r], ab[c][r], 1e-12);
+            EXPECT_NEAR(inverse(a)[c][r], ai[c][r], 1e-12);
+            EXPECT_NEAR(identity[c][r], aai[c][r], 1e-12);
+        }
+    }
+}
+
 TEST_F(MatTest, ElementAccess) {
     mat4 m(double4(1, 2, 3, 4), double4(5, 6, 7, 8), double4(9, 10, 11, 12), double4(13, 14, 15, 16));
     for (size_t c=0 ; c<4 ; c++) {
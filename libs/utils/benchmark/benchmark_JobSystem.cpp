@@ -21,6 +21,12 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 using namespace utils;
 
 
@@ -78,7 +84,74 @@ static void BM_JobSystemParallelFor(benchmark::State& state) {
     js.emancipate();
 }
 
+// Background load: each job spins for ~500us then runs its successor, until told to stop.
+struct BackgroundLoad {
+    std::atomic_bool stop = { false };
+    std::atomic_int outstanding = { 0 };
+    uint32_t flags = 0;
+
+    void run(JobSystem& js) {
+        outstanding++;
+        js.run(js.createJob<BackgroundLoad, &BackgroundLoad::spin>(nullptr, this), flags);
+    }
+
+    void spin(JobSystem& js, JobSystem::Job*) {
+        auto const end = std::chrono::steady_clock::now() + std::chrono::microseconds(500);
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        if (!stop) {
+            run(js);
+        }
+        outstanding--;
+    }
+};
+
+// Latency of a frame-like parallel_for while long jobs are running. range(0) selects whether
+// these jobs are run with JobSystem::BACKGROUND (on a dedicated thread) or as regular jobs.
+static void BM_JobSystemLatencyUnderLoad(benchmark::State& state) {
+    const bool background = state.range(0) != 0;
+    JobSystem js(0, 1, 1);
+    js.adopt();
+
+    BackgroundLoad load;
+    load.flags = background ? JobSystem::BACKGROUND : 0;
+    for (size_t i = 0; i < 4; i++) {
+        load.run(js);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(4096);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto const begin = std::chrono::steady_clock::now();
+            auto job = jobs::parallel_for(js, nullptr, 0, 4096,
+                    [](uint32_t start, uint32_t count) { }, jobs::CountSplitter<64>());
+            js.runAndWait(job);
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - begin).count());
+        }
+    }
+
+    load.stop = true;
+    while (load.outstanding) {
+        std::this_thread::yield();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies.empty() ? 0.0 : latencies[size_t(p * double(latencies.size() - 1))];
+    };
+    state.counters["p50_us"] = percentile(0.50);
+    state.counters["p99_us"] = percentile(0.99);
+    state.counters["max_us"] = percentile(1.00);
+    state.SetItemsProcessed((int64_t)state.iterations() * 4096);
+
+    js.emancipate();
+}
+
 
 BENCHMARK(BM_JobSystem);
 BENCHMARK(BM_JobSystemAsChildren4k);
 BENCHMARK(BM_JobSystemParallelFor);
+BENCHMARK(BM_JobSystemLatencyUnderLoad)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
@@ -20,7 +20,10 @@
 #include <assert.h>
 
 #include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -39,9 +42,22 @@
 namespace utils {
 
 class JobSystem {
-    static constexpr size_t MAX_JOB_COUNT = 4096;
-    static_assert(MAX_JOB_COUNT <= 0x7FFE, "MAX_JOB_COUNT must be <= 0x7FFE");
-    using WorkQueue = WorkStealingDequeue<uint16_t, MAX_JOB_COUNT>;
+    // The job pool starts with one segment and grows, one segment at a time, when it runs out
+    // of jobs. Job indices are 16 bits, 0x7FFF is reserved to indicate "no parent".
+    static constexpr size_t JOB_SEGMENT_SIZE = 4096;
+    static constexpr size_t MAX_JOB_SEGMENT_COUNT = 8;
+    static constexpr size_t MAX_JOB_COUNT = JOB_SEGMENT_SIZE * MAX_JOB_SEGMENT_COUNT - 1;
+    static_assert(MAX_JOB_COUNT <= 0x7FFF, "MAX_JOB_COUNT must be <= 0x7FFF");
+
+    // # of free jobs each thread keeps for itself, to avoid contention on the pool
+    static constexpr size_t JOB_CACHE_SIZE = 32;
+
+    // # of jobs each thread records for writeChromeTrace(), older ones are overwritten
+    static constexpr size_t TRACE_EVENT_COUNT = 4096;
+
+    // a full work queue runs its jobs immediately, see run()
+    static constexpr size_t WORK_QUEUE_SIZE = 4096;
+    using WorkQueue = WorkStealingDequeue<uint16_t, WORK_QUEUE_SIZE>;
 
 public:
     class Job;
@@ -70,13 +86,23 @@ public:
         void* storage[JOB_STORAGE_SIZE_WORDS];                  // 48 | 48
         JobFunc function;                                       //  4 |  8
         uint16_t parent;                                        //  2 |  2
-        std::atomic<uint16_t> runningJobCount = { 1 };          //  2 |  2
+        std::atomic<uint16_t> runningJobCount = { 1 };          //  2 |  2 (next free job)
         mutable std::atomic<uint16_t> refCount = { 1 };         //  2 |  2
-                                                                //  6 |  2 (padding)
+        uint16_t index;                                         //  2 |  2 (in the pool)
+                                                                //  4 |  0 (padding)
                                                                 // 64 | 64
     };
 
-    explicit JobSystem(size_t threadCount = 0, size_t adoptableThreadsCount = 1) noexcept;
+    /*
+     * threadCount is the number of threads in the pool, 0 picks a system dependant value.
+     * adoptableThreadsCount is the number of threads that can be adopted with adopt().
+     * backgroundThreadCount is the number of low priority threads dedicated to jobs run with
+     * the BACKGROUND flag. These threads never steal from, nor are stolen from by, the other
+     * threads, so background work can't delay a runAndWait() on the frame path. They're only
+     * started when the first BACKGROUND job is run.
+     */
+    explicit JobSystem(size_t threadCount = 0, size_t adoptableThreadsCount = 1,
+            size_t backgroundThreadCount = 0) noexcept;
 
     ~JobSystem();
 
@@ -218,6 +244,15 @@ public:
     }
 
 
+    /*
+     * Names a job in the traces written by writeChromeTrace(), which otherwise use the
+     * job's function symbol, or its address. This must be called before the job is run, name
+     * is not copied and must outlive the JobSystem, typically it's a string literal.
+     */
+    void setJobName(Job* job, const char* name) noexcept {
+        getJobName(job->index) = name;
+    }
+
     /*
      * Jobs are normally finished automatically, this can be used to cancel a job before it is run.
      *
@@ -250,13 +285,21 @@ public:
      * Add job to this thread's execution queue. It's reference will drop automatically.
      * Current thread must be owned by JobSystem's thread pool. See adopt().
      *
+     * With BACKGROUND, the job is handed to the background threads instead, it's typically
+     * used for long-running work (e.g. texture decoding) that must not compete with the
+     * frame's jobs. Jobs run from a background job stay on the background threads.
+     * BACKGROUND is ignored if the JobSystem has no background threads.
+     *
+     * If this thread's work queue is full, the job is run immediately, on the calling thread,
+     * before run() returns.
+     *
      * The job can't be used after this call.
      */
-    enum runFlags { DONT_SIGNAL = 0x1 };
+    enum runFlags { DONT_SIGNAL = 0x1, BACKGROUND = 0x2 };
     void run(Job*& job, uint32_t flags = 0) noexcept;
     void run(Job*&& job, uint32_t flags = 0) noexcept { // allows run(createJob(...));
         Job* p = job;
-        run(p);
+        run(p, flags);
     }
 
     void signal() noexcept;
@@ -303,7 +346,8 @@ public:
     enum class Priority {
         NORMAL,
         DISPLAY,
-        URGENT_DISPLAY
+        URGENT_DISPLAY,
+        BACKGROUND
     };
 
     static void setThreadPriority(Priority priority) noexcept;
@@ -313,6 +357,66 @@ public:
         return mParallelSplitCount;
     }
 
+    /*
+     * Returns the maximum number of jobs allocated at the same time so far, which can help
+     * sizing the work submitted. This includes the free jobs cached by each thread (at most
+     * a few dozens per thread).
+     * The job pool starts with 4096 jobs and grows as needed, up to 32767 jobs.
+     */
+    size_t getJobCountHighWatermark() const noexcept {
+        return mJobCountHighWatermark.load(std::memory_order_relaxed);
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // Telemetry
+    //
+    // When enabled, each thread records the jobs it runs (name, start and end times), its
+    // attempts at stealing jobs, and the time it spends idle or waiting. The overhead when
+    // disabled is one relaxed atomic load per job.
+
+    struct WorkerStats {
+        uint32_t id;            // index of the thread in the JobSystem
+        uint32_t tid;           // OS thread id, as used by writeChromeTrace()
+        bool background;        // whether this is a background thread
+        uint32_t jobCount;      // # of jobs run
+        uint32_t stealAttempts; // # of attempts at stealing a job from another thread
+        uint32_t steals;        // # of jobs stolen from another thread
+        uint64_t busyTime;      // time spent running jobs, in nanoseconds
+        uint64_t idleTime;      // time spent sleeping because there were no jobs, in nanoseconds
+        uint64_t waitTime;      // time spent sleeping in waitAndRelease(), in nanoseconds
+        float utilization;      // busyTime over the elapsed time, between 0 and 1
+    };
+
+    /*
+     * Enables or disables the telemetry. This can be called at any time, from any thread.
+     */
+    void setTelemetryEnabled(bool enabled) noexcept;
+
+    bool isTelemetryEnabled() const noexcept {
+        return mTelemetryEnabled.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Fills "stats" with the activity of each thread since the previous call, typically this is
+     * called once per frame, e.g. after Renderer::endFrame(). Threads that have not been adopted
+     * yet are skipped.
+     *
+     * This must always be called from the same thread.
+     *
+     * @return the number of WorkerStats written, at most "count".
+     */
+    size_t getWorkerStats(WorkerStats* stats, size_t count) noexcept;
+
+    /*
+     * Writes the jobs recorded since the previous call as Chrome trace-event JSON, which can be
+     * loaded in chrome://tracing or Perfetto. Timestamps are taken from the monotonic clock and
+     * threads are identified with their OS thread ids, so the trace lines up with systrace.
+     * Only the last few thousand jobs of each thread are kept.
+     *
+     * This must always be called from the same thread.
+     */
+    void writeChromeTrace(utils::io::ostream& out) noexcept;
+
 private:
     // this is just to avoid using std::default_random_engine, since we're in a public header.
     class default_random_engine {
@@ -337,49 +441,107 @@ private:
         std::thread thread;
         default_random_engine rndGen;
         uint32_t id;
+        bool background;
+
+        // free jobs owned by this thread, see allocateJob()
+        uint32_t jobCacheCount;
+        uint16_t jobCache[JOB_CACHE_SIZE];
+
+        // telemetry, only written by this thread
+        struct TraceEvent {
+            JobFunc function;
+            const char* name;       // set with setJobName(), or nullptr
+            int64_t begin;          // nanoseconds
+            int64_t end;
+            bool stolen;
+        };
+        std::atomic<uint32_t> tid;
+        std::atomic<uint32_t> jobCount;
+        std::atomic<uint32_t> stealAttempts;
+        std::atomic<uint32_t> steals;
+        std::atomic<uint64_t> busyTime;
+        std::atomic<uint64_t> idleTime;
+        std::atomic<uint64_t> waitTime;
+        std::atomic<uint64_t> eventCount;
+        std::unique_ptr<TraceEvent[]> events;   // TRACE_EVENT_COUNT entries, see writeChromeTrace()
+        uint32_t jobDepth;                      // jobs run by the job running on this thread
+
+        // telemetry, only used by the thread calling getWorkerStats() and writeChromeTrace()
+        WorkerStats previousStats;
+        uint64_t exportedEventCount;
     };
 
     static_assert(sizeof(ThreadState) % CACHELINE_SIZE == 0,
             "ThreadState doesn't align to a cache line");
 
     ThreadState& getState() noexcept;
+    ThreadState* getCurrentState() const noexcept;
+    void setCurrentState(ThreadState* state) noexcept;
 
     void incRef(Job const* job) noexcept;
     void decRef(Job const* job) noexcept;
 
+    Job* getJob(size_t index) const noexcept {
+        assert(index < mJobCount.load(std::memory_order_acquire));
+        // pairs with the release store in addJobSegment()
+        Job* const segment = mJobSegments[index / JOB_SEGMENT_SIZE].load(std::memory_order_acquire);
+        return segment + index % JOB_SEGMENT_SIZE;
+    }
+
+    // the jobs' names are stored after the jobs of their segment
+    const char*& getJobName(size_t index) const noexcept {
+        Job* const segment = mJobSegments[index / JOB_SEGMENT_SIZE].load(std::memory_order_acquire);
+        return reinterpret_cast<const char**>(segment + JOB_SEGMENT_SIZE)[index % JOB_SEGMENT_SIZE];
+    }
+
     Job* allocateJob() noexcept;
+    void freeJob(Job const* job) noexcept;
+    size_t acquireJobs(uint16_t* jobs, size_t count) noexcept;
+    void releaseJobs(uint16_t const* jobs, size_t count) noexcept;
+    size_t popJobs(uint16_t* jobs, size_t count) noexcept;
+    void pushJobs(uint16_t first, Job* last, size_t count) noexcept;
+    size_t growJobPool(uint16_t* jobs, size_t count) noexcept;
+    bool addJobSegment() noexcept;
     JobSystem::ThreadState* getStateToStealFrom(JobSystem::ThreadState& state) noexcept;
     bool hasJobCompleted(Job const* job) noexcept;
 
     void requestExit() noexcept;
     bool exitRequested() const noexcept;
     bool hasActiveJobs() const noexcept;
+    bool hasActiveJobs(ThreadState const& state) const noexcept;
 
     void loop(ThreadState* state) noexcept;
+    void loopBackground(ThreadState* state) noexcept;
     bool execute(JobSystem::ThreadState& state) noexcept;
-    Job* steal(JobSystem::ThreadState& state) noexcept;
+    void runJob(JobSystem::ThreadState& state, Job* job, bool stolen) noexcept;
+    void setCurrentThreadId(ThreadState& state) noexcept;
+    Job* steal(JobSystem::ThreadState& state, bool& stolen) noexcept;
     void finish(Job* job) noexcept;
 
     void put(WorkQueue& workQueue, Job* job) noexcept {
-        size_t index = job - mJobStorageBase;
-        assert(index >= 0 && index < MAX_JOB_COUNT);
+        size_t index = job->index;
+        assert(index < MAX_JOB_COUNT);
         workQueue.push(uint16_t(index + 1));
     }
 
     Job* pop(WorkQueue& workQueue) noexcept {
         size_t index = workQueue.pop();
         assert(index <= MAX_JOB_COUNT);
-        return !index ? nullptr : &mJobStorageBase[index - 1];
+        return !index ? nullptr : getJob(index - 1);
     }
 
     Job* steal(WorkQueue& workQueue) noexcept {
         size_t index = workQueue.steal();
         assert(index <= MAX_JOB_COUNT);
-        return !index ? nullptr : &mJobStorageBase[index - 1];
+        return !index ? nullptr : getJob(index - 1);
     }
 
+    Job* popBackground() noexcept;
+    void startBackgroundThreads() noexcept;
+
     void wait(std::unique_lock<Mutex>& lock) noexcept;
     void wake() noexcept;
+    void wakeBackground() noexcept;
 
     // these have thread contention, keep them together
     utils::Mutex mWaiterLock;
@@ -387,7 +549,23 @@ private:
     uint32_t mWaiterCount = 0;
 
     std::atomic<uint32_t> mActiveJobs = { 0 };
-    utils::Arena<utils::ThreadSafeObjectPoolAllocator<Job>, LockingPolicy::NoLock> mJobPool;
+
+    // background jobs are accounted separately, so they never keep the other threads spinning
+    utils::Mutex mBackgroundLock;
+    utils::Condition mBackgroundCondition;
+    std::deque<Job*> mBackgroundJobs;                   // jobs run with BACKGROUND
+    std::atomic<uint32_t> mActiveBackgroundJobs = { 0 };
+    std::once_flag mBackgroundThreadsStarted;           // threads start with the first job
+
+    // Free jobs form a lock-free list, linked through their runningJobCount. The tag
+    // protects against ABA.
+    struct alignas(8) FreeJobList {
+        uint32_t index;
+        uint32_t tag;
+    };
+    std::atomic<FreeJobList> mFreeJobs = { FreeJobList{ 0xFFFF, 0 } };
+    std::atomic<uint32_t> mFreeJobCount = { 0 };
+    std::atomic<uint32_t> mJobCountHighWatermark = { 0 };
 
     template <typename T>
     using aligned_vector = std::vector<T, utils::STLAlignedAllocator<T>>;
@@ -402,11 +580,19 @@ private:
     aligned_vector<ThreadState> mThreadStates;          // actual data is stored offline
     std::atomic<bool> mExitRequested = { false };       // this one is almost never written
     std::atomic<uint16_t> mAdoptedThreads = { 0 };      // this one is almost never written
-    Job* const mJobStorageBase;                         // Base for conversion to indices
+    std::atomic<Job*> mJobSegments[MAX_JOB_SEGMENT_COUNT] = {}; // only written when growing
+    std::atomic<uint32_t> mJobCount = { 0 };            // # of jobs in the pool's segments
+    uint32_t mJobSegmentCount = 0;                      // protected by mJobPoolLock
+    uint32_t const mSerial;                             // validates getCurrentState()
     uint16_t mThreadCount = 0;                          // total # of threads in the pool
+    uint16_t mBackgroundThreadCount = 0;                // # of threads at the end of mThreadStates
     uint8_t mParallelSplitCount = 0;                    // # of split allowable in parallel_for
     Job* mRootJob = nullptr;
 
+    utils::Mutex mJobPoolLock;      // only taken when the job pool grows
+    utils::Mutex mTelemetryLock;    // only taken by setTelemetryEnabled()
+    std::atomic<bool> mTelemetryEnabled = { false };
+    int64_t mPreviousStatsTime = 0;  // see getWorkerStats()
     utils::SpinLock mThreadMapLock; // this should have very little contention
     tsl::robin_map<std::thread::id, ThreadState *> mThreadMap;
 };
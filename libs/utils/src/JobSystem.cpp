@@ -23,16 +23,34 @@
 
 #include <utils/JobSystem.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <random>
 
 #include <utils/compiler.h>
+#include <utils/CString.h>
 #include <utils/memalign.h>
 #include <utils/Panic.h>
 #include <utils/Systrace.h>
+#include <utils/ThreadLocal.h>
+
+#include <tsl/robin_map.h>
+
+#include <stdio.h>
+#include <stdlib.h>
 
 #if !defined(WIN32)
 #    include <pthread.h>
+#    include <unistd.h>
+#endif
+
+#if !defined(WIN32) && !defined(__EMSCRIPTEN__)
+#    include <cxxabi.h>
+#    include <dlfcn.h>
+#    define HAS_DLADDR 1
+#else
+#    define HAS_DLADDR 0
 #endif
 
 #ifdef ANDROID
@@ -47,9 +65,13 @@
 #    ifndef ANDROID_PRIORITY_NORMAL
 #        define ANDROID_PRIORITY_NORMAL 0 // see include/system/thread_defs.h
 #    endif
+#    ifndef ANDROID_PRIORITY_BACKGROUND
+#        define ANDROID_PRIORITY_BACKGROUND 10 // see include/system/thread_defs.h
+#    endif
 #elif defined(__linux__)
 // There is no glibc wrapper for gettid on linux so we need to syscall it.
 #    include <unistd.h>
+#    include <sys/resource.h>
 #    include <sys/syscall.h>
 #    define gettid() syscall(SYS_gettid)
 #endif
@@ -66,6 +88,31 @@
 
 namespace utils {
 
+namespace {
+// The ThreadState of the calling thread. It's only valid for the JobSystem with the same
+// address and serial, because a JobSystem can be destroyed before its adopted threads are
+// emancipated, and a new one constructed at the same address.
+struct CurrentThreadState {
+    void const* js = nullptr;
+    uint32_t serial = 0;
+    void* state = nullptr;
+};
+static UTILS_DEFINE_TLS(CurrentThreadState) sCurrentThreadState;
+static std::atomic<uint32_t> sJobSystemSerial = { 0 };
+
+// telemetry timestamps, in nanoseconds
+inline int64_t now() noexcept {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// telemetry counters are only written by the thread that owns them
+template<typename T>
+inline void accumulate(std::atomic<T>& counter, T value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+} // anonymous namespace
+
 void JobSystem::setThreadName(const char* name) noexcept {
 #if defined(__linux__)
     pthread_setname_np(pthread_self(), name);
@@ -89,8 +136,17 @@ void JobSystem::setThreadPriority(Priority priority) noexcept {
         case Priority::URGENT_DISPLAY:
             androidPriority = ANDROID_PRIORITY_URGENT_DISPLAY;
             break;
+        case Priority::BACKGROUND:
+            androidPriority = ANDROID_PRIORITY_BACKGROUND;
+            break;
     }
     setpriority(PRIO_PROCESS, 0, androidPriority);
+#elif defined(__linux__)
+    // raising the priority requires privileges, but lowering it doesn't. On linux, the "who"
+    // argument is a thread id.
+    if (priority == Priority::BACKGROUND) {
+        setpriority(PRIO_PROCESS, gettid(), 10);
+    }
 #endif
 }
 
@@ -103,12 +159,16 @@ void JobSystem::setThreadAffinityById(size_t id) noexcept {
 #endif
 }
 
-JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreadsCount) noexcept
-    : mJobPool("JobSystem Job pool", MAX_JOB_COUNT * sizeof(Job)),
-      mJobStorageBase(static_cast<Job *>(mJobPool.getAllocator().getCurrent()))
+JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreadsCount,
+        const size_t backgroundThreadCount) noexcept
+    : mSerial(++sJobSystemSerial)
 {
     SYSTRACE_ENABLE();
 
+    // the first segment is always there
+    UTILS_UNUSED_IN_RELEASE bool const success = addJobSegment();
+    assert(success);
+
     int threadPoolCount = userThreadCount;
     if (threadPoolCount == 0) {
         // default value, system dependant
@@ -126,8 +186,15 @@ JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreads
     }
     threadPoolCount = std::min(UTILS_HAS_THREADING ? 32 : 0, threadPoolCount);
 
-    mThreadStates = aligned_vector<ThreadState>(threadPoolCount + adoptableThreadsCount);
+    // background threads go last, after the adoptable slots, so that the other threads never
+    // pick them when stealing.
+    const size_t backgroundCount =
+            UTILS_HAS_THREADING ? std::min(size_t(8), backgroundThreadCount) : 0;
+
+    mThreadStates = aligned_vector<ThreadState>(
+            threadPoolCount + adoptableThreadsCount + backgroundCount);
     mThreadCount = uint16_t(threadPoolCount);
+    mBackgroundThreadCount = uint16_t(backgroundCount);
     mParallelSplitCount = (uint8_t)std::ceil((std::log2f(threadPoolCount + adoptableThreadsCount)));
 
     // this is a pity these are not compile-time checks (C++17 supports it apparently)
@@ -137,6 +204,7 @@ JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreads
     std::random_device rd;
     const size_t hardwareThreadCount = mThreadCount;
     auto& states = mThreadStates;
+    const size_t firstBackground = states.size() - backgroundCount;
 
     #pragma nounroll
     for (size_t i = 0, n = states.size(); i < n; i++) {
@@ -144,13 +212,23 @@ JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreads
         state.rndGen = default_random_engine(rd());
         state.id = (uint32_t)i;
         state.js = this;
+        state.background = i >= firstBackground;
         if (i < hardwareThreadCount) {
-            // don't start a thread of adoptable thread slots
+            // don't start a thread of adoptable thread slots, background threads are only
+            // started when needed, see startBackgroundThreads().
             state.thread = std::thread(&JobSystem::loop, this, &state);
         }
     }
 }
 
+void JobSystem::startBackgroundThreads() noexcept {
+    auto& states = mThreadStates;
+    #pragma nounroll
+    for (size_t i = states.size() - mBackgroundThreadCount, n = states.size(); i < n; i++) {
+        states[i].thread = std::thread(&JobSystem::loop, this, &states[i]);
+    }
+}
+
 JobSystem::~JobSystem() {
     requestExit();
 
@@ -161,6 +239,10 @@ JobSystem::~JobSystem() {
             state.thread.join();
         }
     }
+
+    for (auto& segment : mJobSegments) {
+        aligned_free(segment.load(std::memory_order_relaxed));
+    }
 }
 
 inline void JobSystem::incRef(Job const* job) noexcept {
@@ -184,7 +266,7 @@ void JobSystem::decRef(Job const* job) noexcept {
     assert(c > 0);
     if (c == 1) {
         // This was the last reference, it's safe to destroy the job.
-        mJobPool.destroy(job);
+        freeJob(job);
     }
 }
 
@@ -192,7 +274,8 @@ void JobSystem::requestExit() noexcept {
     mExitRequested.store(true);
     { std::lock_guard<Mutex> lock(mWaiterLock); }
     mWaiterCondition.notify_all();
-
+    { std::lock_guard<Mutex> lock(mBackgroundLock); }
+    mBackgroundCondition.notify_all();
 }
 
 inline bool JobSystem::exitRequested() const noexcept {
@@ -204,6 +287,11 @@ inline bool JobSystem::hasActiveJobs() const noexcept {
     return mActiveJobs.load(std::memory_order_relaxed) > 0;
 }
 
+inline bool JobSystem::hasActiveJobs(ThreadState const& state) const noexcept {
+    return UTILS_UNLIKELY(state.background) ?
+            mActiveBackgroundJobs.load(std::memory_order_relaxed) > 0 : hasActiveJobs();
+}
+
 inline bool JobSystem::hasJobCompleted(JobSystem::Job const* job) noexcept {
     return job->runningJobCount.load(std::memory_order_relaxed) <= 0;
 }
@@ -222,15 +310,195 @@ void JobSystem::wake() noexcept {
     mWaiterCondition.notify_n(waiterCount);
 }
 
+void JobSystem::wakeBackground() noexcept {
+    // there are only a few background threads, and they're not latency sensitive
+    { std::lock_guard<Mutex> lock(mBackgroundLock); }
+    mBackgroundCondition.notify_all();
+}
+
+JobSystem::Job* JobSystem::popBackground() noexcept {
+    std::lock_guard<Mutex> lock(mBackgroundLock);
+    Job* job = nullptr;
+    if (!mBackgroundJobs.empty()) {
+        job = mBackgroundJobs.front();
+        mBackgroundJobs.pop_front();
+    }
+    return job;
+}
+
+inline JobSystem::ThreadState* JobSystem::getCurrentState() const noexcept {
+    CurrentThreadState const& current = sCurrentThreadState;
+    return UTILS_LIKELY(current.js == this && current.serial == mSerial) ?
+            static_cast<ThreadState*>(current.state) : nullptr;
+}
+
+void JobSystem::setCurrentState(ThreadState* state) noexcept {
+    CurrentThreadState& current = sCurrentThreadState;
+    current = CurrentThreadState{ this, mSerial, state };
+}
+
 inline JobSystem::ThreadState& JobSystem::getState() noexcept {
+    ThreadState* const state = getCurrentState();
+    if (UTILS_LIKELY(state)) {
+        return *state;
+    }
     std::lock_guard<utils::SpinLock> lock(mThreadMapLock);
     auto iter = mThreadMap.find(std::this_thread::get_id());
     ASSERT_PRECONDITION(iter != mThreadMap.end(), "This thread has not been adopted.");
     return *iter->second;
 }
 
+// -----------------------------------------------------------------------------------------------
+// Job pool
+//
+// Jobs are allocated from the calling thread's cache, which is refilled from (or flushed to)
+// the pool's lock-free free list, half a cache at a time. Threads that don't belong to this
+// JobSystem use the free list directly. The pool grows by one segment when the free list is
+// empty, this is the only time a lock is taken.
+
 JobSystem::Job* JobSystem::allocateJob() noexcept {
-    return mJobPool.make<Job>();
+    uint16_t index;
+    ThreadState* const state = getCurrentState();
+    if (UTILS_LIKELY(state)) {
+        if (UTILS_UNLIKELY(!state->jobCacheCount)) {
+            state->jobCacheCount = uint32_t(acquireJobs(state->jobCache, JOB_CACHE_SIZE / 2));
+            if (UTILS_UNLIKELY(!state->jobCacheCount)) {
+                return nullptr;
+            }
+        }
+        index = state->jobCache[--state->jobCacheCount];
+    } else if (UTILS_UNLIKELY(!acquireJobs(&index, 1))) {
+        return nullptr;
+    }
+
+    // the job could be read concurrently by a popJobs() that lost a race, see popJobs()
+    Job* const job = getJob(index);
+    job->runningJobCount.store(1, std::memory_order_relaxed);
+    job->refCount.store(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::freeJob(Job const* job) noexcept {
+    ThreadState* const state = getCurrentState();
+    if (UTILS_LIKELY(state)) {
+        uint16_t* const cache = state->jobCache;
+        if (UTILS_UNLIKELY(state->jobCacheCount == JOB_CACHE_SIZE)) {
+            // give the oldest half back to the pool
+            constexpr size_t half = JOB_CACHE_SIZE / 2;
+            releaseJobs(cache, half);
+            std::copy(cache + half, cache + JOB_CACHE_SIZE, cache);
+            state->jobCacheCount = half;
+        }
+        cache[state->jobCacheCount++] = job->index;
+    } else {
+        releaseJobs(&job->index, 1);
+    }
+}
+
+size_t JobSystem::acquireJobs(uint16_t* jobs, size_t count) noexcept {
+    size_t n = popJobs(jobs, count);
+    if (UTILS_UNLIKELY(!n)) {
+        n = growJobPool(jobs, count);
+    }
+
+    // the jobs not in the free list are in use, or in a thread's cache
+    const uint32_t jobCount = mJobCount.load(std::memory_order_relaxed);
+    const uint32_t freeCount = mFreeJobCount.load(std::memory_order_relaxed);
+    const uint32_t used = jobCount > freeCount ? jobCount - freeCount : 0;
+    uint32_t highWatermark = mJobCountHighWatermark.load(std::memory_order_relaxed);
+    while (used > highWatermark && !mJobCountHighWatermark.compare_exchange_weak(
+            highWatermark, used, std::memory_order_relaxed)) {
+    }
+    return n;
+}
+
+void JobSystem::releaseJobs(uint16_t const* jobs, size_t count) noexcept {
+    if (count) {
+        for (size_t i = 0; i < count - 1; i++) {
+            getJob(jobs[i])->runningJobCount.store(jobs[i + 1], std::memory_order_relaxed);
+        }
+        pushJobs(jobs[0], getJob(jobs[count - 1]), count);
+    }
+}
+
+size_t JobSystem::popJobs(uint16_t* jobs, size_t count) noexcept {
+    size_t n;
+    FreeJobList newHead{};
+    FreeJobList head = mFreeJobs.load();
+    do {
+        // The "next" indices we read here might be application data already, if another thread
+        // raced ahead of us. In that case the tag has changed and compare_exchange_weak fails.
+        n = 0;
+        uint32_t index = head.index;
+        // pairs with the release store in addJobSegment(), the segments below jobCount are
+        // visible and initialized.
+        const uint32_t jobCount = mJobCount.load(std::memory_order_acquire);
+        while (n < count && index < jobCount) {
+            jobs[n++] = uint16_t(index);
+            index = getJob(index)->runningJobCount.load(std::memory_order_relaxed);
+        }
+        newHead = { index, head.tag + 1 };
+    } while (n && !mFreeJobs.compare_exchange_weak(head, newHead));
+    mFreeJobCount.fetch_sub(uint32_t(n), std::memory_order_relaxed);
+    return n;
+}
+
+void JobSystem::pushJobs(uint16_t first, Job* last, size_t count) noexcept {
+    // jobs from first to last are already linked together
+    FreeJobList newHead{};
+    FreeJobList head = mFreeJobs.load();
+    do {
+        last->runningJobCount.store(uint16_t(head.index), std::memory_order_relaxed);
+        newHead = { first, head.tag + 1 };
+    } while (!mFreeJobs.compare_exchange_weak(head, newHead));
+    mFreeJobCount.fetch_add(uint32_t(count), std::memory_order_relaxed);
+}
+
+UTILS_NOINLINE
+size_t JobSystem::growJobPool(uint16_t* jobs, size_t count) noexcept {
+    std::lock_guard<Mutex> lock(mJobPoolLock);
+    // another thread may have grown the pool while we were waiting for the lock
+    size_t n = popJobs(jobs, count);
+    if (!n && addJobSegment()) {
+        n = popJobs(jobs, count);
+    }
+    return n;
+}
+
+bool JobSystem::addJobSegment() noexcept {
+    // called with mJobPoolLock held (or from the constructor)
+    const size_t segmentIndex = mJobSegmentCount;
+    if (UTILS_UNLIKELY(segmentIndex == MAX_JOB_SEGMENT_COUNT)) {
+        return false;
+    }
+
+    // the jobs' names are stored after the jobs, see getJobName()
+    Job* const segment = static_cast<Job*>(aligned_alloc(
+            JOB_SEGMENT_SIZE * (sizeof(Job) + sizeof(const char*)), alignof(Job)));
+    if (UTILS_UNLIKELY(!segment)) {
+        return false;
+    }
+
+    // the last job of the last segment would have the reserved index 0x7FFF
+    const size_t first = segmentIndex * JOB_SEGMENT_SIZE;
+    const size_t count = std::min(JOB_SEGMENT_SIZE, MAX_JOB_COUNT - first);
+    for (size_t i = 0; i < count; i++) {
+        Job* const job = new(&segment[i]) Job();
+        job->index = uint16_t(first + i);
+        job->runningJobCount.store(uint16_t(first + i + 1), std::memory_order_relaxed);
+    }
+
+    // the segment and its jobs must be visible before any thread can see the new job count,
+    // see popJobs() and getJob().
+    mJobSegments[segmentIndex].store(segment, std::memory_order_release);
+    mJobSegmentCount = uint32_t(segmentIndex + 1);
+    mJobCount.store(uint32_t(first + count), std::memory_order_release);
+    pushJobs(uint16_t(first), &segment[count - 1], count);
+
+    if (segmentIndex) {
+        slog.d << "JobSystem: job pool grown to " << first + count << " jobs" << io::endl;
+    }
+    return true;
 }
 
 inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadState& state) noexcept {
@@ -238,7 +506,13 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
     // memory_order_relaxed is okay because we don't take any action that has data dependency
     // on this value (in particular mThreadStates, is always initialized properly).
     uint16_t adopted = mAdoptedThreads.load(std::memory_order_relaxed);
-    uint16_t const threadCount = mThreadCount + adopted;
+    uint16_t first = 0;
+    uint16_t threadCount = mThreadCount + adopted;
+    if (UTILS_UNLIKELY(state.background)) {
+        // background threads only steal from each other
+        first = uint16_t(threadStates.size() - mBackgroundThreadCount);
+        threadCount = mBackgroundThreadCount;
+    }
 
     JobSystem::ThreadState* stateToStealFrom = nullptr;
 
@@ -246,7 +520,7 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
     if (threadCount >= 2) {
         do {
             // this is biased, but frankly, we don't care. it's fast.
-            uint16_t index = uint16_t(state.rndGen() % threadCount);
+            uint16_t index = uint16_t(first + state.rndGen() % threadCount);
             assert(index < threadStates.size());
             stateToStealFrom = &threadStates[index];
             // don't steal from our own queue
@@ -255,17 +529,34 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
     return stateToStealFrom;
 }
 
-JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state) noexcept {
+JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state, bool& stolen) noexcept {
     HEAVY_SYSTRACE_CALL();
     Job* job = nullptr;
+    stolen = false;
+    uint32_t attempts = 0;
     do {
+        if (UTILS_UNLIKELY(state.background)) {
+            // jobs run with BACKGROUND from another thread are not in any work queue
+            job = popBackground();
+            if (job) {
+                break;
+            }
+        }
         ThreadState* const stateToStealFrom = getStateToStealFrom(state);
         if (UTILS_LIKELY(stateToStealFrom)) {
+            attempts++;
             job = steal(stateToStealFrom->workQueue);
+            stolen = job != nullptr;
+            if (UTILS_UNLIKELY(stolen && isTelemetryEnabled())) {
+                accumulate(state.steals, 1u);
+            }
         }
         // nullptr -> nothing to steal in that queue either, if there are active jobs,
         // continue to try stealing one.
-    } while (!job && hasActiveJobs());
+    } while (!job && hasActiveJobs(state));
+    if (UTILS_UNLIKELY(attempts && isTelemetryEnabled())) {
+        accumulate(state.stealAttempts, attempts);
+    }
     return job;
 }
 
@@ -273,33 +564,70 @@ bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
     HEAVY_SYSTRACE_CALL();
 
     Job* job = pop(state.workQueue);
-    if (UTILS_UNLIKELY(job == nullptr)) {
+    bool stolen = false;
+    if (UTILS_UNLIKELY(!job)) {
         // our queue is empty, try to steal a job
-        job = steal(state);
+        job = steal(state, stolen);
     }
 
     if (job) {
+        auto& activeJobsCount = state.background ? mActiveBackgroundJobs : mActiveJobs;
         UTILS_UNUSED_IN_RELEASE
-        uint32_t activeJobs = mActiveJobs.fetch_sub(1, std::memory_order_relaxed);
+        uint32_t activeJobs = activeJobsCount.fetch_sub(1, std::memory_order_relaxed);
         assert(activeJobs); // whoops, we were already at 0
         HEAVY_SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs - 1);
 
-        if (UTILS_LIKELY(job->function)) {
-            HEAVY_SYSTRACE_NAME("job->function");
-            job->function(job->storage, *this, job);
-        }
-        finish(job);
+        runJob(state, job, stolen);
     }
     return job != nullptr;
 }
 
+void JobSystem::runJob(JobSystem::ThreadState& state, Job* job, bool stolen) noexcept {
+    JobFunc const function = job->function;
+    if (UTILS_LIKELY(function)) {
+        HEAVY_SYSTRACE_NAME("job->function");
+        if (UTILS_LIKELY(!mTelemetryEnabled.load(std::memory_order_relaxed))) {
+            function(job->storage, *this, job);
+        } else {
+            // pairs with setTelemetryEnabled(), which publishes the event buffers
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Jobs can run other jobs (e.g. in waitAndRelease()), only the outermost one
+            // counts as busy time, minus the time it spent sleeping.
+            const char* const name = getJobName(job->index);
+            const bool outermost = state.jobDepth++ == 0;
+            const uint64_t waitTime = state.waitTime.load(std::memory_order_relaxed);
+            const int64_t begin = now();
+            function(job->storage, *this, job);
+            const int64_t end = now();
+            state.jobDepth--;
+
+            accumulate(state.jobCount, 1u);
+            if (outermost) {
+                const uint64_t waited = state.waitTime.load(std::memory_order_relaxed) - waitTime;
+                accumulate(state.busyTime, uint64_t(end - begin) - waited);
+            }
+            const uint64_t eventCount = state.eventCount.load(std::memory_order_relaxed);
+            state.events[eventCount % TRACE_EVENT_COUNT] = { function, name, begin, end, stolen };
+            state.eventCount.store(eventCount + 1, std::memory_order_release);
+        }
+    }
+    finish(job);
+}
+
 void JobSystem::loop(ThreadState* state) noexcept {
+    if (UTILS_UNLIKELY(state->background)) {
+        loopBackground(state);
+        return;
+    }
+
     setThreadName("JobSystem::loop");
     setThreadPriority(Priority::DISPLAY);
 
     // set a CPU affinity on each of our JobSystem thread to prevent them from jumping from core
     // to core. On Android, it looks like the affinity needs to be reset from time to time.
     setThreadAffinityById(state->id);
+    setCurrentState(state);
+    setCurrentThreadId(*state);
 
     // record our work queue
     mThreadMapLock.lock();
@@ -310,11 +638,42 @@ void JobSystem::loop(ThreadState* state) noexcept {
     // run our main loop...
     do {
         if (!execute(*state)) {
+            const int64_t begin = isTelemetryEnabled() ? now() : 0;
             std::unique_lock<Mutex> lock(mWaiterLock);
             while (!exitRequested() && !hasActiveJobs()) {
                 wait(lock);
                 setThreadAffinityById(state->id);
             }
+            if (UTILS_UNLIKELY(begin)) {
+                accumulate(state->idleTime, uint64_t(now() - begin));
+            }
+        }
+    } while (!exitRequested());
+}
+
+void JobSystem::loopBackground(ThreadState* state) noexcept {
+    // background threads are not pinned, so the scheduler can move them out of the way of the
+    // frame's threads.
+    setThreadName("JobSystem::bg");
+    setThreadPriority(Priority::BACKGROUND);
+    setCurrentState(state);
+    setCurrentThreadId(*state);
+
+    mThreadMapLock.lock();
+    bool inserted = mThreadMap.emplace(std::this_thread::get_id(), state).second;
+    mThreadMapLock.unlock();
+    ASSERT_PRECONDITION(inserted, "This thread is already in a loop.");
+
+    do {
+        if (!execute(*state)) {
+            const int64_t begin = isTelemetryEnabled() ? now() : 0;
+            std::unique_lock<Mutex> lock(mBackgroundLock);
+            while (!exitRequested() && !hasActiveJobs(*state)) {
+                mBackgroundCondition.wait(lock);
+            }
+            if (UTILS_UNLIKELY(begin)) {
+                accumulate(state->idleTime, uint64_t(now() - begin));
+            }
         }
     } while (!exitRequested());
 }
@@ -326,7 +685,6 @@ void JobSystem::finish(Job* job) noexcept {
     bool notify = false;
 
     // terminate this job and notify its parent
-    Job* const storage = mJobStorageBase;
     do {
         // std::memory_order_release here is needed to synchronize with JobSystem::wait()
         // which needs to "see" all changes that happened before the job terminated.
@@ -335,7 +693,7 @@ void JobSystem::finish(Job* job) noexcept {
         if (runningJobCount == 1) {
             // no more work, destroy this job and notify its parent
             notify = true;
-            Job* const parent = job->parent == 0x7FFF ? nullptr : &storage[job->parent];
+            Job* const parent = job->parent == 0x7FFF ? nullptr : getJob(job->parent);
             decRef(job);
             job = parent;
         } else {
@@ -368,11 +726,12 @@ JobSystem::Job* JobSystem::create(JobSystem::Job* parent, JobFunc func) noexcept
             // can't create a child job of a terminated parent
             assert(parentJobCount > 0);
 
-            index = parent - mJobStorageBase;
+            index = parent->index;
             assert(index < MAX_JOB_COUNT);
         }
         job->function = func;
         job->parent = uint16_t(index);
+        getJobName(job->index) = nullptr;
     }
     return job;
 }
@@ -402,10 +761,32 @@ void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
 
     ThreadState& state(getState());
 
+    if ((flags & BACKGROUND) && !state.background && mBackgroundThreadCount) {
+        std::call_once(mBackgroundThreadsStarted, &JobSystem::startBackgroundThreads, this);
+        // hand the job to the background threads, it's never visible to the other threads.
+        mActiveBackgroundJobs.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<Mutex> lock(mBackgroundLock);
+            mBackgroundJobs.push_back(job);
+        }
+        mBackgroundCondition.notify_one();
+        job = nullptr;
+        return;
+    }
+
+    if (UTILS_UNLIKELY(state.workQueue.getCount() >= WORK_QUEUE_SIZE)) {
+        // There can be more jobs than a work queue can hold, when it's full we run the job
+        // now, which is always allowed.
+        runJob(state, job, false);
+        job = nullptr;
+        return;
+    }
+
     // increase the active job count before we add the job to the queue, because otherwise
     // the job could run and finish before the counter is incremented, which would trigger
     // an assert() in execute(). Either way, it's not "wrong", but the assert() is useful.
-    uint32_t activeJobs = mActiveJobs.fetch_add(1, std::memory_order_relaxed);
+    auto& activeJobsCount = state.background ? mActiveBackgroundJobs : mActiveJobs;
+    uint32_t activeJobs = activeJobsCount.fetch_add(1, std::memory_order_relaxed);
 
     put(state.workQueue, job);
 
@@ -415,7 +796,11 @@ void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
     if (!(flags & DONT_SIGNAL)) {
         // wake-up multiple queues because there could be multiple jobs queued
         // especially if DONT_SIGNAL was used
-        wake();
+        if (UTILS_UNLIKELY(state.background)) {
+            wakeBackground();
+        } else {
+            wake();
+        }
     }
 
     // after run() returns, the job is virtually invalid (it'll die on its own)
@@ -452,8 +837,12 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
             // continue to handle more jobs, as they get added.
 
             std::unique_lock<Mutex> lock(mWaiterLock);
-            if (!hasJobCompleted(job) && !hasActiveJobs() && !exitRequested()) {
+            if (!hasJobCompleted(job) && !hasActiveJobs(state) && !exitRequested()) {
+                const int64_t begin = isTelemetryEnabled() ? now() : 0;
                 wait(lock);
+                if (UTILS_UNLIKELY(begin)) {
+                    accumulate(state.waitTime, uint64_t(now() - begin));
+                }
             }
         }
     } while (!hasJobCompleted(job) && !exitRequested());
@@ -483,6 +872,8 @@ void JobSystem::adopt() {
         ASSERT_PRECONDITION(this == state->js,
                 "Called adopt on a thread owned by another JobSystem (%p), this=%p!",
                 state->js, this);
+        setCurrentState(state);
+        setCurrentThreadId(*state);
         return;
     }
 
@@ -490,7 +881,7 @@ void JobSystem::adopt() {
     uint16_t adopted = mAdoptedThreads.fetch_add(1, std::memory_order_relaxed);
     size_t index = mThreadCount + adopted;
 
-    ASSERT_POSTCONDITION(index < mThreadStates.size(),
+    ASSERT_POSTCONDITION(index < mThreadStates.size() - mBackgroundThreadCount,
             "Too many calls to adopt(). No more adoptable threads!");
 
     // all threads adopted by the JobSystem need to run at the same priority
@@ -502,6 +893,10 @@ void JobSystem::adopt() {
 
     lock.lock();
     mThreadMap[tid] = &mThreadStates[index];
+    lock.unlock();
+
+    setCurrentState(&mThreadStates[index]);
+    setCurrentThreadId(mThreadStates[index]);
 }
 
 void JobSystem::emancipate() {
@@ -512,6 +907,196 @@ void JobSystem::emancipate() {
     ASSERT_PRECONDITION(state, "this thread is not an adopted thread");
     ASSERT_PRECONDITION(state->js == this, "this thread is not adopted by us");
     mThreadMap.erase(iter);
+
+    // give our cached jobs back to the pool, no other thread uses this state
+    releaseJobs(state->jobCache, state->jobCacheCount);
+    state->jobCacheCount = 0;
+    setCurrentState(nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------
+// Telemetry
+
+void JobSystem::setCurrentThreadId(ThreadState& state) noexcept {
+    uint32_t tid = state.id;
+#if defined(__linux__)
+    tid = uint32_t(gettid());
+#elif defined(__APPLE__)
+    uint64_t threadId = 0;
+    pthread_threadid_np(nullptr, &threadId);
+    tid = uint32_t(threadId);
+#endif
+    state.tid.store(tid, std::memory_order_relaxed);
+}
+
+void JobSystem::setTelemetryEnabled(bool enabled) noexcept {
+    std::lock_guard<Mutex> lock(mTelemetryLock);
+    if (enabled) {
+        // the events are published by the store below
+        for (auto& state : mThreadStates) {
+            if (!state.events) {
+                state.events.reset(new ThreadState::TraceEvent[TRACE_EVENT_COUNT]);
+            }
+        }
+    }
+    mTelemetryEnabled.store(enabled, std::memory_order_release);
+}
+
+size_t JobSystem::getWorkerStats(WorkerStats* stats, size_t count) noexcept {
+    const int64_t time = now();
+    const int64_t elapsed = mPreviousStatsTime ? time - mPreviousStatsTime : 0;
+    mPreviousStatsTime = time;
+
+    const size_t adopted = mAdoptedThreads.load(std::memory_order_relaxed);
+    const size_t firstBackground = mThreadStates.size() - mBackgroundThreadCount;
+    size_t n = 0;
+    for (size_t i = 0, c = mThreadStates.size(); i < c; i++) {
+        if (i >= mThreadCount + adopted && i < firstBackground) {
+            // this adoptable slot isn't used
+            continue;
+        }
+        ThreadState& state = mThreadStates[i];
+        WorkerStats current{};
+        current.id = state.id;
+        current.tid = state.tid.load(std::memory_order_relaxed);
+        current.background = state.background;
+        current.jobCount = state.jobCount.load(std::memory_order_relaxed);
+        current.stealAttempts = state.stealAttempts.load(std::memory_order_relaxed);
+        current.steals = state.steals.load(std::memory_order_relaxed);
+        current.busyTime = state.busyTime.load(std::memory_order_relaxed);
+        current.idleTime = state.idleTime.load(std::memory_order_relaxed);
+        current.waitTime = state.waitTime.load(std::memory_order_relaxed);
+
+        // all the threads are updated, even if they don't fit in "stats"
+        WorkerStats const& previous = state.previousStats;
+        if (n < count) {
+            WorkerStats& s = stats[n++];
+            s = current;
+            s.jobCount -= previous.jobCount;
+            s.stealAttempts -= previous.stealAttempts;
+            s.steals -= previous.steals;
+            s.busyTime -= previous.busyTime;
+            s.idleTime -= previous.idleTime;
+            s.waitTime -= previous.waitTime;
+            s.utilization = elapsed > 0 ?
+                    std::min(1.0f, float(double(s.busyTime) / double(elapsed))) : 0.0f;
+        }
+        state.previousStats = current;
+    }
+    return n;
+}
+
+static CString getCallsiteName(void const* function) noexcept {
+#if HAS_DLADDR
+    // this only finds exported symbols, other functions are identified by their address
+    Dl_info info;
+    if (dladdr(function, &info) && info.dli_sname) {
+        int status = 0;
+        char* const demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        CString name(demangled && !status ? demangled : info.dli_sname);
+        free(demangled);
+        return name;
+    }
+#endif
+    char name[32];
+    snprintf(name, sizeof(name), "%p", function);
+    return CString(name);
+}
+
+static void writeJsonString(io::ostream& out, const char* string) noexcept {
+    char escaped[8];
+    out << "\"";
+    for (const char* p = string; *p; p++) {
+        const char c = *p;
+        if (c == '"' || c == '\\') {
+            escaped[0] = '\\';
+            escaped[1] = c;
+            escaped[2] = 0;
+            out << escaped;
+        } else if (uint8_t(c) < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << "\"";
+}
+
+void JobSystem::writeChromeTrace(io::ostream& out) noexcept {
+#if !defined(WIN32)
+    const int pid = int(getpid());
+#else
+    const int pid = 0;
+#endif
+
+    // resolving the callsite of jobs without a name is slow, and there are typically only a
+    // few different ones
+    tsl::robin_map<JobFunc, CString> names;
+
+    std::vector<ThreadState::TraceEvent> events;
+    char buffer[128];
+    bool first = true;
+    out << "{\"traceEvents\":[";
+    for (auto& state : mThreadStates) {
+        if (!state.events) {
+            continue;
+        }
+
+        // The events are read while the thread can be recording new ones, and overwrite the
+        // ones we're reading: only the events still in the buffer after the copy are kept.
+        const uint64_t end = state.eventCount.load(std::memory_order_acquire);
+        const uint64_t oldest = end > TRACE_EVENT_COUNT ? end - TRACE_EVENT_COUNT : 0;
+        uint64_t begin = std::max(state.exportedEventCount, oldest);
+        events.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            events.push_back(state.events[i % TRACE_EVENT_COUNT]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t current = state.eventCount.load(std::memory_order_relaxed);
+        // the thread can be writing the event at index current, which overwrites the one at
+        // current - TRACE_EVENT_COUNT, so the first event we know is intact is the next one.
+        const uint64_t overwritten =
+                current >= TRACE_EVENT_COUNT ? current + 1 - TRACE_EVENT_COUNT : 0;
+        const size_t skip = size_t(std::min(end, std::max(begin, overwritten)) - begin);
+        state.exportedEventCount = end;
+
+        const uint32_t tid = state.tid.load(std::memory_order_relaxed);
+        snprintf(buffer, sizeof(buffer),
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                "\"args\":{\"name\":", first ? "" : ",", pid, tid);
+        out << buffer;
+        snprintf(buffer, sizeof(buffer), "JobSystem #%u%s", state.id,
+                state.background ? " (background)" : "");
+        writeJsonString(out, buffer);
+        out << "}}";
+        first = false;
+
+        for (size_t i = skip, c = events.size(); i < c; i++) {
+            ThreadState::TraceEvent const& event = events[i];
+            const char* name = event.name;
+            if (!name) {
+                auto pos = names.find(event.function);
+                if (pos == names.end()) {
+                    pos = names.emplace(event.function,
+                            getCallsiteName(reinterpret_cast<void const*>(event.function))).first;
+                }
+                name = pos->second.c_str();
+            }
+            out << ",{\"name\":";
+            writeJsonString(out, name);
+            // timestamps are in microseconds
+            snprintf(buffer, sizeof(buffer),
+                    ",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%lld.%03lld,\"dur\":%lld.%03lld,"
+                    "\"pid\":%d,\"tid\":%u,\"args\":{\"stolen\":%s}}",
+                    (long long)(event.begin / 1000), (long long)(event.begin % 1000),
+                    (long long)((event.end - event.begin) / 1000),
+                    (long long)((event.end - event.begin) % 1000),
+                    pid, tid, event.stolen ? "true" : "false");
+            out << buffer;
+        }
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}" << io::endl;
 }
 
 io::ostream& operator<<(io::ostream& out, JobSystem const& js) {
@@ -25,6 +25,7 @@
 #include <array>
 #include <thread>
 #include <utils/Allocator.h>
+#include <utils/sstream.h>
 
 using namespace utils;
 using namespace jobs;
@@ -344,3 +345,119 @@ TEST(JobSystem, JobSystemDelegates) {
 
     js.emancipate();
 }
+
+TEST(JobSystem, JobSystemBackground) {
+    JobSystem js(2, 1, 1);
+    js.adopt();
+
+    // a background job blocks until the frame's jobs are done, which can only happen if the
+    // frame's jobs never wait on it.
+    std::atomic_bool release = { false };
+    std::atomic<std::thread::id> backgroundThread;
+    std::atomic_int children = { 0 };
+    JobSystem::Job* background = jobs::createJob(js, nullptr,
+            [&js, &release, &backgroundThread, &children]() {
+        backgroundThread = std::this_thread::get_id();
+        // jobs run from a background job stay in the background
+        JobSystem::Job* parent = js.createJob();
+        for (int i = 0; i < 16; i++) {
+            js.run(jobs::createJob(js, parent, [&children]() { children++; }));
+        }
+        js.runAndWait(parent);
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    background = js.runAndRetain(background, JobSystem::BACKGROUND);
+
+    std::array<uint32_t, 4096> values{};
+    JobSystem::Job* job = parallel_for(js, nullptr, values.data(), uint32_t(values.size()),
+            [&backgroundThread](uint32_t* v, size_t c) {
+        EXPECT_NE(std::this_thread::get_id(), backgroundThread.load());
+        for (size_t i = 0; i < c; ++i) {
+            v[i] = 1;
+        }
+    }, CountSplitter<16>());
+    js.runAndWait(job);
+    for (uint32_t value : values) {
+        EXPECT_EQ(1u, value);
+    }
+
+    release = true;
+    js.waitAndRelease(background);
+    EXPECT_EQ(16, children.load());
+    EXPECT_NE(std::this_thread::get_id(), backgroundThread.load());
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemGrowJobPool) {
+    JobSystem js;
+    js.adopt();
+
+    // more jobs in flight than the initial pool, and than a work queue, can hold
+    std::atomic_int calls = { 0 };
+    JobSystem::Job* root = js.createJob();
+    for (int i = 0; i < 10000; i++) {
+        JobSystem::Job* job = js.createJob(root, [&calls](JobSystem&, JobSystem::Job*) {
+            calls++;
+        });
+        ASSERT_NE(nullptr, job);
+        js.run(job, JobSystem::DONT_SIGNAL);
+    }
+    js.runAndWait(root);
+
+    EXPECT_EQ(10000, calls.load());
+    EXPECT_GT(js.getJobCountHighWatermark(), 4096u);
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemTelemetry) {
+    JobSystem js;
+    js.adopt();
+    js.setTelemetryEnabled(true);
+
+    JobSystem::WorkerStats stats[64];
+    js.getWorkerStats(stats, 64);
+
+    std::array<uint32_t, 1024> values{};
+    auto job = jobs::parallel_for(js, nullptr, values.data(), uint32_t(values.size()),
+            [](uint32_t* v, size_t c) {
+        for (size_t i = 0; i < c; ++i) {
+            v[i] = 1;
+        }
+    }, CountSplitter<16>());
+    js.runAndWait(job);
+
+    size_t count = js.getWorkerStats(stats, 64);
+    ASSERT_GT(count, 0u);
+    uint32_t jobCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        jobCount += stats[i].jobCount;
+        EXPECT_LE(stats[i].steals, stats[i].stealAttempts);
+        EXPECT_GE(stats[i].utilization, 0.0f);
+        EXPECT_LE(stats[i].utilization, 1.0f);
+    }
+    EXPECT_GT(jobCount, 0u);
+
+    // stats are reset each time they're retrieved
+    count = js.getWorkerStats(stats, 64);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(0u, stats[i].jobCount);
+    }
+
+    JobSystem::Job* named = js.createJob(nullptr, [](JobSystem&, JobSystem::Job*) {});
+    js.setJobName(named, "namedJob");
+    js.runAndWait(named);
+
+    io::sstream trace;
+    js.writeChromeTrace(trace);
+    std::string json(trace.c_str());
+    EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"namedJob\""));
+
+    js.setTelemetryEnabled(false);
+    js.emancipate();
+}
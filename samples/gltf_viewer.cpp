@@ -22,6 +22,7 @@
 #include <filament/ColorGrading.h>
 #include <filament/Engine.h>
 #include <filament/IndexBuffer.h>
+#include <filament/Material.h>
 #include <filament/RenderableManager.h>
 #include <filament/Renderer.h>
 #include <filament/Scene.h>
@@ -114,6 +115,7 @@ struct App {
     std::string messageBoxText;
     std::string settingsFile;
     std::string batchFile;
+    std::string variantProfile;
 
     AutomationSpec* automationSpec = nullptr;
     AutomationEngine* automationEngine = nullptr;
@@ -146,6 +148,8 @@ static void printUsage(char* name) {
         "       Apply the settings in the given JSON file\n\n"
         "   --ubershader, -u\n"
         "       Enable ubershaders (improves load time, adds shader complexity)\n\n"
+        "   --variant-profile=<path>, -p <path>\n"
+        "       On exit, write the material variants used for rendering, for matc\n\n"
         "   --camera=<camera mode>, -c <camera mode>\n"
         "       Set the camera mode: orbit (default) or flight\n"
         "       Flight mode uses the following controls:\n"
@@ -168,7 +172,7 @@ static std::ifstream::pos_type getFileSize(const char* filename) {
 }
 
 static int handleCommandLineArguments(int argc, char* argv[], App* app) {
-    static constexpr const char* OPTSTR = "ha:i:usc:rt:b:e";
+    static constexpr const char* OPTSTR = "ha:i:usc:rt:b:ep:";
     static const struct option OPTIONS[] = {
         { "help",         no_argument,       nullptr, 'h' },
         { "api",          required_argument, nullptr, 'a' },
@@ -180,6 +184,7 @@ static int handleCommandLineArguments(int argc, char* argv[], App* app) {
         { "camera",       required_argument, nullptr, 'c' },
         { "recompute-aabb", no_argument,     nullptr, 'r' },
         { "settings",       required_argument, nullptr, 't' },
+        { "variant-profile", required_argument, nullptr, 'p' },
         { nullptr, 0, nullptr, 0 }
     };
     int opt;
@@ -229,6 +234,9 @@ static int handleCommandLineArguments(int argc, char* argv[], App* app) {
             case 't':
                 app->settingsFile = arg;
                 break;
+            case 'p':
+                app->variantProfile = arg;
+                break;
             case 'b': {
                 app->batchFile = arg;
                 break;
@@ -255,6 +263,26 @@ static bool loadSettings(const char* filename, Settings* out) {
     return readJson(json.data(), contentSize, out);
 }
 
+static void writeVariantProfile(const char* filename, const Material* const* materials,
+        size_t count) {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Unable to write " << filename << std::endl;
+        return;
+    }
+    uint8_t variants[128];
+    for (size_t i = 0; i < count; i++) {
+        size_t variantCount = materials[i]->getUsedVariants(variants, 128);
+        if (variantCount == 0) {
+            continue;
+        }
+        for (size_t j = 0; j < variantCount; j++) {
+            out << (j ? "," : "") << "0x" << std::hex << +variants[j];
+        }
+        out << " " << materials[i]->getName() << std::endl;
+    }
+}
+
 static void createGroundPlane(Engine* engine, Scene* scene, App& app) {
     auto& em = EntityManager::get();
     Material* shadowMaterial = Material::Builder()
@@ -895,6 +923,11 @@ int main(int argc, char** argv) {
         app.automationEngine->terminate();
         app.resourceLoader->asyncCancelLoad();
         app.assetLoader->destroyAsset(app.asset);
+
+        if (!app.variantProfile.empty()) {
+            writeVariantProfile(app.variantProfile.c_str(), app.materials->getMaterials(),
+                    app.materials->getMaterialsCount());
+        }
         app.materials->destroyMaterials();
 
         engine->destroy(app.scene.groundPlane);
@@ -36,6 +36,7 @@ static void usage(char* name) {
             "MATC is a command-line tool to compile material definition.\n"
             "Usages:\n"
             "    MATC [options] <input-file>\n"
+            "    MATC [options] --batch=<batch-file>\n"
             "\n"
             "Supported input formats:\n"
             "    Filament material definition (.mat)\n"
@@ -65,6 +66,25 @@ static void usage(char* name) {
             "       Filter out specified comma-separated variants:\n"
             "           directionalLighting, dynamicLighting, shadowReceiver, skinning, vsm, fog\n"
             "       This variant filter is merged with the filter from the material, if any\n\n"
+            "   --variant-profile=<file>, -P <file>\n"
+            "       Only generate the variants listed for this material in the given profile.\n"
+            "       Each line of a profile lists the variants used by a material at runtime\n"
+            "       (see Material::getUsedVariants()), for instance:\n"
+            "           0x00,0x01,0x05 DefaultMaterial\n"
+            "       Materials not listed in the profile keep all their variants\n\n"
+            "   --batch=<file>, -b <file>\n"
+            "       Compile all the materials listed in the given file concurrently, with the\n"
+            "       options given on the command line. Each line of the file is an input path\n"
+            "       followed by a space and an output path. Empty lines and lines starting\n"
+            "       with # are ignored\n\n"
+            "   --library=<file>, -L <file>\n"
+            "       In batch mode, write the shader dictionaries shared by all the materials to\n"
+            "       the given material library file, instead of in each material. Materials\n"
+            "       must then be loaded with this library (see filament::MaterialLibrary).\n"
+            "       Can't be combined with --cache\n\n"
+            "   --cache=<dir>, -c <dir>\n"
+            "       Reuse the materials compiled previously with the same source, includes and\n"
+            "       options from the given directory, and store the newly compiled ones there\n\n"
             "   --version, -v\n"
             "       Print the material version number\n\n"
             "Internal use and debugging only:\n"
@@ -153,7 +173,7 @@ static void parseDefine(std::string defineString,
 }
 
 bool CommandlineConfig::parse() {
-    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:D:OSEr:vV:gtw";
+    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:D:OSEr:vV:P:b:c:L:gtw";
     static const struct option OPTIONS[] = {
             { "help",                    no_argument, nullptr, 'h' },
             { "license",                 no_argument, nullptr, 'l' },
@@ -161,6 +181,10 @@ bool CommandlineConfig::parse() {
             { "output-format",     required_argument, nullptr, 'f' },
             { "debug",                   no_argument, nullptr, 'd' },
             { "variant-filter",    required_argument, nullptr, 'V' },
+            { "variant-profile",   required_argument, nullptr, 'P' },
+            { "batch",             required_argument, nullptr, 'b' },
+            { "cache",             required_argument, nullptr, 'c' },
+            { "library",           required_argument, nullptr, 'L' },
             { "platform",          required_argument, nullptr, 'p' },
             { "optimize",                no_argument, nullptr, 'x' }, // for backward compatibility
             { "optimize",                no_argument, nullptr, 'O' }, // for backward compatibility
@@ -248,6 +272,18 @@ bool CommandlineConfig::parse() {
             case 'V':
                 mVariantFilter = parseVariantFilter(arg);
                 break;
+            case 'P':
+                mVariantProfile = arg;
+                break;
+            case 'b':
+                mBatchFile = arg;
+                break;
+            case 'c':
+                mCacheDirectory = arg;
+                break;
+            case 'L':
+                mLibraryFile = arg;
+                break;
             // These 2 flags are supported for backward compatibility
             case 'O':
             case 'x':
@@ -278,6 +314,11 @@ bool CommandlineConfig::parse() {
         std::cerr << "Only one input file should be specified on the command line." << std::endl;
         return false;
     }
+    if (mArgc - optind > 0 && !mBatchFile.empty()) {
+        std::cerr << "No input file should be specified on the command line in batch mode."
+                << std::endl;
+        return false;
+    }
     if (mArgc - optind > 0) {
         mInput = new FilesystemInput(mArgv[optind]);
     }
@@ -25,6 +25,7 @@
 #include <memory>
 #include <unordered_map>
 #include <ostream>
+#include <string>
 
 #include <utils/compiler.h>
 
@@ -114,10 +115,26 @@ public:
         return mVariantFilter;
     }
 
+    const std::string& getVariantProfile() const noexcept {
+        return mVariantProfile;
+    }
+
     const std::unordered_map<std::string, std::string>& getDefines() const noexcept {
         return mDefines;
     }
 
+    const std::string& getBatchFile() const noexcept {
+        return mBatchFile;
+    }
+
+    const std::string& getCacheDirectory() const noexcept {
+        return mCacheDirectory;
+    }
+
+    const std::string& getLibraryFile() const noexcept {
+        return mLibraryFile;
+    }
+
 protected:
     bool mDebug = false;
     bool mIsValid = true;
@@ -130,6 +147,10 @@ protected:
     TargetApi mTargetApi = (TargetApi) 0;
     std::unordered_map<std::string, std::string> mDefines;
     uint8_t mVariantFilter = 0;
+    std::string mVariantProfile;
+    std::string mBatchFile;
+    std::string mCacheDirectory;
+    std::string mLibraryFile;
 };
 
 }
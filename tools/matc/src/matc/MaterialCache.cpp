@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MaterialCache.h"
+
+#include <filament/MaterialEnums.h>
+
+#include <utils/Path.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace filamat;
+
+namespace matc {
+
+static bool readFile(const std::string& path, std::string& contents) noexcept {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// The code generated for a material can change without a MATERIAL_VERSION bump, so the key also
+// depends on the matc executable itself. It's only read once per process.
+static uint64_t getCompilerHash() noexcept {
+    static const uint64_t compilerHash = []() {
+        const uint32_t version = filament::MATERIAL_VERSION;
+        uint64_t h = MaterialCache::hash(&version, sizeof(version));
+        std::string executable;
+        if (readFile(utils::Path::getCurrentExecutable().getPath(), executable)) {
+            h = MaterialCache::hash(executable.data(), executable.size(), h);
+        }
+        return h;
+    }();
+    return compilerHash;
+}
+
+MaterialCache::MaterialCache(std::string directory) noexcept : mDirectory(std::move(directory)) {
+    utils::Path(mDirectory).mkdirRecursive();
+}
+
+uint64_t MaterialCache::hash(const void* data, size_t size, uint64_t seed) noexcept {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3llu;
+    }
+    return h;
+}
+
+uint64_t MaterialCache::computeKey(const char* source, size_t size,
+        const std::string& includeDirectory, const Config& config) noexcept {
+    uint64_t key = hash(source, size);
+    key = hash(includeDirectory.c_str(), includeDirectory.size() + 1, key);
+
+    const uint64_t compiler = getCompilerHash();
+    const uint32_t options[] = {
+            uint32_t(config.getPlatform()),
+            uint32_t(config.getTargetApi()),
+            uint32_t(config.getOptimizationLevel()),
+            uint32_t(config.isDebug()),
+            uint32_t(config.getVariantFilter()),
+    };
+    key = hash(&compiler, sizeof(compiler), key);
+    key = hash(options, sizeof(options), key);
+
+    // The iteration order of the defines is unspecified, sort them first.
+    std::vector<std::pair<std::string, std::string>> defines(
+            config.getDefines().begin(), config.getDefines().end());
+    std::sort(defines.begin(), defines.end());
+    for (auto const& define : defines) {
+        key = hash(define.first.c_str(), define.first.size() + 1, key);
+        key = hash(define.second.c_str(), define.second.size() + 1, key);
+    }
+
+    // The variant profile is hashed as a whole, it's typically shared by all materials.
+    std::string profile;
+    if (!config.getVariantProfile().empty() && readFile(config.getVariantProfile(), profile)) {
+        key = hash(profile.data(), profile.size(), key);
+    }
+    return key;
+}
+
+std::string MaterialCache::getPath(uint64_t key, const char* extension) const noexcept {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.%s", (unsigned long long) key, extension);
+    return utils::Path::concat(mDirectory, name);
+}
+
+Package MaterialCache::load(uint64_t key) const noexcept {
+    std::ifstream includes(getPath(key, "includes"));
+    if (!includes) {
+        return Package::invalidPackage();
+    }
+
+    std::string line;
+    std::string contents;
+    while (std::getline(includes, line)) {
+        const size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            return Package::invalidPackage();
+        }
+        const uint64_t h = strtoull(line.c_str(), nullptr, 16);
+        if (!readFile(line.substr(space + 1), contents) ||
+                hash(contents.data(), contents.size()) != h) {
+            return Package::invalidPackage();
+        }
+    }
+
+    std::string blob;
+    if (!readFile(getPath(key, "filamat"), blob) || blob.empty()) {
+        return Package::invalidPackage();
+    }
+    return Package(blob.data(), blob.size());
+}
+
+bool MaterialCache::store(uint64_t key, const Package& package,
+        std::vector<Include> const& includes) const noexcept {
+    // Entries are written to a temporary file first and then renamed, so that a concurrent or
+    // interrupted matc never sees a partial entry. The list of includes goes last since it's
+    // what validates the package: a stale list never matches the current include files.
+    // Each writer gets its own temporary file, since several threads or matc processes can store
+    // the same key at the same time.
+    auto write = [this, key](const char* extension, const void* data, size_t size) {
+        static const uint32_t sProcessNonce = std::random_device{}();
+        static std::atomic<uint32_t> sWriteCount{ 0 };
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%08x-%u.tmp", sProcessNonce, sWriteCount++);
+        const std::string path = getPath(key, extension);
+        const std::string temp = path + suffix;
+        std::ofstream out(temp, std::ios::binary);
+        out.write(static_cast<const char*>(data), size);
+        out.close();
+        if (out.fail() || rename(temp.c_str(), path.c_str()) != 0) {
+            remove(temp.c_str());
+            return false;
+        }
+        return true;
+    };
+
+    std::stringstream list;
+    for (auto const& include : includes) {
+        char h[32];
+        snprintf(h, sizeof(h), "%016llx", (unsigned long long) include.second);
+        list << h << ' ' << include.first << '\n';
+    }
+    const std::string text = list.str();
+
+    return write("filamat", package.getData(), package.getSize()) &&
+            write("includes", text.data(), text.size());
+}
+
+} // namespace matc
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_MATERIALCACHE_H
+#define TNT_MATERIALCACHE_H
+
+#include <filamat/Package.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Config.h"
+
+namespace matc {
+
+// A directory of compiled materials, indexed by a hash of everything that affects the output of
+// matc: the material source, the directory its includes are resolved from, the command line
+// options, the material version and the matc executable itself. Each entry also records the
+// files included by the material and the hash of their contents, an entry is only valid if none
+// of them changed.
+//
+// For a key K, the cache directory contains K.filamat (the package) and K.includes (one
+// "<hash> <path>" line per included file).
+class MaterialCache {
+public:
+    // A file included by a material, and the hash of its contents.
+    using Include = std::pair<std::string, uint64_t>;
+
+    explicit MaterialCache(std::string directory) noexcept;
+
+    // 64-bit FNV-1a hash, "seed" allows to chain calls.
+    static uint64_t hash(const void* data, size_t size,
+            uint64_t seed = 0xcbf29ce484222325llu) noexcept;
+
+    // Computes the key of a material from its source, its include directory and the options
+    // it's compiled with. Identical sources in two directories may include different files, so
+    // they get different keys.
+    static uint64_t computeKey(const char* source, size_t size,
+            const std::string& includeDirectory, const Config& config) noexcept;
+
+    // Returns the package stored for this key, or an invalid package if there is none or if one
+    // of the files it includes has changed.
+    filamat::Package load(uint64_t key) const noexcept;
+
+    // Stores a package and the list of files it includes. Returns false on I/O error.
+    bool store(uint64_t key, const filamat::Package& package,
+            std::vector<Include> const& includes) const noexcept;
+
+private:
+    std::string getPath(uint64_t key, const char* extension) const noexcept;
+
+    std::string mDirectory;
+};
+
+} // namespace matc
+
+#endif // TNT_MATERIALCACHE_H
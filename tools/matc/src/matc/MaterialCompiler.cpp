@@ -16,16 +16,24 @@
 
 #include "MaterialCompiler.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
 #include <memory>
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 #include <filamat/MaterialBuilder.h>
+#include <filamat/MaterialLibrary.h>
 
 #include <filamat/Enums.h>
 
 #include <utils/JobSystem.h>
 
 #include "DirIncluder.h"
+#include "MaterialCache.h"
 #include "MaterialLexeme.h"
 #include "MaterialLexer.h"
 #include "JsonishLexer.h"
@@ -255,7 +263,77 @@ bool MaterialCompiler::isValidJsonStart(const char* buffer, size_t size) const n
     return c == 'n' && (end - buffer) > 3 && strncmp(buffer, "null", 5) != 0;
 }
 
+// Finds the variants used by the given material in a variant profile. Each line of the profile
+// is a comma-separated list of hexadecimal variant keys, followed by a space and the name of the
+// material. Returns false if the profile can't be read or contains an invalid key.
+static bool readVariantProfile(const std::string& path, const char* materialName,
+        std::vector<uint8_t>& variants) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Unable to open variant profile " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const size_t space = line.find(' ');
+        if (space == std::string::npos || line.compare(space + 1, std::string::npos,
+                materialName) != 0) {
+            continue;
+        }
+        std::stringstream ss(line.substr(0, space));
+        std::string key;
+        while (std::getline(ss, key, ',')) {
+            char* end = nullptr;
+            errno = 0;
+            const unsigned long variant = strtoul(key.c_str(), &end, 16);
+            if (key.empty() || *end != '\0' || errno == ERANGE || variant > UINT8_MAX) {
+                std::cerr << path << ":" << lineNumber << ": invalid variant key '" << key
+                        << "'" << std::endl;
+                return false;
+            }
+            variants.push_back(uint8_t(variant));
+        }
+    }
+    return true;
+}
+
+// The configuration of a material compiled in batch mode: the options given on the command line,
+// with its own input and output.
+class BatchConfig : public Config {
+public:
+    BatchConfig(const Config& config, const std::string& input, const std::string& output)
+            : Config(config), mInput(input.c_str()), mOutput(output.c_str()),
+              mCommandLine(config.toString()) {
+    }
+
+    Output* getOutput() const noexcept override {
+        return const_cast<FilesystemOutput*>(&mOutput);
+    }
+
+    Input* getInput() const noexcept override {
+        return const_cast<FilesystemInput*>(&mInput);
+    }
+
+    std::string toString() const noexcept override {
+        return mCommandLine;
+    }
+
+private:
+    FilesystemInput mInput;
+    FilesystemOutput mOutput;
+    std::string mCommandLine;
+};
+
 bool MaterialCompiler::run(const Config& config) {
+    if (!config.getBatchFile().empty()) {
+        return runBatch(config);
+    }
+
     Config::Input* input = config.getInput();
     ssize_t size = input->open();
     if (size <= 0) {
@@ -274,14 +352,180 @@ bool MaterialCompiler::run(const Config& config) {
         return success;
     }
 
+    std::unique_ptr<MaterialCache> cache;
+    if (!config.getCacheDirectory().empty()) {
+        cache = std::make_unique<MaterialCache>(config.getCacheDirectory());
+    }
+
+    MaterialBuilder::init();
+    JobSystem js;
+    js.adopt();
+
+    bool success = compileMaterial(buffer.get(), size_t(size), materialFilePath, config, js,
+            cache.get());
+
+    js.emancipate();
+    MaterialBuilder::shutdown();
+    return success;
+}
+
+bool MaterialCompiler::runBatch(const Config& config) {
+    struct BatchItem {
+        std::unique_ptr<BatchConfig> config;
+        std::unique_ptr<const char[]> source;
+        size_t size = 0;
+        bool success = false;
+    };
+
+    std::ifstream in(config.getBatchFile());
+    if (!in) {
+        std::cerr << "Unable to open batch file " << config.getBatchFile() << std::endl;
+        return false;
+    }
+
+    std::vector<BatchItem> items;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            std::cerr << "Invalid line in batch file: " << line << std::endl;
+            return false;
+        }
+        items.push_back({ std::make_unique<BatchConfig>(config,
+                line.substr(0, space), line.substr(space + 1)) });
+    }
+    if (items.empty()) {
+        return true;
+    }
+
+    // The sources are read first, the id of the library depends on them.
+    for (auto& item : items) {
+        Config::Input* input = item.config->getInput();
+        ssize_t size = input->open();
+        if (size > 0) {
+            item.source = input->read();
+            item.size = size_t(size);
+        }
+    }
+
+    // checkParameters() guarantees that a library and a cache aren't used together.
+    std::unique_ptr<MaterialCache> cache;
+    std::unique_ptr<MaterialLibrary> library;
+    if (!config.getLibraryFile().empty()) {
+        // The id is a hash of the library's name and of the cache keys of its materials, so
+        // that the same inputs produce the same library and materials.
+        std::string const& name = config.getLibraryFile();
+        uint64_t id = MaterialCache::hash(name.c_str(), name.size() + 1);
+        for (auto const& item : items) {
+            if (item.source) {
+                utils::Path path(item.config->getInput()->getName());
+                const uint64_t key = MaterialCache::computeKey(item.source.get(), item.size,
+                        path.getAbsolutePath().getParent().getPath(), *item.config);
+                id = MaterialCache::hash(&key, sizeof(key), id);
+            }
+        }
+        library = std::make_unique<MaterialLibrary>(id);
+    }
+    if (!config.getCacheDirectory().empty()) {
+        cache = std::make_unique<MaterialCache>(config.getCacheDirectory());
+    }
+
     MaterialBuilder::init();
+    JobSystem js;
+    js.adopt();
+
+    // Returns true if the material was found in the cache.
+    auto compile = [this, &js, &cache, &library](BatchItem& item) {
+        if (!item.source) {
+            return false;
+        }
+        bool cacheHit = false;
+        Config::Input* input = item.config->getInput();
+        utils::Path materialFilePath = utils::Path(input->getName()).getAbsolutePath();
+        item.success = compileMaterial(item.source.get(), item.size, materialFilePath,
+                *item.config, js, cache.get(), library.get(), &cacheHit);
+        return cacheHit;
+    };
+
+    // Materials are compiled on their own until one of them actually runs glslang, to work
+    // around the lack of thread safety guarantees in glslang on first use. The other ones share
+    // the job system.
+    size_t first = 0;
+    while (first < items.size() && compile(items[first])) {
+        first++;
+    }
+    first++;
+
+    JobSystem::Job* parent = js.createJob();
+    for (size_t i = first; i < items.size(); i++) {
+        js.run(jobs::createJob(js, parent, [&compile, item = &items[i]]() {
+            compile(*item);
+        }));
+    }
+    js.runAndWait(parent);
+
+    bool libraryWritten = true;
+    if (library) {
+        Package package = library->build(!config.isDebug());
+        std::ofstream out(config.getLibraryFile(), std::ios::binary);
+        out.write((const char*) package.getData(), package.getSize());
+        out.close();
+        libraryWritten = !out.fail();
+        if (!libraryWritten) {
+            std::cerr << "Unable to write material library " << config.getLibraryFile()
+                    << std::endl;
+        }
+    }
+
+    js.emancipate();
+    MaterialBuilder::shutdown();
+
+    size_t failures = 0;
+    for (auto const& item : items) {
+        failures += item.success ? 0 : 1;
+    }
+    if (failures) {
+        std::cerr << failures << " of " << items.size() << " materials failed to compile."
+                << std::endl;
+    }
+    return failures == 0 && libraryWritten;
+}
+
+bool MaterialCompiler::compileMaterial(const char* buffer, size_t size,
+        const utils::Path& materialFilePath, const Config& config, JobSystem& js,
+        const MaterialCache* cache, MaterialLibrary* library, bool* cacheHit) {
+    const bool reflect = config.getReflectionTarget() != Config::Metadata::NONE;
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+
+    // The include directory is the directory containing the material file.
+    const utils::Path includeDirectory = materialFilePath.getParent();
+
+    // Shaders are only printed when they're compiled, so printing them bypasses the cache
+    // lookup. The package is still stored.
+    uint64_t cacheKey = 0;
+    if (cache && !reflect) {
+        cacheKey = MaterialCache::computeKey(buffer, size, includeDirectory.getPath(), config);
+        Package package = config.printShaders() ? Package::invalidPackage() : cache->load(cacheKey);
+        if (package.isValid()) {
+            if (cacheHit) {
+                *cacheHit = true;
+            }
+            return writePackage(package, config);
+        }
+    }
+
     MaterialBuilder builder;
     // Before attempting an expensive lex, let's find out if we were sent pure JSON.
     bool parsed;
-    if (isValidJsonStart(buffer.get(), size_t(size))) {
-        parsed = parseMaterialAsJSON(buffer.get(), size_t(size), builder);
+    if (isValidJsonStart(buffer, size)) {
+        parsed = parseMaterialAsJSON(buffer, size, builder);
     } else {
-        parsed = parseMaterial(buffer.get(), size_t(size), builder);
+        parsed = parseMaterial(buffer, size, builder);
     }
 
     if (!parsed) {
@@ -295,41 +539,84 @@ bool MaterialCompiler::run(const Config& config) {
             return reflectParameters(builder);
     }
 
-    // Set the root include directory to the directory containing the material file.
+    // Set the root include directory, and record the included files for the cache.
     DirIncluder includer;
-    includer.setIncludeDirectory(materialFilePath.getParent());
+    includer.setIncludeDirectory(includeDirectory);
+
+    std::vector<MaterialCache::Include> includes;
+    auto recordingIncluder = [&includer, &includes](const utils::CString& includedBy,
+            IncludeResult& result) {
+        if (!includer(includedBy, result)) {
+            return false;
+        }
+        includes.emplace_back(result.name.c_str(),
+                MaterialCache::hash(result.text.c_str(), result.text.size()));
+        return true;
+    };
 
     builder
-        .includeCallback(includer)
+        .includeCallback(recordingIncluder)
         .fileName(materialFilePath.getName().c_str())
         .platform(config.getPlatform())
         .targetApi(config.getTargetApi())
         .optimization(config.getOptimizationLevel())
         .printShaders(config.printShaders())
         .generateDebugInfo(config.isDebug())
-        .variantFilter(config.getVariantFilter() | builder.getVariantFilter());
+        .variantFilter(config.getVariantFilter() | builder.getVariantFilter())
+        .library(library);
 
     for (const auto& define : config.getDefines()) {
         builder.shaderDefine(define.first.c_str(), define.second.c_str());
     }
 
-    JobSystem js;
-    js.adopt();
+    if (!config.getVariantProfile().empty()) {
+        std::vector<uint8_t> variants;
+        const char* name = builder.getMaterialName().c_str_safe();
+        if (!readVariantProfile(config.getVariantProfile(), name, variants)) {
+            return false;
+        }
+        builder.variants(variants.data(), variants.size());
+    }
 
     // Write builder.build() to output.
     Package package = builder.build(js);
 
-    js.emancipate();
-    MaterialBuilder::shutdown();
-
     if (!package.isValid()) {
-        std::cerr << "Could not compile material " << input->getName() << std::endl;
+        std::cerr << "Could not compile material " << materialFilePath.c_str() << std::endl;
         return false;
     }
+
+    if (cache) {
+        std::sort(includes.begin(), includes.end());
+        includes.erase(std::unique(includes.begin(), includes.end()), includes.end());
+        if (!cache->store(cacheKey, package, includes)) {
+            std::cerr << "Unable to store material " << materialFilePath.c_str() << " in the cache"
+                    << std::endl;
+        }
+    }
     return writePackage(package, config);
 }
 
 bool MaterialCompiler::checkParameters(const Config& config) {
+    // In batch mode, inputs and outputs are listed in the batch file.
+    if (!config.getBatchFile().empty()) {
+        if (config.getReflectionTarget() != Config::Metadata::NONE || config.rawShaderMode()) {
+            std::cerr << "Reflection and raw shaders are not supported in batch mode." << std::endl;
+            return false;
+        }
+        // A cached material doesn't add its shaders to the library's dictionaries.
+        if (!config.getLibraryFile().empty() && !config.getCacheDirectory().empty()) {
+            std::cerr << "A material library can't be built with a cache." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    if (!config.getLibraryFile().empty()) {
+        std::cerr << "A material library can only be built in batch mode." << std::endl;
+        return false;
+    }
+
     // Check for input file.
     if (config.getInput() == nullptr) {
         std::cerr << "Missing input filename." << std::endl;
@@ -25,12 +25,18 @@
 
 namespace filamat {
 class MaterialBuilder;
+class MaterialLibrary;
+}
+namespace utils {
+class JobSystem;
+class Path;
 }
 class TestMaterialCompiler;
 
 namespace matc {
 
 class JsonishValue;
+class MaterialCache;
 class MaterialCompiler final: public Compiler {
 public:
     MaterialCompiler();
@@ -42,6 +48,17 @@ public:
 private:
     friend class ::TestMaterialCompiler;
 
+    // Compiles all the materials listed in the batch file on a single job system.
+    bool runBatch(const Config& config);
+
+    // Compiles a material and writes it to the output of the given configuration. The package is
+    // fetched from, or stored in, the cache if there is one. The shaders are stored in the
+    // library if there is one. If cacheHit is not null, it's set to true when the package came
+    // from the cache.
+    bool compileMaterial(const char* buffer, size_t size, const utils::Path& materialFilePath,
+            const Config& config, utils::JobSystem& js, const MaterialCache* cache,
+            filamat::MaterialLibrary* library = nullptr, bool* cacheHit = nullptr);
+
     bool parseMaterial(const char* buffer, size_t size,
             filamat::MaterialBuilder& builder) const noexcept;
     bool processMaterial(const MaterialLexeme&,
@@ -18,11 +18,19 @@
 
 #include "MockConfig.h"
 
+#include <matc/MaterialCache.h>
 #include <matc/MaterialCompiler.h>
 #include <matc/MaterialLexer.h>
 #include <matc/JsonishLexer.h>
 #include <matc/JsonishParser.h>
 
+#include <utils/Path.h>
+
+#include <fstream>
+#include <vector>
+
+#include <string.h>
+
 class MaterialLexer: public ::testing::Test {
 protected:
     MaterialLexer() = default;
@@ -301,6 +309,67 @@ TEST_F(MaterialLexer, JsonMaterialCompiler) {
   EXPECT_EQ(result, true);
 }
 
+TEST(MaterialCache, ComputeKey) {
+    MockConfig config;
+    const std::string other = materialSource + " ";
+    const uint64_t key = matc::MaterialCache::computeKey(
+            materialSource.c_str(), materialSource.size(), "/a", config);
+    EXPECT_EQ(key, matc::MaterialCache::computeKey(
+            materialSource.c_str(), materialSource.size(), "/a", config));
+    EXPECT_NE(key, matc::MaterialCache::computeKey(other.c_str(), other.size(), "/a", config));
+
+    // The same source in another directory may include other files.
+    EXPECT_NE(key, matc::MaterialCache::computeKey(
+            materialSource.c_str(), materialSource.size(), "/b", config));
+}
+
+static void writeTextFile(const utils::Path& path, const char* text) {
+    std::ofstream out(path.getPath(), std::ios::binary);
+    out << text;
+}
+
+TEST(MaterialCache, LoadAndStore) {
+    const utils::Path root = utils::Path::getTemporaryDirectory() + "test_matc_cache";
+    const utils::Path include = root + "include.h";
+    matc::MaterialCache cache(root.getPath());
+    writeTextFile(include, "float foo;");
+
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    const filamat::Package package(data, sizeof(data));
+    const std::vector<matc::MaterialCache::Include> includes = {
+            { include.getPath(), matc::MaterialCache::hash("float foo;", 10) }
+    };
+
+    // Miss: nothing is stored under this key yet.
+    const uint64_t key = 0x1234;
+    utils::Path(root + "0000000000001234.filamat").unlinkFile();
+    utils::Path(root + "0000000000001234.includes").unlinkFile();
+    EXPECT_FALSE(cache.load(key).isValid());
+
+    // Hit: the same contents come back.
+    ASSERT_TRUE(cache.store(key, package, includes));
+    filamat::Package loaded = cache.load(key);
+    ASSERT_TRUE(loaded.isValid());
+    ASSERT_EQ(loaded.getSize(), sizeof(data));
+    EXPECT_EQ(memcmp(loaded.getData(), data, sizeof(data)), 0);
+    EXPECT_FALSE(cache.load(key + 1).isValid());
+
+    // Invalidation: changing an included file invalidates the entry.
+    writeTextFile(include, "float bar;");
+    EXPECT_FALSE(cache.load(key).isValid());
+
+    // Storing again after the change makes the entry valid again.
+    const std::vector<matc::MaterialCache::Include> updated = {
+            { include.getPath(), matc::MaterialCache::hash("float bar;", 10) }
+    };
+    ASSERT_TRUE(cache.store(key, package, updated));
+    EXPECT_TRUE(cache.load(key).isValid());
+
+    // Removing an included file invalidates the entry too.
+    utils::Path(include).unlinkFile();
+    EXPECT_FALSE(cache.load(key).isValid());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();